@@ -0,0 +1,215 @@
+/**
+ * @file bucket_engine.h
+ * @brief Container code shared by the tables, generated for each container layout.
+ *        A container holds its pairs as parallel arrays that share one allocation. A layout
+ *        lists those arrays as an X-macro of X(field, type) entries, and DEFINE_BUCKET_ENGINE
+ *        expands it into the functions that grow, append to, remove from and release such a
+ *        container. Arrays are laid out in list order, so list them from the largest
+ *        alignment down.
+ *        DEFINE_STRING_BUCKET_ENGINE adds the probe of the string key Bucket; other key types
+ *        bring their own probe.
+ *        String keys are compared by equalKeyBytes, 32 bytes per instruction with AVX2 and 16
+ *        with SSE2, once the stored hash and length both matched. The AVX2 compare is built
+ *        for that target alone and taken when startup detection set keyProbeAvx2.
+ */
+
+#ifndef BUCKET_ENGINE_H
+#define BUCKET_ENGINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "hash_table.h"
+#include "key_hash.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/** @brief Arrays of a string key Bucket: key, value, full hash and key length of every pair. */
+#define STRING_BUCKET_ARRAYS(X) X(keys, char*) X(values, char*) X(hashes, unsigned int) X(lengths, unsigned int)
+
+/** @brief Adds the bytes one slot takes in an array. */
+#define BUCKET_ENGINE_SLOT_BYTES(field, type) + sizeof(type)
+/** @brief Declares a parameter holding one array element. */
+#define BUCKET_ENGINE_PARAMETER(field, type) , type field
+/** @brief Carves an array out of the new block, advancing the cursor. */
+#define BUCKET_ENGINE_CARVE(field, type) type* new_##field = (type*)cursor; cursor += sizeof(type) * newSlots;
+/** @brief Copies the pairs of an array into its new array. */
+#define BUCKET_ENGINE_COPY(field, type) memcpy(new_##field, bucket->field, sizeof(type) * bucket->count);
+/** @brief Points the container at a new array. */
+#define BUCKET_ENGINE_ASSIGN(field, type) bucket->field = new_##field;
+/** @brief Stores one element at the end of an array. */
+#define BUCKET_ENGINE_STORE(field, type) bucket->field[bucket->count] = field;
+/** @brief Closes a hole in an array, shifting the later elements down. */
+#define BUCKET_ENGINE_CLOSE(field, type) memmove(&bucket->field[slot], &bucket->field[slot + 1], sizeof(type) * (bucket->count - slot));
+
+/**
+ * @brief Generates the container functions of a layout.
+ * @details Expands into, for a container type @p Type with int count and slots fields:
+ *          - size_t NameSlotBytes(void): bytes of arrays per pair slot;
+ *          - size_t growName(Type*): doubles the arrays, starting at @p initialSlots;
+ *          - size_t appendToName(Type*, one argument per array): appends a pair;
+ *          - void removeFromName(Type*, int slot): removes the pair in the slot, which the
+ *            caller has freed the strings of, shifting the later pairs down so the pairs
+ *            stay in insertion order; the arrays are kept;
+ *          - size_t releaseName(Type*): frees the arrays and empties the container.
+ *          grow, appendTo and release return the bytes the arrays grew or shrank by.
+ * @param Name Suffix of the generated function names.
+ * @param Type Container type.
+ * @param ARRAYS X-macro listing the arrays.
+ * @param first First array of the list, which points at the block.
+ * @param initialSlots Pair slots allocated the first time the container is used.
+ */
+#define DEFINE_BUCKET_ENGINE(Name, Type, ARRAYS, first, initialSlots)                       \
+    static inline size_t Name##SlotBytes(void) {                                            \
+        return 0 ARRAYS(BUCKET_ENGINE_SLOT_BYTES);                                          \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t grow##Name(Type* bucket) {                                         \
+        int newSlots = bucket->slots == 0 ? (initialSlots) : bucket->slots * 2;             \
+        char* cursor = (char*)malloc(Name##SlotBytes() * newSlots);                         \
+        if (cursor == NULL) {                                                               \
+            perror("Memory allocation error");                                              \
+            exit(EXIT_FAILURE);                                                             \
+        }                                                                                   \
+        ARRAYS(BUCKET_ENGINE_CARVE)                                                         \
+        if (bucket->count > 0) {                                                            \
+            ARRAYS(BUCKET_ENGINE_COPY)                                                      \
+        }                                                                                   \
+        free(bucket->first);                                                                \
+        size_t grownBytes = Name##SlotBytes() * (size_t)(newSlots - bucket->slots);         \
+        ARRAYS(BUCKET_ENGINE_ASSIGN)                                                        \
+        bucket->slots = newSlots;                                                           \
+        return grownBytes;                                                                  \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t appendTo##Name(Type* bucket ARRAYS(BUCKET_ENGINE_PARAMETER)) {     \
+        size_t grownBytes = 0;                                                              \
+        if (bucket->count == bucket->slots) {                                               \
+            grownBytes = grow##Name(bucket);                                                \
+        }                                                                                   \
+        ARRAYS(BUCKET_ENGINE_STORE)                                                         \
+        bucket->count++;                                                                    \
+        return grownBytes;                                                                  \
+    }                                                                                       \
+                                                                                            \
+    static inline void removeFrom##Name(Type* bucket, int slot) {                           \
+        bucket->count--;                                                                    \
+        ARRAYS(BUCKET_ENGINE_CLOSE)                                                         \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t release##Name(Type* bucket) {                                      \
+        size_t releasedBytes = Name##SlotBytes() * (size_t)bucket->slots;                   \
+        free(bucket->first);                                                                \
+        memset(bucket, 0, sizeof(*bucket));                                                 \
+        return releasedBytes;                                                               \
+    }
+
+#if defined(__x86_64__)
+/**
+ * @brief equalKeyBytes for keys of at least 32 bytes, one AVX2 compare per 32 bytes.
+ * @details Compiled for AVX2 whatever the build flags, so only call it when keyProbeAvx2 is set.
+ * @param a First key.
+ * @param b Second key.
+ * @param length Length of both keys, at least 32.
+ * @return Non-zero if the keys are equal.
+ */
+__attribute__((target("avx2")))
+static inline int equalLongKeyBytesAvx2(const char* a, const char* b, size_t length) {
+    for (size_t i = 0; i + 32 < length; i += 32) {
+        __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+        if ((unsigned int)_mm256_movemask_epi8(equal) != 0xFFFFFFFFu) {
+            return 0;
+        }
+    }
+    __m256i last = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + length - 32)), _mm256_loadu_si256((const __m256i*)(b + length - 32)));
+    return (unsigned int)_mm256_movemask_epi8(last) == 0xFFFFFFFFu;
+}
+#endif
+
+/**
+ * @brief Whether two keys of the same length hold the same bytes.
+ * @details Knowing the length, the comparison neither looks for terminators nor reads past
+ *          the keys: it steps over whole vectors and finishes with one vector ending exactly
+ *          at the last byte, overlapping the previous one. Keys shorter than a vector are
+ *          compared as two overlapping words.
+ * @param a First key.
+ * @param b Second key.
+ * @param length Length of both keys.
+ * @return Non-zero if the keys are equal.
+ */
+static inline int equalKeyBytes(const char* a, const char* b, size_t length) {
+#if defined(__x86_64__)
+    if (length >= 32 && keyProbeAvx2) {
+        return equalLongKeyBytesAvx2(a, b, length);
+    }
+#endif
+#if defined(__SSE2__)
+    if (length >= 16) {
+        for (size_t i = 0; i + 16 < length; i += 16) {
+            __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+            if (_mm_movemask_epi8(equal) != 0xFFFF) {
+                return 0;
+            }
+        }
+        __m128i last = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + length - 16)), _mm_loadu_si128((const __m128i*)(b + length - 16)));
+        return _mm_movemask_epi8(last) == 0xFFFF;
+    }
+#endif
+    if (length >= 8) {
+        // Without SSE2, longer keys go 8 bytes at a time as well
+        uint64_t x;
+        uint64_t y;
+        for (size_t i = 0; i + 8 < length; i += 8) {
+            memcpy(&x, a + i, 8);
+            memcpy(&y, b + i, 8);
+            if (x != y) {
+                return 0;
+            }
+        }
+        memcpy(&x, a + length - 8, 8);
+        memcpy(&y, b + length - 8, 8);
+        return x == y;
+    }
+    if (length >= 4) {
+        uint32_t x[2];
+        uint32_t y[2];
+        memcpy(&x[0], a, 4);
+        memcpy(&x[1], a + length - 4, 4);
+        memcpy(&y[0], b, 4);
+        memcpy(&y[1], b + length - 4, 4);
+        return x[0] == y[0] && x[1] == y[1];
+    }
+    for (size_t i = 0; i < length; ++i) {
+        if (a[i] != b[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Generates the container functions of the string key Bucket, plus its probe.
+ * @details Adds int findInName(const Bucket*, unsigned int hash, const char* key, size_t length),
+ *          which scans only the dense hashes array and compares keys with equalKeyBytes on a
+ *          hash and length match, returning the slot of the key or -1. The scan runs from the
+ *          newest pair down, so a key inserted twice resolves to its latest value.
+ * @param Name Suffix of the generated function names.
+ * @param initialSlots Pair slots allocated the first time a container is used.
+ */
+#define DEFINE_STRING_BUCKET_ENGINE(Name, initialSlots)                                     \
+    DEFINE_BUCKET_ENGINE(Name, Bucket, STRING_BUCKET_ARRAYS, keys, initialSlots)            \
+                                                                                            \
+    static inline int findIn##Name(const Bucket* bucket, unsigned int hash, const char* key, size_t length) { \
+        for (int i = bucket->count - 1; i >= 0; --i) {                                      \
+            if (bucket->hashes[i] == hash && bucket->lengths[i] == length &&                \
+                equalKeyBytes(bucket->keys[i], key, length)) {                              \
+                return i;                                                                   \
+            }                                                                               \
+        }                                                                                   \
+        return -1;                                                                          \
+    }
+
+#endif /* BUCKET_ENGINE_H */
@@ -0,0 +1,287 @@
+/**
+ * @file bulk_import.c
+ * @brief Implementation of the bulk importer declared in bulk_import.h.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bulk_import.h"
+#include "key_hash.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/** @brief Pair prepared by a worker for the table to adopt. */
+typedef struct {
+    char* key; /**< Heap copy of the key. */
+    char* value; /**< Heap copy of the value. */
+    unsigned int hash; /**< hashKey of the key. */
+} ImportedPair;
+
+/** @brief Lines of the file parsed by one worker. */
+typedef struct {
+    const char* begin; /**< First byte of the chunk, the start of a line. */
+    const char* end; /**< One past the last byte, just after a newline or at the end of the file. */
+    char separator; /**< Byte between key and value. */
+    ImportedPair* pairs; /**< Pairs found, in file order. */
+    long count; /**< Number of pairs. */
+    long slots; /**< Capacity of pairs. */
+    long malformed; /**< Non-empty lines without a separator. */
+} ImportChunk;
+
+/** @brief Bytes of the array of containers each insertion range covers, about an L2 cache. */
+#define IMPORT_RANGE_BYTES (64 * 1024)
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Seconds on the monotonic clock.
+ * @return Current time.
+ */
+static double importSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Finds the first of two bytes, comparing 16 bytes at a time.
+ * @param p First byte to search.
+ * @param end One past the last byte to search.
+ * @param a First byte looked for.
+ * @param b Second byte looked for.
+ * @return Pointer to the first match, or @p end.
+ */
+static const char* findEither(const char* p, const char* end, char a, char b) {
+#if defined(__SSE2__)
+    const __m128i wantA = _mm_set1_epi8(a);
+    const __m128i wantB = _mm_set1_epi8(b);
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)p);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, wantA), _mm_cmpeq_epi8(block, wantB)));
+        if (mask != 0) {
+            return p + __builtin_ctz((unsigned int)mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != a && *p != b) {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * @brief Copies a field of the file into a terminated heap string.
+ * @param start First byte of the field.
+ * @param length Length of the field.
+ * @return The copy.
+ */
+static char* copyField(const char* start, size_t length) {
+    char* copy = (char*)malloc(length + 1);
+    if (copy == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, start, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+/**
+ * @brief Parses the lines of a chunk into prepared pairs.
+ * @details The key ends at the first separator and the value at the end of the line, with a
+ *          trailing carriage return dropped, so values may contain the separator.
+ * @param arg Pointer to the ImportChunk.
+ * @return NULL.
+ */
+static void* parseChunk(void* arg) {
+    ImportChunk* chunk = (ImportChunk*)arg;
+    const char* p = chunk->begin;
+    const char* end = chunk->end;
+
+    while (p < end) {
+        const char* separator = findEither(p, end, chunk->separator, '\n');
+        if (separator == end || *separator == '\n') {
+            // No separator on this line, only blank lines are expected
+            if (separator > p && !(separator - p == 1 && *p == '\r')) {
+                chunk->malformed++;
+            }
+            p = separator + 1;
+            continue;
+        }
+        const char* lineEnd = (const char*)memchr(separator + 1, '\n', (size_t)(end - separator - 1));
+        if (lineEnd == NULL) {
+            lineEnd = end;
+        }
+        const char* valueEnd = lineEnd > separator + 1 && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+
+        if (chunk->count == chunk->slots) {
+            chunk->slots = chunk->slots > 0 ? chunk->slots * 2 : 1024;
+            chunk->pairs = (ImportedPair*)realloc(chunk->pairs, sizeof(ImportedPair) * chunk->slots);
+            if (chunk->pairs == NULL) {
+                perror("Memory allocation error");
+                exit(EXIT_FAILURE);
+            }
+        }
+        ImportedPair* pair = &chunk->pairs[chunk->count++];
+        size_t keyLength = (size_t)(separator - p);
+        pair->key = copyField(p, keyLength);
+        pair->value = copyField(separator + 1, (size_t)(valueEnd - separator - 1));
+        pair->hash = hashKeyBytes(pair->key, keyLength);
+        p = lineEnd + 1;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Gathers the pairs of all chunks, grouped by the range of containers they go to.
+ * @details A large table is far bigger than the caches, so inserting in file order misses on
+ *          almost every container. Grouping the pairs into ranges of IMPORT_RANGE_BYTES of
+ *          containers keeps each range cached while it fills. The counting sort is stable,
+ *          so pairs of the same key keep their file order.
+ * @param ht Pointer to the hash table, already grown to its final capacity.
+ * @param chunks Parsed chunks, whose pair arrays are released.
+ * @param chunkCount Number of chunks.
+ * @param total Number of pairs in all chunks.
+ * @return Array of the pairs, to be freed by the caller.
+ */
+static ImportedPair* orderByContainer(const HashTable* ht, ImportChunk* chunks, int chunkCount, long total) {
+    size_t ranges = (size_t)ht->capacity * sizeof(Bucket) / IMPORT_RANGE_BYTES + 1;
+    size_t* starts = (size_t*)calloc(ranges + 1, sizeof(size_t));
+    ImportedPair* ordered = (ImportedPair*)malloc(sizeof(ImportedPair) * (total > 0 ? total : 1));
+    if (starts == NULL || ordered == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    // Count the pairs of each range, then turn the counts into start positions
+    for (int t = 0; t < chunkCount; ++t) {
+        for (long i = 0; i < chunks[t].count; ++i) {
+            starts[(size_t)(chunks[t].pairs[i].hash % ht->capacity) * ranges / ht->capacity + 1]++;
+        }
+    }
+    for (size_t r = 1; r <= ranges; ++r) {
+        starts[r] += starts[r - 1];
+    }
+    for (int t = 0; t < chunkCount; ++t) {
+        for (long i = 0; i < chunks[t].count; ++i) {
+            const ImportedPair* pair = &chunks[t].pairs[i];
+            ordered[starts[(size_t)(pair->hash % ht->capacity) * ranges / ht->capacity]++] = *pair;
+        }
+        free(chunks[t].pairs);
+    }
+    free(starts);
+    return ordered;
+}
+
+/**
+ * @brief Inserts every "key<separator>value" line of a file into a table.
+ * @details Pairs of the same key are inserted in file order, so a repeated key behaves as
+ *          with repeated insertKeyValPair calls. The table is grown once up front to hold all
+ *          of them.
+ * @param ht Pointer to the hash table.
+ * @param path Path of the file.
+ * @param separator Byte between key and value, e.g. ','.
+ * @param threads Number of parsing threads, clamped to 1..IMPORT_MAX_THREADS and to one
+ *        per IMPORT_MIN_CHUNK_BYTES of file.
+ * @param stats Receives the outcome, may be NULL.
+ * @return 0 on success, -1 if the file could not be opened or mapped, with errno set.
+ */
+int importKeyValueFile(HashTable* ht, const char* path, char separator, int threads, ImportStats* stats) {
+    ImportStats local = { 0 };
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return -1;
+    }
+    local.bytes = (size_t)info.st_size;
+    if (local.bytes == 0) {
+        close(fd);
+        if (stats != NULL) {
+            *stats = local;
+        }
+        return 0;
+    }
+    const char* map = (const char*)mmap(NULL, local.bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    madvise((void*)map, local.bytes, MADV_SEQUENTIAL);
+
+    // Cut the file into one chunk per thread, each ending just after a newline
+    size_t maxThreads = local.bytes / IMPORT_MIN_CHUNK_BYTES + 1;
+    threads = threads < 1 ? 1 : threads > IMPORT_MAX_THREADS ? IMPORT_MAX_THREADS : threads;
+    threads = (size_t)threads > maxThreads ? (int)maxThreads : threads;
+    ImportChunk chunks[IMPORT_MAX_THREADS];
+    const char* fileEnd = map + local.bytes;
+    const char* start = map;
+    for (int t = 0; t < threads; ++t) {
+        const char* cut = t == threads - 1 ? fileEnd : map + local.bytes / threads * (t + 1);
+        if (cut < start) {
+            cut = start;
+        }
+        if (cut < fileEnd) {
+            const char* newline = (const char*)memchr(cut, '\n', (size_t)(fileEnd - cut));
+            cut = newline != NULL ? newline + 1 : fileEnd;
+        }
+        chunks[t] = (ImportChunk){ start, cut, separator, NULL, 0, 0, 0 };
+        start = cut;
+    }
+
+    // Parse on the workers, the caller takes the first chunk and any a thread could not start
+    double begin = importSeconds();
+    pthread_t workers[IMPORT_MAX_THREADS];
+    int started[IMPORT_MAX_THREADS] = { 0 };
+    for (int t = 1; t < threads; ++t) {
+        started[t] = pthread_create(&workers[t], NULL, parseChunk, &chunks[t]) == 0;
+    }
+    parseChunk(&chunks[0]);
+    long total = chunks[0].count;
+    for (int t = 1; t < threads; ++t) {
+        if (started[t]) {
+            pthread_join(workers[t], NULL);
+        } else {
+            parseChunk(&chunks[t]);
+        }
+        total += chunks[t].count;
+    }
+    munmap((void*)map, local.bytes);
+    local.parseSeconds = importSeconds() - begin;
+
+    // Grow the table once, then hand the prepared pairs over
+    begin = importSeconds();
+    reserveHashTable(ht, (int)(ht->size + total));
+    ImportedPair* ordered = orderByContainer(ht, chunks, threads, total);
+    for (long i = 0; i < total; ++i) {
+        if (adoptKeyValPair(ht, ordered[i].hash, ordered[i].key, ordered[i].value)) {
+            local.pairs++;
+        } else {
+            local.rejected++;
+        }
+    }
+    free(ordered);
+    for (int t = 0; t < threads; ++t) {
+        local.malformedLines += chunks[t].malformed;
+    }
+    local.insertSeconds = importSeconds() - begin;
+    local.threads = threads;
+
+    if (stats != NULL) {
+        *stats = local;
+    }
+    return 0;
+}
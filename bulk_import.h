@@ -0,0 +1,43 @@
+/**
+ * @file bulk_import.h
+ * @brief Bulk import of "key,value" lines into a Hash Table.
+ *        The file is mapped into memory and split into chunks at line boundaries; worker
+ *        threads find the separators with vector compares, hash the keys and copy each key
+ *        and value once into the allocations the table adopts. The table is then grown once
+ *        to its final size and fed the prepared pairs in file order.
+ */
+
+#ifndef BULK_IMPORT_H
+#define BULK_IMPORT_H
+
+#include <stddef.h>
+#include "hash_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Upper bound on the worker threads of one import. */
+#define IMPORT_MAX_THREADS 64
+/** @brief Files smaller than this are parsed on the calling thread alone. */
+#define IMPORT_MIN_CHUNK_BYTES (1024 * 1024)
+
+/** @brief Outcome of a bulk import. */
+typedef struct {
+    long pairs; /**< Pairs inserted. */
+    long malformedLines; /**< Non-empty lines without a separator, skipped. */
+    long rejected; /**< Pairs the memory budget of the table turned away. */
+    size_t bytes; /**< Size of the file. */
+    int threads; /**< Worker threads that parsed the file. */
+    double parseSeconds; /**< Time spent scanning, hashing and copying. */
+    double insertSeconds; /**< Time spent growing the table and inserting. */
+} ImportStats;
+
+/*  FUNCTION DECLARATIONS   */
+int importKeyValueFile(HashTable* ht, const char* path, char separator, int threads, ImportStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BULK_IMPORT_H */
@@ -0,0 +1,264 @@
+/**
+ * @file change_feed.c
+ * @brief Implementation of the change feed declared in change_feed.h.
+ *        A writer claims the bytes of its record with one fetch-add on ChangeFeed::reserved,
+ *        fills them, and commits the record by storing a tag made of its position in the first
+ *        word. Readers copy a record and then check that no writer has claimed the bytes it
+ *        occupied again, the way a seqlock reader checks the sequence, so a record overwritten
+ *        while being copied is detected rather than returned torn. Ring words are written with
+ *        release stores and read with acquire loads, plain moves on x86, so a reader that sees
+ *        any word of a later claim also sees that claim in ChangeFeed::reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "change_feed.h"
+
+/** @brief Bit set in every commit tag, so a zeroed ring holds no committed record. */
+#define CHANGE_TAG_COMMITTED 4
+/** @brief Bits of a commit tag holding the ChangeOp. */
+#define CHANGE_TAG_OP_MASK 3
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Rounds a byte count up to whole ring words.
+ * @param bytes Number of bytes.
+ * @return Bytes in whole words.
+ */
+static uint64_t wordBytes(uint64_t bytes) {
+    return (bytes + 7) & ~(uint64_t)7;
+}
+
+/**
+ * @brief Ring word holding a position.
+ * @param feed Pointer to the feed.
+ * @param position Byte position, a multiple of 8.
+ * @return Pointer to the word.
+ */
+static uint64_t* ringWord(const ChangeFeed* feed, uint64_t position) {
+    return &feed->words[(position & (feed->capacity - 1)) / 8];
+}
+
+/**
+ * @brief Stores a run of bytes into the ring, word by word.
+ * @param feed Pointer to the feed.
+ * @param position Position of the first word, a multiple of 8.
+ * @param pending Word being filled, carried over between calls.
+ * @param filled Bytes of @p pending already filled, carried over between calls.
+ * @param bytes Bytes to store.
+ * @param length Number of bytes.
+ * @return Position of the word @p pending will be stored to.
+ */
+static uint64_t storeBytes(ChangeFeed* feed, uint64_t position, uint64_t* pending, size_t* filled, const char* bytes, size_t length) {
+    while (length > 0) {
+        if (*filled == 0 && length >= 8) {
+            // Whole words straight from the source
+            uint64_t word;
+            memcpy(&word, bytes, 8);
+            __atomic_store_n(ringWord(feed, position), word, __ATOMIC_RELEASE);
+            position += 8;
+            bytes += 8;
+            length -= 8;
+            continue;
+        }
+        size_t take = 8 - *filled < length ? 8 - *filled : length;
+        memcpy((char*)pending + *filled, bytes, take);
+        *filled += take;
+        bytes += take;
+        length -= take;
+        if (*filled == 8) {
+            __atomic_store_n(ringWord(feed, position), *pending, __ATOMIC_RELEASE);
+            position += 8;
+            *pending = 0;
+            *filled = 0;
+        }
+    }
+    return position;
+}
+
+/**
+ * @brief Initializes an empty feed.
+ * @details The whole ring is touched here, so publishing never faults in pages.
+ * @param feed Pointer to the feed.
+ * @param capacity Size of the ring in bytes, rounded up to a power of two of at least 4 KiB.
+ */
+void initChangeFeed(ChangeFeed* feed, size_t capacity) {
+    uint64_t bytes = 4096;
+    while (bytes < capacity) {
+        bytes *= 2;
+    }
+    feed->words = (uint64_t*)malloc(bytes);
+    if (feed->words == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    // Zero every page now, so writers never take a page fault on a fresh part of the ring
+    memset(feed->words, 0, bytes);
+    feed->capacity = bytes;
+    feed->reserved = 0;
+    feed->droppedRecords = 0;
+}
+
+/**
+ * @brief Appends a record to the feed.
+ * @details Lock-free and wait-free: any number of threads may publish at once, and none ever
+ *          waits for a consumer. Records longer than 1/CHANGE_RECORD_MAX_SHARE of the ring
+ *          are counted in ChangeFeed::droppedRecords instead. A writer descheduled between
+ *          claiming its bytes and committing them while other writers go round the whole
+ *          ring can overwrite newer records, so size the ring well above what the writers
+ *          produce in a scheduler time slice.
+ * @param feed Pointer to the feed.
+ * @param op Kind of mutation.
+ * @param key Key of the pair.
+ * @param keyLength Length of the key.
+ * @param value New value, NULL for removals.
+ * @param valueLength Length of the value, 0 for removals.
+ */
+void publishChange(ChangeFeed* feed, ChangeOp op, const char* key, size_t keyLength, const char* value, size_t valueLength) {
+    uint64_t bytes = CHANGE_RECORD_HEADER_BYTES + wordBytes((uint64_t)keyLength + valueLength);
+    if (bytes > feed->capacity / CHANGE_RECORD_MAX_SHARE || keyLength > UINT32_MAX || valueLength > UINT32_MAX) {
+        __atomic_fetch_add(&feed->droppedRecords, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    // Claim the bytes
+    uint64_t position = __atomic_fetch_add(&feed->reserved, bytes, __ATOMIC_RELAXED);
+
+    // Lengths, then key and value back to back, then the tag that commits the record
+    __atomic_store_n(ringWord(feed, position + 8), (uint64_t)keyLength | ((uint64_t)valueLength << 32), __ATOMIC_RELEASE);
+    uint64_t pending = 0;
+    size_t filled = 0;
+    uint64_t next = storeBytes(feed, position + CHANGE_RECORD_HEADER_BYTES, &pending, &filled, key, keyLength);
+    next = storeBytes(feed, next, &pending, &filled, value, valueLength);
+    if (filled > 0) {
+        __atomic_store_n(ringWord(feed, next), pending, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(ringWord(feed, position), position | CHANGE_TAG_COMMITTED | (uint64_t)op, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Opens a cursor at the newest position; it sees the records published from now on.
+ * @param cursor Pointer to the cursor.
+ * @param feed Pointer to the feed to read.
+ */
+void openChangeFeedCursor(ChangeFeedCursor* cursor, const ChangeFeed* feed) {
+    cursor->feed = feed;
+    cursor->position = __atomic_load_n(&feed->reserved, __ATOMIC_ACQUIRE);
+    cursor->overruns = 0;
+    cursor->lostBytes = 0;
+    cursor->buffer = NULL;
+    cursor->bufferSize = 0;
+}
+
+/**
+ * @brief Moves a lapped cursor to the newest position and counts what it lost.
+ * @param cursor Pointer to the cursor.
+ * @param reserved Current ChangeFeed::reserved.
+ * @return CHANGE_FEED_OVERRUN.
+ */
+static int overrun(ChangeFeedCursor* cursor, uint64_t reserved) {
+    cursor->lostBytes += reserved - cursor->position;
+    cursor->position = reserved;
+    cursor->overruns++;
+    return CHANGE_FEED_OVERRUN;
+}
+
+/**
+ * @brief Reads the next record of a cursor.
+ * @details Never blocks. A record claimed but not yet committed reads as CHANGE_FEED_EMPTY,
+ *          even if records after it are committed, so records come out in position order.
+ *          After CHANGE_FEED_OVERRUN the consumer has missed mutations and must resynchronize,
+ *          e.g. from a snapshot of the table, before applying further records.
+ * @param cursor Pointer to the cursor.
+ * @param record Receives the record; its strings stay valid until the next read.
+ * @return CHANGE_FEED_RECORD, CHANGE_FEED_EMPTY or CHANGE_FEED_OVERRUN.
+ */
+int readChangeFeed(ChangeFeedCursor* cursor, ChangeRecord* record) {
+    const ChangeFeed* feed = cursor->feed;
+    uint64_t position = cursor->position;
+
+    uint64_t tag = __atomic_load_n(ringWord(feed, position), __ATOMIC_ACQUIRE);
+    if ((tag & ~(uint64_t)(CHANGE_TAG_COMMITTED | CHANGE_TAG_OP_MASK)) != position || !(tag & CHANGE_TAG_COMMITTED)) {
+        // Either not committed yet or already overwritten by a later lap
+        uint64_t reserved = __atomic_load_n(&feed->reserved, __ATOMIC_ACQUIRE);
+        return reserved > position + feed->capacity ? overrun(cursor, reserved) : CHANGE_FEED_EMPTY;
+    }
+
+    uint64_t lengths = __atomic_load_n(ringWord(feed, position + 8), __ATOMIC_ACQUIRE);
+    size_t keyLength = (size_t)(lengths & UINT32_MAX);
+    size_t valueLength = (size_t)(lengths >> 32);
+    uint64_t payload = wordBytes((uint64_t)keyLength + valueLength);
+    int plausible = CHANGE_RECORD_HEADER_BYTES + payload <= feed->capacity / CHANGE_RECORD_MAX_SHARE;
+
+    // Copy the payload words, leaving room for the two terminators
+    if (plausible && cursor->bufferSize < payload + 2) {
+        size_t size = cursor->bufferSize == 0 ? 256 : cursor->bufferSize;
+        while (size < payload + 2) {
+            size *= 2;
+        }
+        char* buffer = (char*)realloc(cursor->buffer, size);
+        if (buffer == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        cursor->buffer = buffer;
+        cursor->bufferSize = size;
+    }
+    for (uint64_t offset = 0; plausible && offset < payload; offset += 8) {
+        uint64_t word = __atomic_load_n(ringWord(feed, position + CHANGE_RECORD_HEADER_BYTES + offset), __ATOMIC_ACQUIRE);
+        memcpy(cursor->buffer + offset, &word, 8);
+    }
+
+    // The copy is good only if no writer claimed these bytes again meanwhile
+    uint64_t reserved = __atomic_load_n(&feed->reserved, __ATOMIC_RELAXED);
+    if (reserved > position + feed->capacity || !plausible) {
+        return overrun(cursor, reserved);
+    }
+
+    // Split the payload into two strings
+    char* key = cursor->buffer;
+    memmove(key + keyLength + 1, key + keyLength, valueLength);
+    key[keyLength] = '\0';
+    key[keyLength + 1 + valueLength] = '\0';
+
+    record->op = (ChangeOp)(tag & CHANGE_TAG_OP_MASK);
+    record->sequence = position;
+    record->key = key;
+    record->keyLength = keyLength;
+    record->value = record->op == CHANGE_REMOVE ? NULL : key + keyLength + 1;
+    record->valueLength = valueLength;
+    cursor->position = position + CHANGE_RECORD_HEADER_BYTES + payload;
+    return CHANGE_FEED_RECORD;
+}
+
+/**
+ * @brief Bytes published that a cursor has not read yet.
+ * @details A cursor whose lag approaches ChangeFeed::capacity is about to be lapped; past it,
+ *          the next read reports CHANGE_FEED_OVERRUN.
+ * @param cursor Pointer to the cursor.
+ * @return Number of bytes.
+ */
+uint64_t changeFeedLag(const ChangeFeedCursor* cursor) {
+    return __atomic_load_n(&cursor->feed->reserved, __ATOMIC_RELAXED) - cursor->position;
+}
+
+/**
+ * @brief Frees the memory of a cursor.
+ * @param cursor Pointer to the cursor.
+ */
+void closeChangeFeedCursor(ChangeFeedCursor* cursor) {
+    free(cursor->buffer);
+    cursor->buffer = NULL;
+    cursor->bufferSize = 0;
+}
+
+/**
+ * @brief Frees the ring of a feed; no table may still publish to it.
+ * @param feed Pointer to the feed.
+ */
+void freeChangeFeed(ChangeFeed* feed) {
+    free(feed->words);
+    feed->words = NULL;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file change_feed.h
+ * @brief Lock-free feed of table mutations for consumers that follow a table.
+ *        Writers append one compact record per insertion or removal to a ring of bytes and
+ *        never wait: when the ring is full they overwrite the oldest records. Each consumer
+ *        reads from its own cursor and learns from readChangeFeed when writers lapped it, or
+ *        from changeFeedLag how close it came to that.
+ */
+
+#ifndef CHANGE_FEED_H
+#define CHANGE_FEED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Bytes of a record header: commit tag and lengths. */
+#define CHANGE_RECORD_HEADER_BYTES 16
+/** @brief Records longer than this fraction of the ring are dropped rather than written. */
+#define CHANGE_RECORD_MAX_SHARE 4
+
+/** @brief Result of readChangeFeed. */
+enum {
+    CHANGE_FEED_OVERRUN = -1, /**< Writers overwrote records the cursor had not read; it restarted at the newest position. */
+    CHANGE_FEED_EMPTY = 0, /**< No committed record at the cursor yet. */
+    CHANGE_FEED_RECORD = 1, /**< A record was read. */
+};
+
+/** @brief Kind of mutation a record describes. */
+typedef enum {
+    CHANGE_INSERT, /**< A pair was inserted. */
+    CHANGE_REMOVE, /**< A pair was removed, by a removal or an eviction; the record has no value. */
+    CHANGE_ADD, /**< The number of a key in a numeric table grew by the decimal value of the record. */
+} ChangeOp;
+
+/** @brief Ring of records shared by the writers of one or more tables. */
+typedef struct {
+    uint64_t* words; /**< Ring of 8-byte words holding the records. */
+    uint64_t capacity; /**< Size of the ring in bytes, a power of two. */
+    uint64_t reserved; /**< Bytes ever claimed by writers; the next record starts here. */
+    unsigned long droppedRecords; /**< Records too long for the ring, not written. */
+} ChangeFeed;
+
+/** @brief One record as returned by readChangeFeed. */
+typedef struct {
+    ChangeOp op; /**< Kind of mutation. */
+    uint64_t sequence; /**< Position of the record in the feed, increasing from record to record. */
+    const char* key; /**< Key of the pair, NUL terminated. */
+    size_t keyLength; /**< Length of the key. */
+    const char* value; /**< New value, NUL terminated, NULL for removals. */
+    size_t valueLength; /**< Length of the value, 0 for removals. */
+} ChangeRecord;
+
+/** @brief Read position of one consumer. */
+typedef struct {
+    const ChangeFeed* feed; /**< Feed being read. */
+    uint64_t position; /**< Position of the next record to read. */
+    unsigned long overruns; /**< Times writers lapped the cursor. */
+    uint64_t lostBytes; /**< Bytes of records skipped because of those overruns. */
+    char* buffer; /**< Copy of the last record read, which ChangeRecord points into. */
+    size_t bufferSize; /**< Size of the buffer. */
+} ChangeFeedCursor;
+
+/*  FUNCTION DECLARATIONS   */
+void initChangeFeed(ChangeFeed* feed, size_t capacity);
+void publishChange(ChangeFeed* feed, ChangeOp op, const char* key, size_t keyLength, const char* value, size_t valueLength);
+void openChangeFeedCursor(ChangeFeedCursor* cursor, const ChangeFeed* feed);
+int readChangeFeed(ChangeFeedCursor* cursor, ChangeRecord* record);
+uint64_t changeFeedLag(const ChangeFeedCursor* cursor);
+void closeChangeFeedCursor(ChangeFeedCursor* cursor);
+void freeChangeFeed(ChangeFeed* feed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHANGE_FEED_H */
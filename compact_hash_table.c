@@ -0,0 +1,308 @@
+/**
+ * @file compact_hash_table.c
+ * @brief Implementation of the compact Hash Table declared in compact_hash_table.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "compact_hash_table.h"
+
+/** @brief Index slot that never held an entry; probing stops here. */
+#define SLOT_EMPTY (-1)
+/** @brief Index slot whose entry was removed; probing continues past it. */
+#define SLOT_REMOVED (-2)
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Bytes per index slot able to hold every entry number below @p usable.
+ * @param usable Number of entries the array holds.
+ * @return 1, 2 or 4.
+ */
+static int slotWidth(int usable) {
+    if (usable <= INT8_MAX) {
+        return 1;
+    }
+    return usable <= INT16_MAX ? 2 : 4;
+}
+
+/**
+ * @brief Reads an index slot.
+ * @param ct Pointer to the compact hash table.
+ * @param slot Slot number.
+ * @return Entry number, SLOT_EMPTY or SLOT_REMOVED.
+ */
+static int readSlot(const CompactHashTable* ct, size_t slot) {
+    switch (ct->indexWidth) {
+    case 1:
+        return ((const int8_t*)ct->index)[slot];
+    case 2:
+        return ((const int16_t*)ct->index)[slot];
+    default:
+        return ((const int32_t*)ct->index)[slot];
+    }
+}
+
+/**
+ * @brief Writes an index slot.
+ * @param ct Pointer to the compact hash table.
+ * @param slot Slot number.
+ * @param value Entry number, SLOT_EMPTY or SLOT_REMOVED.
+ */
+static void writeSlot(CompactHashTable* ct, size_t slot, int value) {
+    switch (ct->indexWidth) {
+    case 1:
+        ((int8_t*)ct->index)[slot] = (int8_t)value;
+        break;
+    case 2:
+        ((int16_t*)ct->index)[slot] = (int16_t)value;
+        break;
+    default:
+        ((int32_t*)ct->index)[slot] = (int32_t)value;
+        break;
+    }
+}
+
+/**
+ * @brief First slot probed for a hash.
+ * @details The Fibonacci multiply keeps the high bits, which depend on every bit of the hash.
+ * @param ct Pointer to the compact hash table.
+ * @param hash Full hash of the key.
+ * @return Slot number.
+ */
+static size_t firstSlot(const CompactHashTable* ct, unsigned int hash) {
+    return (size_t)((hash * 2654435769u) >> (32 - ct->indexBits));
+}
+
+/**
+ * @brief Finds the index slot pointing at a key.
+ * @param ct Pointer to the compact hash table.
+ * @param hash Full hash of the key.
+ * @param key Key to look for.
+ * @return Slot number, or -1 if the key is absent.
+ */
+static long findSlot(const CompactHashTable* ct, unsigned int hash, const char* key) {
+    size_t mask = ((size_t)1 << ct->indexBits) - 1;
+
+    // Linear probing, the index stays under 2/3 full so an empty slot always ends the walk
+    for (size_t slot = firstSlot(ct, hash);; slot = (slot + 1) & mask) {
+        int entry = readSlot(ct, slot);
+        if (entry == SLOT_EMPTY) {
+            return -1;
+        }
+        if (entry >= 0 && ct->entries[entry].hash == hash && strcmp(ct->entries[entry].pair, key) == 0) {
+            return (long)slot;
+        }
+    }
+}
+
+/**
+ * @brief Points a free slot along the probe sequence of a hash at an entry.
+ * @param ct Pointer to the compact hash table.
+ * @param hash Full hash of the key, which must not be in the index yet.
+ * @param entry Entry number.
+ */
+static void placeEntry(CompactHashTable* ct, unsigned int hash, int entry) {
+    size_t mask = ((size_t)1 << ct->indexBits) - 1;
+    size_t slot = firstSlot(ct, hash);
+    while (readSlot(ct, slot) >= 0) {
+        slot = (slot + 1) & mask;
+    }
+    writeSlot(ct, slot, entry);
+}
+
+/**
+ * @brief Rebuilds the table with room for at least @p minimumSize pairs.
+ * @details Live entries are packed to the front in insertion order, dropping the holes
+ *          left by removals, and the index is recreated at the narrowest width that fits.
+ * @param ct Pointer to the compact hash table.
+ * @param minimumSize Number of pairs the new table must hold.
+ */
+static void rebuildCompactHashTable(CompactHashTable* ct, int minimumSize) {
+    int bits = 3;
+    while ((1 << bits) < COMPACT_MIN_SLOTS || (1 << bits) * 2 / 3 < minimumSize) {
+        bits++;
+    }
+    int usable = (1 << bits) * 2 / 3;
+    int width = slotWidth(usable);
+
+    // Pack the live entries into the new array
+    CompactEntry* entries = (CompactEntry*)malloc(sizeof(CompactEntry) * usable);
+    void* index = malloc((size_t)width << bits);
+    if (entries == NULL || index == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    int used = 0;
+    for (int i = 0; i < ct->used; ++i) {
+        if (ct->entries[i].pair != NULL) {
+            entries[used++] = ct->entries[i];
+        }
+    }
+    free(ct->entries);
+    free(ct->index);
+
+    // All bits set reads back as SLOT_EMPTY at every width
+    memset(index, 0xFF, (size_t)width << bits);
+    ct->index = index;
+    ct->indexWidth = width;
+    ct->indexBits = bits;
+    ct->entries = entries;
+    ct->usable = usable;
+    ct->used = used;
+    for (int i = 0; i < used; ++i) {
+        placeEntry(ct, entries[i].hash, i);
+    }
+}
+
+/**
+ * @brief Copies a key and a value into one allocation.
+ * @param key Key of the pair.
+ * @param value Value associated with the key.
+ * @param valueOffset Receives the offset of the value.
+ * @param bytes Receives the size of the allocation.
+ * @return The key, its terminator, then the value.
+ */
+static char* makePair(const char* key, const char* value, unsigned int* valueOffset, size_t* bytes) {
+    size_t keyBytes = strlen(key) + 1;
+    size_t valueBytes = strlen(value) + 1;
+    char* pair = (char*)malloc(keyBytes + valueBytes);
+    if (pair == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(pair, key, keyBytes);
+    memcpy(pair + keyBytes, value, valueBytes);
+    *valueOffset = (unsigned int)keyBytes;
+    *bytes = keyBytes + valueBytes;
+    return pair;
+}
+
+/**
+ * @brief Initializes a compact hash table.
+ * @param ct Pointer to the compact hash table to be initialized.
+ * @param capacity Number of pairs to make room for.
+ */
+void initCompactHashTable(CompactHashTable* ct, int capacity) {
+    ct->index = NULL;
+    ct->entries = NULL;
+    ct->used = 0;
+    ct->size = 0;
+    ct->stringBytes = 0;
+    rebuildCompactHashTable(ct, capacity);
+}
+
+/**
+ * @brief Inserts a key-value pair, or replaces the value of a key already present.
+ * @details A replaced value keeps the original position of its key in the iteration order.
+ * @param ct Pointer to the compact hash table.
+ * @param key Key of the pair.
+ * @param value Value associated with the key.
+ */
+void insertCompactKeyValPair(CompactHashTable* ct, const char* key, const char* value) {
+    unsigned int hash = hashKey(key);
+    unsigned int valueOffset;
+    size_t bytes;
+
+    long slot = findSlot(ct, hash, key);
+    if (slot >= 0) {
+        CompactEntry* entry = &ct->entries[readSlot(ct, (size_t)slot)];
+        ct->stringBytes -= entry->valueOffset + strlen(entry->pair + entry->valueOffset) + 1;
+        free(entry->pair);
+        entry->pair = makePair(key, value, &valueOffset, &bytes);
+        entry->valueOffset = valueOffset;
+        ct->stringBytes += bytes;
+        return;
+    }
+
+    // Rebuild once the entry array is full; leaving a third of the new array free keeps
+    // rebuilds amortized even when most of the old one was holes
+    if (ct->used == ct->usable) {
+        rebuildCompactHashTable(ct, ct->size + ct->size / 2 + 1);
+    }
+    CompactEntry* entry = &ct->entries[ct->used];
+    entry->pair = makePair(key, value, &valueOffset, &bytes);
+    entry->hash = hash;
+    entry->valueOffset = valueOffset;
+    placeEntry(ct, hash, ct->used);
+    ct->used++;
+    ct->size++;
+    ct->stringBytes += bytes;
+}
+
+/**
+ * @brief Removes a key-value pair, shrinking the table when it gets mostly empty.
+ * @param ct Pointer to the compact hash table.
+ * @param key Key of the pair to be removed.
+ */
+void removeCompactKeyValPair(CompactHashTable* ct, const char* key) {
+    long slot = findSlot(ct, hashKey(key), key);
+    if (slot < 0) {
+        return;
+    }
+
+    // Leave a hole in the entries, and a marker in the index so probing goes on past it
+    CompactEntry* entry = &ct->entries[readSlot(ct, (size_t)slot)];
+    ct->stringBytes -= entry->valueOffset + strlen(entry->pair + entry->valueOffset) + 1;
+    free(entry->pair);
+    entry->pair = NULL;
+    writeSlot(ct, (size_t)slot, SLOT_REMOVED);
+    ct->size--;
+
+    if (ct->size < ct->usable / 8 && (1 << ct->indexBits) > COMPACT_MIN_SLOTS) {
+        rebuildCompactHashTable(ct, ct->size + ct->size / 2);
+    }
+}
+
+/**
+ * @brief Looks up the value associated with a given key.
+ * @param ct Pointer to the compact hash table.
+ * @param key Key to look up.
+ * @return Value associated with the key, or NULL if not found.
+ */
+const char* lookup_compactHashTable(const CompactHashTable* ct, const char* key) {
+    long slot = findSlot(ct, hashKey(key), key);
+    if (slot < 0) {
+        return NULL;
+    }
+    const CompactEntry* entry = &ct->entries[readSlot(ct, (size_t)slot)];
+    return entry->pair + entry->valueOffset;
+}
+
+/**
+ * @brief Calls @p visit for every pair, in insertion order.
+ * @param ct Pointer to the compact hash table.
+ * @param visit Function called with each key and value.
+ * @param context Opaque pointer passed to @p visit.
+ */
+void forEachCompactPair(const CompactHashTable* ct, void (*visit)(const char* key, const char* value, void* context), void* context) {
+    for (int i = 0; i < ct->used; ++i) {
+        const CompactEntry* entry = &ct->entries[i];
+        if (entry->pair != NULL) {
+            visit(entry->pair, entry->pair + entry->valueOffset, context);
+        }
+    }
+}
+
+/**
+ * @brief Every byte the table allocated: index, entry array and pair strings.
+ * @param ct Pointer to the compact hash table.
+ * @return Number of bytes.
+ */
+size_t compactHashTableMemoryBytes(const CompactHashTable* ct) {
+    return ((size_t)ct->indexWidth << ct->indexBits) + sizeof(CompactEntry) * ct->usable + ct->stringBytes;
+}
+
+/**
+ * @brief Frees the memory allocated for the table and its pairs.
+ * @param ct Pointer to the compact hash table to be freed.
+ */
+void freeCompactHashTable(CompactHashTable* ct) {
+    for (int i = 0; i < ct->used; ++i) {
+        free(ct->entries[i].pair);
+    }
+    free(ct->entries);
+    free(ct->index);
+}
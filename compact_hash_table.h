@@ -0,0 +1,54 @@
+/**
+ * @file compact_hash_table.h
+ * @brief Insertion-ordered Hash Table with a compact layout.
+ *        Pairs live in a dense, append-only array of entries; a separate open-addressing
+ *        index maps hashes to entry numbers using 1, 2 or 4 bytes per slot depending on
+ *        its size. Iteration walks the entries in insertion order.
+ */
+
+#ifndef COMPACT_HASH_TABLE_H
+#define COMPACT_HASH_TABLE_H
+
+#include <stddef.h>
+#include "hash_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Smallest number of index slots. */
+#define COMPACT_MIN_SLOTS 8
+
+/** @brief One pair; the key and value share a single allocation. */
+typedef struct {
+    char* pair; /**< Key, its terminator, then the value; NULL once the pair is removed. */
+    unsigned int hash; /**< Full hash of the key. */
+    unsigned int valueOffset; /**< Offset of the value inside pair. */
+} CompactEntry;
+
+/** @brief Structure representing the compact Hash Table. */
+typedef struct {
+    void* index; /**< Entry number of each slot, indexWidth bytes each. */
+    int indexWidth; /**< 1, 2 or 4 bytes per slot. */
+    int indexBits; /**< log2 of the number of slots. */
+    CompactEntry* entries; /**< Pairs in insertion order, with holes left by removals. */
+    int usable; /**< Entries the array holds before the table is rebuilt, 2/3 of the slots. */
+    int used; /**< Entries appended so far, holes included. */
+    int size; /**< Number of live pairs. */
+    size_t stringBytes; /**< Bytes allocated for the pair strings. */
+} CompactHashTable;
+
+/*  FUNCTION DECLARATIONS   */
+void initCompactHashTable(CompactHashTable* ct, int capacity);
+void insertCompactKeyValPair(CompactHashTable* ct, const char* key, const char* value);
+void removeCompactKeyValPair(CompactHashTable* ct, const char* key);
+const char* lookup_compactHashTable(const CompactHashTable* ct, const char* key);
+void forEachCompactPair(const CompactHashTable* ct, void (*visit)(const char* key, const char* value, void* context), void* context);
+size_t compactHashTableMemoryBytes(const CompactHashTable* ct);
+void freeCompactHashTable(CompactHashTable* ct);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPACT_HASH_TABLE_H */
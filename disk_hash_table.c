@@ -0,0 +1,572 @@
+/**
+ * @file disk_hash_table.c
+ * @brief Implementation of the disk-backed Hash Table declared in disk_hash_table.h.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "disk_hash_table.h"
+
+/** @brief Start of every page. */
+typedef struct {
+    uint32_t next; /**< Next page of the chain, DISK_NO_PAGE for the last one. */
+    uint16_t count; /**< Number of records in the page. */
+    uint16_t used; /**< Bytes of records, packed from the start of the payload. */
+} PageHeader;
+
+/** @brief Start of every record, followed by the key and the value without terminators. */
+typedef struct {
+    uint32_t hash; /**< Full hash of the key. */
+    uint16_t keyLength; /**< Key length. */
+    uint16_t valueLength; /**< Value length. */
+} RecordHeader;
+
+/** @brief Bytes of records a page holds. */
+#define PAGE_PAYLOAD (DISK_PAGE_SIZE - sizeof(PageHeader))
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Header of a page held by a frame.
+ * @param dt Pointer to the disk hash table.
+ * @param frame Frame number.
+ * @return The page header.
+ */
+static PageHeader* pageHeader(const DiskHashTable* dt, int frame) {
+    return (PageHeader*)dt->frames[frame].data;
+}
+
+/**
+ * @brief Records of a page held by a frame.
+ * @param dt Pointer to the disk hash table.
+ * @param frame Frame number.
+ * @return First byte of the payload.
+ */
+static unsigned char* pagePayload(const DiskHashTable* dt, int frame) {
+    return dt->frames[frame].data + sizeof(PageHeader);
+}
+
+/**
+ * @brief Reads a page from the file into a frame.
+ * @param dt Pointer to the disk hash table.
+ * @param frame Frame receiving the page.
+ * @param page Page number.
+ */
+static void readPage(DiskHashTable* dt, int frame, uint32_t page) {
+    unsigned char* data = dt->frames[frame].data;
+    size_t done = 0;
+    while (done < DISK_PAGE_SIZE) {
+        ssize_t count = pread(dt->fd, data + done, DISK_PAGE_SIZE - done, (off_t)page * DISK_PAGE_SIZE + done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            perror("Error in pread");
+            exit(EXIT_FAILURE);
+        }
+        if (count == 0) {
+            // Past the end of the file; never-written pages read back as empty
+            memset(data + done, 0, DISK_PAGE_SIZE - done);
+            break;
+        }
+        done += (size_t)count;
+    }
+}
+
+/**
+ * @brief Writes the page held by a frame back to the file.
+ * @param dt Pointer to the disk hash table.
+ * @param frame Frame number.
+ */
+static void writePage(DiskHashTable* dt, int frame) {
+    DiskFrame* f = &dt->frames[frame];
+    size_t done = 0;
+    while (done < DISK_PAGE_SIZE) {
+        ssize_t count = pwrite(dt->fd, f->data + done, DISK_PAGE_SIZE - done, (off_t)f->page * DISK_PAGE_SIZE + done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            perror("Error in pwrite");
+            exit(EXIT_FAILURE);
+        }
+        done += (size_t)count;
+    }
+    f->dirty = 0;
+    dt->pageWrites++;
+}
+
+/**
+ * @brief Picks the frame to reuse with the CLOCK algorithm and writes it back if needed.
+ * @details The hand skips pinned frames and gives each referenced frame a second chance by
+ *          clearing its bit, so two full turns always reach an unpinned frame if one exists.
+ * @param dt Pointer to the disk hash table.
+ * @return A frame holding no page.
+ */
+static int victimFrame(DiskHashTable* dt) {
+    for (int step = 0; step < 2 * dt->frameCount; ++step) {
+        int frame = dt->clockHand;
+        DiskFrame* f = &dt->frames[frame];
+        dt->clockHand = (dt->clockHand + 1) % dt->frameCount;
+        if (f->pins > 0) {
+            continue;
+        }
+        if (f->referenced) {
+            f->referenced = 0;
+            continue;
+        }
+        if (f->page != DISK_NO_PAGE) {
+            if (f->dirty) {
+                writePage(dt, frame);
+            }
+            dt->frameOfPage[f->page] = -1;
+            f->page = DISK_NO_PAGE;
+        }
+        return frame;
+    }
+    fprintf(stderr, "Buffer pool exhausted: every frame is pinned\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Pins a page in the buffer pool, reading it from the file on a miss.
+ * @param dt Pointer to the disk hash table.
+ * @param page Page number.
+ * @param fresh The page was just allocated; it is initialized empty instead of being read.
+ * @return Frame holding the page, to be released with releasePage.
+ */
+static int fetchPage(DiskHashTable* dt, uint32_t page, int fresh) {
+    int frame = dt->frameOfPage[page];
+    if (frame >= 0) {
+        dt->cacheHits += !fresh;
+    } else {
+        frame = victimFrame(dt);
+        if (!fresh) {
+            readPage(dt, frame, page);
+            dt->cacheMisses++;
+        }
+        dt->frames[frame].page = page;
+        dt->frameOfPage[page] = frame;
+    }
+
+    DiskFrame* f = &dt->frames[frame];
+    f->pins++;
+    f->referenced = 1;
+    if (fresh) {
+        memset(f->data, 0, DISK_PAGE_SIZE);
+        pageHeader(dt, frame)->next = DISK_NO_PAGE;
+        f->dirty = 1;
+    }
+    return frame;
+}
+
+/**
+ * @brief Unpins a page.
+ * @param dt Pointer to the disk hash table.
+ * @param frame Frame returned by fetchPage.
+ * @param dirty The page was modified.
+ */
+static void releasePage(DiskHashTable* dt, int frame, int dirty) {
+    dt->frames[frame].pins--;
+    dt->frames[frame].dirty |= dirty;
+}
+
+/**
+ * @brief Takes a page from the free list, or grows the file by one page.
+ * @param dt Pointer to the disk hash table.
+ * @return Page number, to be fetched fresh.
+ */
+static uint32_t allocatePage(DiskHashTable* dt) {
+    if (dt->freeCount > 0) {
+        return dt->freePages[--dt->freeCount];
+    }
+    if (dt->pageCount == dt->pageSlots) {
+        uint32_t slots = dt->pageSlots > 0 ? dt->pageSlots * 2 : 64;
+        int32_t* frameOfPage = (int32_t*)realloc(dt->frameOfPage, sizeof(int32_t) * slots);
+        if (frameOfPage == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        for (uint32_t page = dt->pageSlots; page < slots; ++page) {
+            frameOfPage[page] = -1;
+        }
+        dt->frameOfPage = frameOfPage;
+        dt->pageSlots = slots;
+    }
+    return dt->pageCount++;
+}
+
+/**
+ * @brief Returns a page to the free list.
+ * @param dt Pointer to the disk hash table.
+ * @param page Page number, no longer linked from any chain.
+ */
+static void freePage(DiskHashTable* dt, uint32_t page) {
+    if (dt->freeCount == dt->freeSlots) {
+        uint32_t slots = dt->freeSlots > 0 ? dt->freeSlots * 2 : 16;
+        uint32_t* freePages = (uint32_t*)realloc(dt->freePages, sizeof(uint32_t) * slots);
+        if (freePages == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        dt->freePages = freePages;
+        dt->freeSlots = slots;
+    }
+    dt->freePages[dt->freeCount++] = page;
+}
+
+/**
+ * @brief Calculates the container a hash belongs to.
+ * @param dt Pointer to the disk hash table.
+ * @param hash Full hash of the key.
+ * @return Container number.
+ */
+static unsigned int bucketIndex(const DiskHashTable* dt, unsigned int hash) {
+    unsigned int index = hash & (dt->roundBuckets - 1);
+    if (index < dt->split) {
+        index = hash & (2 * dt->roundBuckets - 1);
+    }
+    return index;
+}
+
+/**
+ * @brief Size of a record, header included.
+ * @param record First byte of the record.
+ * @return Number of bytes.
+ */
+static size_t recordSize(const unsigned char* record) {
+    RecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    return sizeof(header) + header.keyLength + header.valueLength;
+}
+
+/**
+ * @brief Finds a key among the records of a page.
+ * @param payload First byte of the payload.
+ * @param used Bytes of records in the payload.
+ * @param hash Full hash of the key.
+ * @param key Key to look for.
+ * @param keyLength Length of the key.
+ * @return Offset of the record in the payload, or -1 if the key is absent.
+ */
+static long findInPage(const unsigned char* payload, size_t used, unsigned int hash, const char* key, size_t keyLength) {
+    for (size_t offset = 0; offset < used;) {
+        RecordHeader header;
+        memcpy(&header, payload + offset, sizeof(header));
+        if (header.hash == hash && header.keyLength == keyLength &&
+            memcmp(payload + offset + sizeof(header), key, keyLength) == 0) {
+            return (long)offset;
+        }
+        offset += sizeof(header) + header.keyLength + header.valueLength;
+    }
+    return -1;
+}
+
+/**
+ * @brief Appends a record to the first page of a chain with room for it.
+ * @details A new overflow page is linked at the end of the chain when every page is full.
+ * @param dt Pointer to the disk hash table.
+ * @param bucket Container number.
+ * @param record Record, header included.
+ * @param bytes Size of the record, at most PAGE_PAYLOAD.
+ */
+static void appendRecord(DiskHashTable* dt, unsigned int bucket, const unsigned char* record, size_t bytes) {
+    uint32_t page = dt->bucketPages[bucket];
+    int fresh = 0;
+    for (;;) {
+        int frame = fetchPage(dt, page, fresh);
+        PageHeader* header = pageHeader(dt, frame);
+        if (PAGE_PAYLOAD - header->used >= bytes) {
+            memcpy(pagePayload(dt, frame) + header->used, record, bytes);
+            header->count++;
+            header->used = (uint16_t)(header->used + bytes);
+            releasePage(dt, frame, 1);
+            return;
+        }
+        if (header->next == DISK_NO_PAGE) {
+            header->next = allocatePage(dt);
+            fresh = 1;
+        }
+        page = header->next;
+        releasePage(dt, frame, fresh);
+    }
+}
+
+/**
+ * @brief Splits the next container of the round, advancing the split pointer.
+ * @details The records of the chain are gathered in memory, its overflow pages are freed,
+ *          and each record is appended again to the old container or to the new one.
+ * @param dt Pointer to the disk hash table.
+ */
+static void splitBucket(DiskHashTable* dt) {
+    unsigned int from = dt->split;
+    unsigned int to = dt->roundBuckets + dt->split;
+    unsigned char* records = NULL;
+    size_t recordsBytes = 0;
+
+    // Gather the records, emptying the first page and releasing the others
+    for (uint32_t page = dt->bucketPages[from]; page != DISK_NO_PAGE;) {
+        int frame = fetchPage(dt, page, 0);
+        PageHeader* header = pageHeader(dt, frame);
+        unsigned char* grown = (unsigned char*)realloc(records, recordsBytes + header->used + 1);
+        if (grown == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        records = grown;
+        memcpy(records + recordsBytes, pagePayload(dt, frame), header->used);
+        recordsBytes += header->used;
+
+        uint32_t next = header->next;
+        if (page == dt->bucketPages[from]) {
+            header->next = DISK_NO_PAGE;
+            header->count = 0;
+            header->used = 0;
+            releasePage(dt, frame, 1);
+        } else {
+            releasePage(dt, frame, 0);
+            freePage(dt, page);
+        }
+        page = next;
+    }
+
+    // The new container gets a page of its own
+    if (to == dt->bucketSlots) {
+        unsigned int slots = dt->bucketSlots * 2;
+        uint32_t* bucketPages = (uint32_t*)realloc(dt->bucketPages, sizeof(uint32_t) * slots);
+        if (bucketPages == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        dt->bucketPages = bucketPages;
+        dt->bucketSlots = slots;
+    }
+    dt->bucketPages[to] = allocatePage(dt);
+    releasePage(dt, fetchPage(dt, dt->bucketPages[to], 1), 1);
+
+    dt->split++;
+    dt->bucketCount++;
+    if (dt->split == dt->roundBuckets) {
+        dt->roundBuckets *= 2;
+        dt->split = 0;
+    }
+
+    for (size_t offset = 0; offset < recordsBytes;) {
+        RecordHeader header;
+        memcpy(&header, records + offset, sizeof(header));
+        size_t bytes = recordSize(records + offset);
+        appendRecord(dt, bucketIndex(dt, header.hash), records + offset, bytes);
+        offset += bytes;
+    }
+    free(records);
+}
+
+/**
+ * @brief Initializes a disk hash table backed by a new file.
+ * @details The file is opened with O_DIRECT when the file system supports it, so that the
+ *          buffer pool alone decides what stays in memory.
+ * @param dt Pointer to the disk hash table to be initialized.
+ * @param path Path of the page file, created or truncated.
+ * @param capacity Initial number of containers, rounded up to a power of two.
+ * @param cachePages Number of pages the buffer pool holds, at least DISK_MIN_FRAMES.
+ */
+void initDiskHashTable(DiskHashTable* dt, const char* path, int capacity, int cachePages) {
+    dt->directIo = 1;
+    dt->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_DIRECT, 0600);
+    if (dt->fd < 0 && errno == EINVAL) {
+        dt->directIo = 0;
+        dt->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    }
+    if (dt->fd < 0) {
+        perror("Error opening page file");
+        exit(EXIT_FAILURE);
+    }
+    dt->path = strdup(path);
+
+    // Page memory is aligned to the page size, as direct I/O requires
+    dt->frameCount = cachePages > DISK_MIN_FRAMES ? cachePages : DISK_MIN_FRAMES;
+    dt->frameData = (unsigned char*)aligned_alloc(DISK_PAGE_SIZE, (size_t)dt->frameCount * DISK_PAGE_SIZE);
+    dt->frames = (DiskFrame*)calloc(dt->frameCount, sizeof(DiskFrame));
+    if (dt->path == NULL || dt->frameData == NULL || dt->frames == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    for (int frame = 0; frame < dt->frameCount; ++frame) {
+        dt->frames[frame].data = dt->frameData + (size_t)frame * DISK_PAGE_SIZE;
+        dt->frames[frame].page = DISK_NO_PAGE;
+    }
+    dt->clockHand = 0;
+    dt->frameOfPage = NULL;
+    dt->pageCount = 0;
+    dt->pageSlots = 0;
+    dt->freePages = NULL;
+    dt->freeCount = 0;
+    dt->freeSlots = 0;
+
+    unsigned int buckets = 1;
+    while (buckets < (unsigned int)capacity) {
+        buckets *= 2;
+    }
+    dt->bucketPages = (uint32_t*)malloc(sizeof(uint32_t) * buckets);
+    if (dt->bucketPages == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned int bucket = 0; bucket < buckets; ++bucket) {
+        dt->bucketPages[bucket] = allocatePage(dt);
+        releasePage(dt, fetchPage(dt, dt->bucketPages[bucket], 1), 1);
+    }
+    dt->bucketSlots = buckets;
+    dt->roundBuckets = buckets;
+    dt->split = 0;
+    dt->bucketCount = buckets;
+    dt->size = 0;
+    dt->recordBytes = 0;
+    dt->cacheHits = 0;
+    dt->cacheMisses = 0;
+    dt->pageWrites = 0;
+}
+
+/**
+ * @brief Inserts a key-value pair, splitting one container when the load factor is exceeded.
+ * @details The load factor counts record bytes against the payload of one page per container.
+ * @param dt Pointer to the disk hash table.
+ * @param key Key of the pair.
+ * @param value Value associated with the key.
+ * @return 1 if the pair was inserted, 0 if it does not fit in a page.
+ */
+int insertDiskKeyValPair(DiskHashTable* dt, const char* key, const char* value) {
+    unsigned char record[DISK_PAGE_SIZE];
+    size_t keyLength = strlen(key);
+    size_t valueLength = strlen(value);
+    size_t bytes = sizeof(RecordHeader) + keyLength + valueLength;
+    if (bytes > PAGE_PAYLOAD) {
+        return 0;
+    }
+
+    RecordHeader header = { hashKey(key), (uint16_t)keyLength, (uint16_t)valueLength };
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), key, keyLength);
+    memcpy(record + sizeof(header) + keyLength, value, valueLength);
+    appendRecord(dt, bucketIndex(dt, header.hash), record, bytes);
+    dt->size++;
+    dt->recordBytes += bytes;
+
+    if (dt->recordBytes > LOAD_FACTOR_THRESHOLD * dt->bucketCount * PAGE_PAYLOAD) {
+        splitBucket(dt);
+    }
+    return 1;
+}
+
+/**
+ * @brief Removes a key-value pair.
+ * @details The page is compacted in place; an overflow page left empty is unlinked and
+ *          reused by later growth. Containers are never merged back.
+ * @param dt Pointer to the disk hash table.
+ * @param key Key of the pair to be removed.
+ */
+void removeDiskKeyValPair(DiskHashTable* dt, const char* key) {
+    unsigned int hash = hashKey(key);
+    size_t keyLength = strlen(key);
+    uint32_t previous = DISK_NO_PAGE;
+
+    for (uint32_t page = dt->bucketPages[bucketIndex(dt, hash)]; page != DISK_NO_PAGE;) {
+        int frame = fetchPage(dt, page, 0);
+        PageHeader* header = pageHeader(dt, frame);
+        unsigned char* payload = pagePayload(dt, frame);
+        long offset = findInPage(payload, header->used, hash, key, keyLength);
+        if (offset < 0) {
+            previous = page;
+            page = header->next;
+            releasePage(dt, frame, 0);
+            continue;
+        }
+
+        // Close the gap left by the record
+        size_t bytes = recordSize(payload + offset);
+        memmove(payload + offset, payload + offset + bytes, header->used - offset - bytes);
+        header->used = (uint16_t)(header->used - bytes);
+        header->count--;
+        dt->size--;
+        dt->recordBytes -= bytes;
+
+        uint32_t next = header->next;
+        int unlink = header->count == 0 && previous != DISK_NO_PAGE;
+        releasePage(dt, frame, 1);
+        if (unlink) {
+            int previousFrame = fetchPage(dt, previous, 0);
+            pageHeader(dt, previousFrame)->next = next;
+            releasePage(dt, previousFrame, 1);
+            freePage(dt, page);
+        }
+        return;
+    }
+}
+
+/**
+ * @brief Looks up a key and copies its value into a caller buffer.
+ * @details Each page of the chain costs at most one read when it is not in the pool; chains
+ *          are a single page unless a container overflowed, so a miss usually costs one read.
+ * @param dt Pointer to the disk hash table.
+ * @param key Key to look up.
+ * @param buffer Buffer receiving the value, always terminated when not empty.
+ * @param bufferSize Size of the buffer, longer values are truncated.
+ * @return Length of the whole value, or -1 if the key was not found.
+ */
+int lookup_diskHashTable(DiskHashTable* dt, const char* key, char* buffer, size_t bufferSize) {
+    unsigned int hash = hashKey(key);
+    size_t keyLength = strlen(key);
+
+    for (uint32_t page = dt->bucketPages[bucketIndex(dt, hash)]; page != DISK_NO_PAGE;) {
+        int frame = fetchPage(dt, page, 0);
+        PageHeader* header = pageHeader(dt, frame);
+        const unsigned char* payload = pagePayload(dt, frame);
+        long offset = findInPage(payload, header->used, hash, key, keyLength);
+        if (offset >= 0) {
+            RecordHeader record;
+            memcpy(&record, payload + offset, sizeof(record));
+            if (bufferSize > 0) {
+                size_t copy = record.valueLength < bufferSize - 1 ? record.valueLength : bufferSize - 1;
+                memcpy(buffer, payload + offset + sizeof(record) + record.keyLength, copy);
+                buffer[copy] = '\0';
+            }
+            releasePage(dt, frame, 0);
+            return record.valueLength;
+        }
+        page = header->next;
+        releasePage(dt, frame, 0);
+    }
+    return -1;
+}
+
+/**
+ * @brief Writes every modified page of the buffer pool back to the file.
+ * @param dt Pointer to the disk hash table.
+ */
+void flushDiskHashTable(DiskHashTable* dt) {
+    for (int frame = 0; frame < dt->frameCount; ++frame) {
+        if (dt->frames[frame].page != DISK_NO_PAGE && dt->frames[frame].dirty) {
+            writePage(dt, frame);
+        }
+    }
+}
+
+/**
+ * @brief Closes and removes the page file and frees the memory of the table.
+ * @param dt Pointer to the disk hash table to be freed.
+ */
+void freeDiskHashTable(DiskHashTable* dt) {
+    close(dt->fd);
+    unlink(dt->path);
+    free(dt->path);
+    free(dt->frames);
+    free(dt->frameData);
+    free(dt->frameOfPage);
+    free(dt->freePages);
+    free(dt->bucketPages);
+}
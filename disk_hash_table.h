@@ -0,0 +1,78 @@
+/**
+ * @file disk_hash_table.h
+ * @brief Hash Table whose containers live in fixed-size pages of a file.
+ *        Each container is a chain of pages, normally a single one, grown by linear hashing
+ *        so the chains stay short. A bounded buffer pool keeps the hot pages in memory and
+ *        picks the pages to evict with the CLOCK algorithm; only the bucket directory and
+ *        the pool are held in memory, so the table can grow well past RAM.
+ *        The file is scratch space: it is truncated on init, removed on free, and holds
+ *        nothing needed to reopen the table.
+ */
+
+#ifndef DISK_HASH_TABLE_H
+#define DISK_HASH_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hash_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Size of a page, and of every read and write on the file. */
+#define DISK_PAGE_SIZE 4096
+/** @brief Page number marking the end of a chain, or a free frame. */
+#define DISK_NO_PAGE UINT32_MAX
+/** @brief Smallest buffer pool; a split keeps up to three pages pinned at once. */
+#define DISK_MIN_FRAMES 4
+
+/** @brief One page slot of the buffer pool. */
+typedef struct {
+    unsigned char* data; /**< DISK_PAGE_SIZE bytes, aligned for direct I/O. */
+    uint32_t page; /**< Page held by the frame, DISK_NO_PAGE when free. */
+    int pins; /**< Users of the frame; a pinned frame is never evicted. */
+    int referenced; /**< CLOCK bit, set on every access and cleared as the hand passes. */
+    int dirty; /**< The frame differs from the page on disk. */
+} DiskFrame;
+
+/** @brief Structure representing the disk-backed Hash Table. */
+typedef struct {
+    char* path; /**< Path of the page file. */
+    int fd; /**< Page file descriptor. */
+    int directIo; /**< The file was opened with O_DIRECT, bypassing the kernel page cache. */
+    DiskFrame* frames; /**< Buffer pool. */
+    unsigned char* frameData; /**< Page memory of all frames, one allocation. */
+    int frameCount; /**< Number of frames. */
+    int clockHand; /**< Next frame the CLOCK hand inspects. */
+    int32_t* frameOfPage; /**< Frame holding each page, -1 when the page is not cached. */
+    uint32_t pageCount; /**< Pages in the file. */
+    uint32_t pageSlots; /**< Capacity of frameOfPage. */
+    uint32_t* freePages; /**< Pages released by shrinking chains, reused before growing the file. */
+    uint32_t freeCount; /**< Number of free pages. */
+    uint32_t freeSlots; /**< Capacity of freePages. */
+    uint32_t* bucketPages; /**< First page of each container. */
+    unsigned int bucketSlots; /**< Capacity of bucketPages. */
+    unsigned int roundBuckets; /**< Containers at the start of the current round, a power of two. */
+    unsigned int split; /**< Next container to split in the current round. */
+    unsigned int bucketCount; /**< roundBuckets + split. */
+    int size; /**< Number of key-value pairs. */
+    size_t recordBytes; /**< Bytes of all records, headers included. */
+    unsigned long long cacheHits; /**< Page accesses served by the pool. */
+    unsigned long long cacheMisses; /**< Page accesses that had to read the file. */
+    unsigned long long pageWrites; /**< Dirty pages written back to the file. */
+} DiskHashTable;
+
+/*  FUNCTION DECLARATIONS   */
+void initDiskHashTable(DiskHashTable* dt, const char* path, int capacity, int cachePages);
+int insertDiskKeyValPair(DiskHashTable* dt, const char* key, const char* value);
+void removeDiskKeyValPair(DiskHashTable* dt, const char* key);
+int lookup_diskHashTable(DiskHashTable* dt, const char* key, char* buffer, size_t bufferSize);
+void flushDiskHashTable(DiskHashTable* dt);
+void freeDiskHashTable(DiskHashTable* dt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_HASH_TABLE_H */
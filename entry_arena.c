@@ -0,0 +1,358 @@
+/**
+ * @file entry_arena.c
+ * @brief Implementation of the string arenas declared in entry_arena.h.
+ *        Arenas are mapped at an address aligned to their size, so the arena a string belongs
+ *        to is found by masking its address and searching the sorted array of arenas; heap
+ *        strings simply match no arena.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "entry_arena.h"
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Rounds a string size up to whole 8-byte words, keeping every string aligned.
+ * @param bytes Size of the string, terminator included.
+ * @return Bytes carved for the string.
+ */
+static size_t carvedBytes(size_t bytes) {
+    return (bytes + 7) & ~(size_t)7;
+}
+
+/**
+ * @brief Arena a string was carved from.
+ * @param arenas Pointer to the arenas.
+ * @param string Start of the string.
+ * @return The arena, or NULL for a string that is not in any arena.
+ */
+static EntryArena* arenaOf(const EntryArenas* arenas, const void* string) {
+    uintptr_t base = (uintptr_t)string & ~(uintptr_t)(arenas->arenaBytes - 1);
+    int low = 0;
+    int high = arenas->count - 1;
+
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        uintptr_t candidate = (uintptr_t)arenas->arenas[middle]->base;
+        if (candidate == base) {
+            return arenas->arenas[middle];
+        }
+        if (candidate < base) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Maps a new arena at an address aligned to its size, following the page backing.
+ * @param arenas Pointer to the arenas.
+ * @return Start of the mapping.
+ */
+static char* mapArena(const EntryArenas* arenas) {
+    size_t size = arenas->arenaBytes;
+
+    // Huge page mappings are aligned to the huge page size, which is the arena size
+    if (arenas->pages == ARENA_PAGES_HUGETLB) {
+        char* huge = (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (huge != MAP_FAILED) {
+            return huge;
+        }
+    }
+
+    // Map twice the size and trim, so an aligned arena fits inside
+    char* raw = (char*)mmap(NULL, 2 * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    char* aligned = (char*)(((uintptr_t)raw + size - 1) & ~(uintptr_t)(size - 1));
+    if (aligned > raw) {
+        munmap(raw, (size_t)(aligned - raw));
+    }
+    size_t tail = (size_t)(raw + 2 * size - (aligned + size));
+    if (tail > 0) {
+        munmap(aligned + size, tail);
+    }
+    if (arenas->pages != ARENA_PAGES_REGULAR) {
+        // Failure only means the kernel keeps using regular pages
+        madvise(aligned, size, MADV_HUGEPAGE);
+    }
+    return aligned;
+}
+
+/**
+ * @brief Whether emptied pages of an arena still in use may be given back one by one.
+ * @details Not on huge pages: releasing part of one splits it into regular pages.
+ * @param arenas Pointer to the arenas.
+ * @return Non-zero for arenas on regular pages.
+ */
+static int releasesSinglePages(const EntryArenas* arenas) {
+    return arenas->pages == ARENA_PAGES_REGULAR;
+}
+
+/**
+ * @brief Adds an arena to the sorted array of arenas.
+ * @param arenas Pointer to the arenas.
+ * @param arena Arena to add.
+ */
+static void addArena(EntryArenas* arenas, EntryArena* arena) {
+    if (arenas->count == arenas->slots) {
+        int slots = arenas->slots == 0 ? 8 : arenas->slots * 2;
+        EntryArena** grown = (EntryArena**)realloc(arenas->arenas, sizeof(EntryArena*) * slots);
+        if (grown == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        arenas->arenas = grown;
+        arenas->slots = slots;
+    }
+    int position = arenas->count;
+    while (position > 0 && arenas->arenas[position - 1]->base > arena->base) {
+        arenas->arenas[position] = arenas->arenas[position - 1];
+        position--;
+    }
+    arenas->arenas[position] = arena;
+    arenas->count++;
+}
+
+/**
+ * @brief Takes an emptied arena out of use, keeping it as a spare or unmapping it.
+ * @param arenas Pointer to the arenas.
+ * @param arena Arena without live strings, other than the current one.
+ */
+static void retireArena(EntryArenas* arenas, EntryArena* arena) {
+    int position = 0;
+    while (arenas->arenas[position] != arena) {
+        position++;
+    }
+    memmove(&arenas->arenas[position], &arenas->arenas[position + 1], sizeof(EntryArena*) * (arenas->count - position - 1));
+    arenas->count--;
+    arenas->releasedArenas++;
+
+    if (arenas->spareCount < ENTRY_ARENA_SPARES) {
+        // Keep the mapping but not its pages, they come back zeroed when carved again
+        size_t carved = releasesSinglePages(arenas) ? (arena->used + ENTRY_ARENA_PAGE_BYTES - 1) & ~(size_t)(ENTRY_ARENA_PAGE_BYTES - 1) : arenas->arenaBytes;
+        madvise(arena->base, carved, MADV_DONTNEED);
+        arenas->spares[arenas->spareCount++] = arena;
+        return;
+    }
+    munmap(arena->base, arenas->arenaBytes);
+    arenas->mappedBytes -= arenas->arenaBytes;
+    free(arena);
+}
+
+/**
+ * @brief Makes a fresh arena the current one, reusing a spare when there is one.
+ * @param arenas Pointer to the arenas.
+ */
+static void startArena(EntryArenas* arenas) {
+    EntryArena* previous = arenas->current;
+    EntryArena* arena;
+
+    if (arenas->spareCount > 0) {
+        arena = arenas->spares[--arenas->spareCount];
+    } else {
+        arena = (EntryArena*)calloc(1, sizeof(EntryArena));
+        if (arena == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        arena->base = mapArena(arenas);
+        arenas->mappedBytes += arenas->arenaBytes;
+    }
+    arena->used = 0;
+    arena->liveBytes = 0;
+    arena->evacuating = 0;
+    addArena(arenas, arena);
+    arenas->current = arena;
+
+    // Nothing more is carved from the previous arena, so its last page may go as well
+    if (previous != NULL) {
+        if (previous->liveBytes == 0) {
+            retireArena(arenas, previous);
+            return;
+        }
+        size_t page = previous->used / ENTRY_ARENA_PAGE_BYTES;
+        if (releasesSinglePages(arenas) && previous->used % ENTRY_ARENA_PAGE_BYTES != 0 && previous->pageStrings[page] == 0) {
+            madvise(previous->base + page * ENTRY_ARENA_PAGE_BYTES, ENTRY_ARENA_PAGE_BYTES, MADV_DONTNEED);
+            arenas->releasedPages++;
+        }
+    }
+}
+
+/**
+ * @brief Initializes an empty set of arenas; nothing is mapped until the first string.
+ * @param arenas Pointer to the arenas.
+ * @param pages Memory backing of every arena.
+ */
+void initEntryArenas(EntryArenas* arenas, EntryArenaPages pages) {
+    memset(arenas, 0, sizeof(*arenas));
+    arenas->pages = pages;
+    arenas->arenaBytes = pages == ARENA_PAGES_REGULAR ? ENTRY_ARENA_BYTES : ENTRY_ARENA_HUGE_BYTES;
+}
+
+/**
+ * @brief Carves room for a string from the current arena.
+ * @param arenas Pointer to the arenas.
+ * @param bytes Size of the string, terminator included.
+ * @return Room for the string, 8-byte aligned, or NULL if it is longer than ENTRY_ARENA_MAX_STRING.
+ */
+char* allocateEntryString(EntryArenas* arenas, size_t bytes) {
+    if (bytes == 0 || bytes > ENTRY_ARENA_MAX_STRING) {
+        return NULL;
+    }
+    size_t carved = carvedBytes(bytes);
+    if (arenas->current == NULL || arenas->current->used + carved > arenas->arenaBytes) {
+        startArena(arenas);
+    }
+
+    EntryArena* arena = arenas->current;
+    char* string = arena->base + arena->used;
+    for (size_t page = arena->used / ENTRY_ARENA_PAGE_BYTES; page <= (arena->used + bytes - 1) / ENTRY_ARENA_PAGE_BYTES; ++page) {
+        arena->pageStrings[page]++;
+    }
+    arena->used += carved;
+    arena->liveBytes += carved;
+    arenas->liveBytes += carved;
+    arenas->stringBytes += bytes;
+    return string;
+}
+
+/**
+ * @brief Whether a string was carved from one of the arenas.
+ * @param arenas Pointer to the arenas.
+ * @param string Start of the string.
+ * @return Non-zero for an arena string, 0 for any other allocation.
+ */
+int ownsEntryString(const EntryArenas* arenas, const void* string) {
+    return arenaOf(arenas, string) != NULL;
+}
+
+/**
+ * @brief Whether compaction should move a string into the current arena.
+ * @details Heap strings longer than ENTRY_ARENA_MAX_STRING cannot move; the caller checks
+ *          their length, which spares measuring every string of the dense arenas.
+ * @param arenas Pointer to the arenas.
+ * @param string Start of the string.
+ * @return Non-zero for a heap string or a string of an arena being evacuated.
+ */
+int shouldMoveEntryString(const EntryArenas* arenas, const void* string) {
+    const EntryArena* arena = arenaOf(arenas, string);
+    return arena == NULL || arena->evacuating;
+}
+
+/**
+ * @brief Releases a string carved from an arena.
+ * @details Pages left without a string, and that no later string can be carved from, are
+ *          given back at once; an arena left without a string is retired.
+ * @param arenas Pointer to the arenas.
+ * @param string Start of the string, as returned by allocateEntryString.
+ * @param bytes Size it was allocated with.
+ */
+void releaseEntryString(EntryArenas* arenas, void* string, size_t bytes) {
+    EntryArena* arena = arenaOf(arenas, string);
+    if (arena == NULL) {
+        return;
+    }
+    size_t carved = carvedBytes(bytes);
+    size_t offset = (size_t)((char*)string - arena->base);
+    size_t first = offset / ENTRY_ARENA_PAGE_BYTES;
+    size_t last = (offset + bytes - 1) / ENTRY_ARENA_PAGE_BYTES;
+    arena->liveBytes -= carved;
+    arenas->liveBytes -= carved;
+    arenas->stringBytes -= bytes;
+    for (size_t page = first; page <= last; ++page) {
+        arena->pageStrings[page]--;
+    }
+    if (arena->liveBytes == 0 && arena != arenas->current) {
+        retireArena(arenas, arena);
+        return;
+    }
+
+    // The current arena still carves from the page its next string starts on
+    if (!releasesSinglePages(arenas)) {
+        return;
+    }
+    for (size_t page = first; page <= last; ++page) {
+        if (arena->pageStrings[page] == 0 && (arena != arenas->current || (page + 1) * ENTRY_ARENA_PAGE_BYTES <= arena->used)) {
+            madvise(arena->base + page * ENTRY_ARENA_PAGE_BYTES, ENTRY_ARENA_PAGE_BYTES, MADV_DONTNEED);
+            arenas->releasedPages++;
+        }
+    }
+}
+
+/**
+ * @brief Marks the arenas whose live strings fill less than a share of them for evacuation.
+ * @details Called at the start of a compaction pass. The current arena is never marked,
+ *          since the strings moved out of the others go there.
+ * @param arenas Pointer to the arenas.
+ * @param occupancy Share of its carved bytes below which an arena is evacuated.
+ * @return Number of arenas marked.
+ */
+int startEntryEvacuation(EntryArenas* arenas, double occupancy) {
+    int marked = 0;
+
+    for (int i = 0; i < arenas->count; ++i) {
+        EntryArena* arena = arenas->arenas[i];
+        arena->evacuating = arena != arenas->current && (double)arena->liveBytes < occupancy * (double)arena->used;
+        marked += arena->evacuating;
+    }
+    return marked;
+}
+
+/**
+ * @brief Memory held by the arenas.
+ * @details Counts every mapping, spares included, whether or not its pages are resident,
+ *          and the structures describing the arenas.
+ * @param arenas Pointer to the arenas.
+ * @return Number of bytes.
+ */
+size_t entryArenasBytes(const EntryArenas* arenas) {
+    size_t mappings = arenas->mappedBytes / arenas->arenaBytes;
+    return sizeof(EntryArenas) + sizeof(EntryArena*) * arenas->slots + sizeof(EntryArena) * mappings + arenas->mappedBytes;
+}
+
+/**
+ * @brief Bytes entryArenasBytes grows by when strings of a given total size are carved.
+ * @details Carving may start a new arena, which maps one unless a spare is left. An upper
+ *          bound: strings too long for an arena go to the heap instead.
+ * @param arenas Pointer to the arenas.
+ * @param bytes Total size of the strings, terminators included.
+ * @return Number of bytes, 0 when the strings fit in the current arena or a spare.
+ */
+size_t entryArenasGrowthBytes(const EntryArenas* arenas, size_t bytes) {
+    // Two strings round up by at most 7 bytes each
+    size_t carved = carvedBytes(bytes) + 8;
+    if ((arenas->current != NULL && arenas->current->used + carved <= arenas->arenaBytes) || arenas->spareCount > 0) {
+        return 0;
+    }
+    size_t grown = sizeof(EntryArena) + arenas->arenaBytes;
+    if (arenas->count == arenas->slots) {
+        grown += sizeof(EntryArena*) * (arenas->slots == 0 ? 8 : arenas->slots);
+    }
+    return grown;
+}
+
+/**
+ * @brief Unmaps every arena; strings carved from them must no longer be used.
+ * @param arenas Pointer to the arenas to be freed.
+ */
+void freeEntryArenas(EntryArenas* arenas) {
+    for (int i = 0; i < arenas->count; ++i) {
+        munmap(arenas->arenas[i]->base, arenas->arenaBytes);
+        free(arenas->arenas[i]);
+    }
+    for (int i = 0; i < arenas->spareCount; ++i) {
+        munmap(arenas->spares[i]->base, arenas->arenaBytes);
+        free(arenas->spares[i]);
+    }
+    free(arenas->arenas);
+    memset(arenas, 0, sizeof(*arenas));
+}
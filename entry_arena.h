@@ -0,0 +1,87 @@
+/**
+ * @file entry_arena.h
+ * @brief Dense arenas for the key and value strings of a table, which a compaction pass can
+ *        empty and give back to the operating system.
+ *        Strings are carved one after the other from 1 MiB mappings, so live strings stay
+ *        packed instead of scattered over a fragmented heap. Every page counts the strings
+ *        lying on it: a page whose last string is released goes back to the kernel with
+ *        madvise(MADV_DONTNEED) right away, and an arena whose live bytes fall below a share
+ *        of its size is marked for evacuation, so the table moves its strings into the current
+ *        arena and the whole mapping is released.
+ *        Arenas may instead be backed by huge pages. They then span one huge page, and emptied
+ *        pages are only given back with the whole arena, since releasing 4 KiB of a huge page
+ *        would split it back into regular pages.
+ */
+
+#ifndef ENTRY_ARENA_H
+#define ENTRY_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Size of one arena on regular pages, which is also aligned to it. */
+#define ENTRY_ARENA_BYTES (1024 * 1024)
+/** @brief Size of one arena on huge pages, a single 2 MiB huge page. */
+#define ENTRY_ARENA_HUGE_BYTES (2 * 1024 * 1024)
+/** @brief Granularity at which emptied memory is given back. */
+#define ENTRY_ARENA_PAGE_BYTES 4096
+/** @brief Pages of the largest arena. */
+#define ENTRY_ARENA_PAGES (ENTRY_ARENA_HUGE_BYTES / ENTRY_ARENA_PAGE_BYTES)
+/** @brief Longest string carved from an arena; longer ones stay on the heap. */
+#define ENTRY_ARENA_MAX_STRING (ENTRY_ARENA_BYTES / 16)
+/** @brief Emptied arenas kept mapped for reuse instead of being unmapped. */
+#define ENTRY_ARENA_SPARES 2
+
+/** @brief Memory backing of the arenas, following the PagePolicy of the table. */
+typedef enum {
+    ARENA_PAGES_REGULAR, /**< 1 MiB mappings of regular pages, emptied pages given back one by one. */
+    ARENA_PAGES_TRANSPARENT_HUGE, /**< 2 MiB mappings advised with MADV_HUGEPAGE. */
+    ARENA_PAGES_HUGETLB, /**< 2 MiB MAP_HUGETLB mappings, falling back to transparent huge pages when none are reserved. */
+} EntryArenaPages;
+
+/** @brief One mapping strings are carved from. */
+typedef struct {
+    char* base; /**< Start of the mapping, aligned to ENTRY_ARENA_BYTES. */
+    size_t used; /**< Bytes handed out; strings are carved at this offset. */
+    size_t liveBytes; /**< Bytes of the strings not released yet. */
+    int evacuating; /**< The compaction pass moves the strings out; nothing new is carved here. */
+    uint16_t pageStrings[ENTRY_ARENA_PAGES]; /**< Live strings lying, even partly, on each page. */
+} EntryArena;
+
+/** @brief Arenas of one table. */
+typedef struct {
+    EntryArenaPages pages; /**< Memory backing of every arena, fixed at initialization. */
+    size_t arenaBytes; /**< Size of each arena, which is also aligned to it. */
+    EntryArena** arenas; /**< Arenas holding strings, sorted by base address. */
+    int count; /**< Number of arenas in arenas. */
+    int slots; /**< Capacity of arenas. */
+    EntryArena* current; /**< Arena new strings are carved from, NULL before the first one. */
+    EntryArena* spares[ENTRY_ARENA_SPARES]; /**< Emptied arenas, their pages already released. */
+    int spareCount; /**< Number of arenas in spares. */
+    size_t mappedBytes; /**< Bytes of every mapping, spares included. */
+    size_t liveBytes; /**< Bytes of the strings not released yet. */
+    size_t stringBytes; /**< Bytes the strings not released yet were requested with, before rounding. */
+    unsigned long releasedPages; /**< Pages given back with MADV_DONTNEED. */
+    unsigned long releasedArenas; /**< Arenas emptied by releases and evacuations. */
+} EntryArenas;
+
+/*  FUNCTION DECLARATIONS   */
+void initEntryArenas(EntryArenas* arenas, EntryArenaPages pages);
+char* allocateEntryString(EntryArenas* arenas, size_t bytes);
+int ownsEntryString(const EntryArenas* arenas, const void* string);
+int shouldMoveEntryString(const EntryArenas* arenas, const void* string);
+void releaseEntryString(EntryArenas* arenas, void* string, size_t bytes);
+int startEntryEvacuation(EntryArenas* arenas, double occupancy);
+size_t entryArenasBytes(const EntryArenas* arenas);
+size_t entryArenasGrowthBytes(const EntryArenas* arenas, size_t bytes);
+void freeEntryArenas(EntryArenas* arenas);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENTRY_ARENA_H */
@@ -0,0 +1,311 @@
+/**
+ * @file extendible_hash_table.c
+ * @brief Implementation of the extendible hashing Hash Table declared in extendible_hash_table.h.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "extendible_hash_table.h"
+#include "bucket_engine.h"
+#include "key_hash.h"
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Mask of the low @p depth bits of a hash.
+ * @param depth Number of bits, 0 to 31.
+ * @return The mask.
+ */
+static unsigned int depthMask(int depth) {
+    return (1u << depth) - 1;
+}
+
+/**
+ * @brief Allocates an empty bucket.
+ * @param localDepth Number of low hash bits its pairs share.
+ * @param pattern Value of those bits.
+ * @return The bucket.
+ */
+static ExtendibleBucket* newBucket(int localDepth, unsigned int pattern) {
+    ExtendibleBucket* bucket = (ExtendibleBucket*)calloc(1, sizeof(ExtendibleBucket));
+    if (bucket == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    bucket->localDepth = localDepth;
+    bucket->pattern = pattern;
+    if (pthread_rwlock_init(&bucket->lock, NULL) != 0) {
+        perror("Error in pthread_rwlock_init");
+        exit(EXIT_FAILURE);
+    }
+    return bucket;
+}
+
+/** @brief Functions of the pair arrays of a bucket: appendToPairs, removeFromPairs, releasePairs, findInPairs. */
+DEFINE_STRING_BUCKET_ENGINE(Pairs, EXTENDIBLE_BUCKET_PAIRS)
+
+/**
+ * @brief Locks the bucket a hash belongs to.
+ * @details The directory entry is read without the bucket lock, so a split may move the hash
+ *          to a new bucket before the lock is obtained; the bucket is then checked to still
+ *          cover the hash and the entry read again if not. Buckets are never freed while the
+ *          table lives, so a stale pointer is always safe to lock.
+ * @param et Pointer to the extendible hash table, with the directory lock held shared.
+ * @param hash Full hash of the key.
+ * @param exclusive Take the bucket lock exclusively.
+ * @return The locked bucket.
+ */
+static ExtendibleBucket* lockBucket(ExtendibleHashTable* et, unsigned int hash, int exclusive) {
+    for (;;) {
+        ExtendibleBucket* bucket = __atomic_load_n(&et->directory[hash & depthMask(et->globalDepth)], __ATOMIC_ACQUIRE);
+        if (exclusive) {
+            pthread_rwlock_wrlock(&bucket->lock);
+        } else {
+            pthread_rwlock_rdlock(&bucket->lock);
+        }
+        if ((hash & depthMask(bucket->localDepth)) == bucket->pattern) {
+            return bucket;
+        }
+        pthread_rwlock_unlock(&bucket->lock);
+    }
+}
+
+/**
+ * @brief Whether a pair should go into its bucket without splitting it.
+ * @details A bucket splits once it holds EXTENDIBLE_BUCKET_PAIRS pairs, or as many as its
+ *          arrays hold if they already grew. They grow instead when the new hash fills half
+ *          the bucket already, such as a key inserted many times: splitting cannot separate
+ *          equal hashes and would only push the depth up to separate the few other pairs.
+ * @param bucket Bucket of the pair, locked exclusively.
+ * @param hash Full hash of the key.
+ * @return Non-zero to append the pair right away.
+ */
+static int fitsWithoutSplit(const ExtendibleBucket* bucket, unsigned int hash) {
+    const Bucket* pairs = &bucket->pairs;
+    if (pairs->count < EXTENDIBLE_BUCKET_PAIRS || pairs->count < pairs->slots ||
+        bucket->localDepth == EXTENDIBLE_MAX_DEPTH) {
+        return 1;
+    }
+    int equal = 0;
+    for (int i = 0; i < pairs->count; ++i) {
+        equal += pairs->hashes[i] == hash;
+    }
+    return 2 * equal >= pairs->count;
+}
+
+/**
+ * @brief Splits a bucket whose local depth is below the global depth.
+ * @details Pairs whose next hash bit is set move to a new bucket, and the directory entries
+ *          of the old bucket with that bit set are pointed at it: 2^(globalDepth-localDepth-1)
+ *          entries, spaced 2^(localDepth+1) apart. Only entries of this bucket change, and only
+ *          while it is locked, so splits of different buckets never write the same entry.
+ * @param et Pointer to the extendible hash table, with the directory lock held shared.
+ * @param bucket Bucket to split, locked exclusively.
+ */
+static void splitBucket(ExtendibleHashTable* et, ExtendibleBucket* bucket) {
+    int depth = bucket->localDepth;
+    ExtendibleBucket* sibling = newBucket(depth + 1, bucket->pattern | 1u << depth);
+
+    int kept = 0;
+    Bucket* pairs = &bucket->pairs;
+    for (int i = 0; i < pairs->count; ++i) {
+        if (pairs->hashes[i] & 1u << depth) {
+            appendToPairs(&sibling->pairs, pairs->keys[i], pairs->values[i], pairs->hashes[i], pairs->lengths[i]);
+        } else {
+            pairs->keys[kept] = pairs->keys[i];
+            pairs->values[kept] = pairs->values[i];
+            pairs->hashes[kept] = pairs->hashes[i];
+            pairs->lengths[kept] = pairs->lengths[i];
+            kept++;
+        }
+    }
+    pairs->count = kept;
+    bucket->localDepth = depth + 1;
+
+    // Publish the filled sibling; lookups that still reach the old bucket check its depth
+    unsigned int entries = 1u << et->globalDepth;
+    for (unsigned int index = sibling->pattern; index < entries; index += 1u << (depth + 1)) {
+        __atomic_store_n(&et->directory[index], sibling, __ATOMIC_RELEASE);
+    }
+    __atomic_fetch_add(&et->bucketCount, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&et->splits, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Doubles the directory, the second half pointing to the same buckets as the first.
+ * @param et Pointer to the extendible hash table, with the directory lock held exclusively.
+ */
+static void doubleDirectory(ExtendibleHashTable* et) {
+    size_t entries = (size_t)1 << et->globalDepth;
+    ExtendibleBucket** directory = (ExtendibleBucket**)realloc(et->directory, sizeof(ExtendibleBucket*) * entries * 2);
+    if (directory == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(directory + entries, directory, sizeof(ExtendibleBucket*) * entries);
+    et->directory = directory;
+    et->globalDepth++;
+    et->doublings++;
+}
+
+/**
+ * @brief Initializes an extendible hash table.
+ * @param et Pointer to the extendible hash table to be initialized.
+ * @param capacity Expected number of pairs; the table starts with one bucket per
+ *        EXTENDIBLE_BUCKET_PAIRS of them, rounded up to a power of two.
+ */
+void initExtendibleHashTable(ExtendibleHashTable* et, int capacity) {
+    int depth = 0;
+    while (depth < EXTENDIBLE_MAX_DEPTH && (1 << depth) * EXTENDIBLE_BUCKET_PAIRS < capacity) {
+        depth++;
+    }
+    et->globalDepth = depth;
+    et->directory = (ExtendibleBucket**)malloc(sizeof(ExtendibleBucket*) << depth);
+    if (et->directory == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned int index = 0; index < 1u << depth; ++index) {
+        et->directory[index] = newBucket(depth, index);
+    }
+
+    // Writers first, so a pending doubling is not held back by a stream of operations
+    pthread_rwlockattr_t lockKind;
+    pthread_rwlockattr_init(&lockKind);
+    pthread_rwlockattr_setkind_np(&lockKind, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    if (pthread_rwlock_init(&et->directoryLock, &lockKind) != 0) {
+        perror("Error in pthread_rwlock_init");
+        exit(EXIT_FAILURE);
+    }
+    pthread_rwlockattr_destroy(&lockKind);
+    et->size = 0;
+    et->bucketCount = 1 << depth;
+    et->splits = 0;
+    et->doublings = 0;
+}
+
+/**
+ * @brief Inserts a key-value pair, splitting its bucket if it is full.
+ * @details A split happens under the shared directory lock. Only a bucket already as deep
+ *          as the directory needs the directory to double first, which takes the directory
+ *          lock exclusively for the time of copying the pointers.
+ * @param et Pointer to the extendible hash table.
+ * @param key Key of the pair.
+ * @param value Value associated with the key.
+ */
+void insertExtendibleKeyValPair(ExtendibleHashTable* et, const char* key, const char* value) {
+    size_t length = strlen(key);
+    unsigned int hash = hashKeyBytes(key, length);
+    char* ownedKey = strdup(key);
+    char* ownedValue = strdup(value);
+    if (ownedKey == NULL || ownedValue == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    for (;;) {
+        pthread_rwlock_rdlock(&et->directoryLock);
+        ExtendibleBucket* bucket = lockBucket(et, hash, 1);
+        if (fitsWithoutSplit(bucket, hash)) {
+            appendToPairs(&bucket->pairs, ownedKey, ownedValue, hash, (unsigned int)length);
+            pthread_rwlock_unlock(&bucket->lock);
+            pthread_rwlock_unlock(&et->directoryLock);
+            __atomic_fetch_add(&et->size, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        if (bucket->localDepth < et->globalDepth) {
+            splitBucket(et, bucket);
+            pthread_rwlock_unlock(&bucket->lock);
+            pthread_rwlock_unlock(&et->directoryLock);
+            continue;
+        }
+
+        // Another thread may double the directory meanwhile, then this one has nothing to do
+        int depth = et->globalDepth;
+        pthread_rwlock_unlock(&bucket->lock);
+        pthread_rwlock_unlock(&et->directoryLock);
+        pthread_rwlock_wrlock(&et->directoryLock);
+        if (et->globalDepth == depth) {
+            doubleDirectory(et);
+        }
+        pthread_rwlock_unlock(&et->directoryLock);
+    }
+}
+
+/**
+ * @brief Removes a key-value pair.
+ * @details Buckets never merge back, so the table keeps the directory and buckets of its
+ *          largest size.
+ * @param et Pointer to the extendible hash table.
+ * @param key Key of the pair to be removed.
+ */
+void removeExtendibleKeyValPair(ExtendibleHashTable* et, const char* key) {
+    size_t length = strlen(key);
+    unsigned int hash = hashKeyBytes(key, length);
+
+    pthread_rwlock_rdlock(&et->directoryLock);
+    ExtendibleBucket* bucket = lockBucket(et, hash, 1);
+    Bucket* pairs = &bucket->pairs;
+    int slot = findInPairs(pairs, hash, key, length);
+    if (slot >= 0) {
+        // Free memory for the removed pair and close the hole, keeping the insertion order
+        free(pairs->keys[slot]);
+        free(pairs->values[slot]);
+        removeFromPairs(pairs, slot);
+        __atomic_fetch_sub(&et->size, 1, __ATOMIC_RELAXED);
+    }
+    pthread_rwlock_unlock(&bucket->lock);
+    pthread_rwlock_unlock(&et->directoryLock);
+}
+
+/**
+ * @brief Looks up a key and copies its value into a caller buffer.
+ * @details The value is copied while the bucket is locked, since a concurrent remove
+ *          may free it as soon as the lock is released.
+ * @param et Pointer to the extendible hash table.
+ * @param key Key to look up.
+ * @param buffer Buffer receiving the value, always terminated when not empty.
+ * @param bufferSize Size of the buffer, longer values are truncated.
+ * @return Length of the whole value, or -1 if the key was not found.
+ */
+int lookup_extendibleHashTable(ExtendibleHashTable* et, const char* key, char* buffer, size_t bufferSize) {
+    size_t keyLength = strlen(key);
+    unsigned int hash = hashKeyBytes(key, keyLength);
+    int length = -1;
+
+    pthread_rwlock_rdlock(&et->directoryLock);
+    ExtendibleBucket* bucket = lockBucket(et, hash, 0);
+    int slot = findInPairs(&bucket->pairs, hash, key, keyLength);
+    if (slot >= 0) {
+        length = snprintf(buffer, bufferSize, "%s", bucket->pairs.values[slot]);
+    }
+    pthread_rwlock_unlock(&bucket->lock);
+    pthread_rwlock_unlock(&et->directoryLock);
+    return length;
+}
+
+/**
+ * @brief Frees the directory, the buckets and their pairs.
+ * @param et Pointer to the extendible hash table to be freed.
+ */
+void freeExtendibleHashTable(ExtendibleHashTable* et) {
+    unsigned int entries = 1u << et->globalDepth;
+    for (unsigned int index = 0; index < entries; ++index) {
+        // Free a bucket at the last entry pointing to it, the earlier ones still read it
+        ExtendibleBucket* bucket = et->directory[index];
+        if (index + (1u << bucket->localDepth) < entries) {
+            continue;
+        }
+        for (int i = 0; i < bucket->pairs.count; ++i) {
+            free(bucket->pairs.keys[i]);
+            free(bucket->pairs.values[i]);
+        }
+        releasePairs(&bucket->pairs);
+        pthread_rwlock_destroy(&bucket->lock);
+        free(bucket);
+    }
+    free(et->directory);
+    pthread_rwlock_destroy(&et->directoryLock);
+}
@@ -0,0 +1,58 @@
+/**
+ * @file extendible_hash_table.h
+ * @brief Thread-safe Hash Table growing by extendible hashing.
+ *        A directory of 2^globalDepth entries, indexed by the low bits of the hash, points to
+ *        buckets of bounded size; a bucket of local depth d is shared by the 2^(globalDepth-d)
+ *        entries that agree on its d low bits. A full bucket splits on its own: its pairs are
+ *        divided by one more hash bit and only its range of the directory is rewritten. The
+ *        directory itself doubles by copying pointers, never touching a pair. Every bucket
+ *        has its own lock, so operations on different buckets, splits included, run in parallel.
+ */
+
+#ifndef EXTENDIBLE_HASH_TABLE_H
+#define EXTENDIBLE_HASH_TABLE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include "hash_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Pairs a bucket holds before it splits, unless its arrays grew larger. */
+#define EXTENDIBLE_BUCKET_PAIRS 32
+/** @brief Largest global depth; buckets at this depth grow instead of splitting. */
+#define EXTENDIBLE_MAX_DEPTH 24
+
+/** @brief Bucket of the extendible hashing table. */
+typedef struct {
+    Bucket pairs; /**< Pairs of the bucket, as parallel arrays. */
+    int localDepth; /**< Number of low hash bits every pair of the bucket shares. */
+    unsigned int pattern; /**< Value of those bits. */
+    pthread_rwlock_t lock; /**< Shared by lookups, exclusive for updates and splits. */
+} ExtendibleBucket;
+
+/** @brief Structure representing the extendible hashing Hash Table. */
+typedef struct {
+    ExtendibleBucket** directory; /**< 2^globalDepth bucket pointers, indexed by the low hash bits. */
+    int globalDepth; /**< Number of hash bits that index the directory. */
+    pthread_rwlock_t directoryLock; /**< Shared by every operation, exclusive only while the directory doubles. */
+    int size; /**< Number of key-value pairs. */
+    int bucketCount; /**< Number of buckets. */
+    unsigned long splits; /**< Buckets split so far. */
+    unsigned long doublings; /**< Times the directory doubled. */
+} ExtendibleHashTable;
+
+/*  FUNCTION DECLARATIONS   */
+void initExtendibleHashTable(ExtendibleHashTable* et, int capacity);
+void insertExtendibleKeyValPair(ExtendibleHashTable* et, const char* key, const char* value);
+void removeExtendibleKeyValPair(ExtendibleHashTable* et, const char* key);
+int lookup_extendibleHashTable(ExtendibleHashTable* et, const char* key, char* buffer, size_t bufferSize);
+void freeExtendibleHashTable(ExtendibleHashTable* et);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EXTENDIBLE_HASH_TABLE_H */
@@ -0,0 +1,266 @@
+/**
+ * @file hash_map.hpp
+ * @brief Header-only generic Hash Map built from the same design as the C Hash Table:
+ *        separate chaining into an array of containers, doubled once the load factor
+ *        passes LOAD_FACTOR_THRESHOLD.
+ *        Hash and equality are compile-time policies. When both policies declare
+ *        is_transparent, lookups accept any type they can hash and compare (for example
+ *        std::string_view against std::string keys) without building a temporary key.
+ */
+
+#ifndef HASH_MAP_HPP
+#define HASH_MAP_HPP
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+/** @brief Transparent string hash, hashes std::string, std::string_view and C strings alike. */
+struct StringHash {
+    using is_transparent = void; /**< Enables heterogeneous lookup. */
+
+    /** @brief Hashes the characters of @p key. */
+    std::size_t operator()(std::string_view key) const noexcept {
+        return std::hash<std::string_view>{}(key);
+    }
+};
+
+/** @brief Transparent string equality matching StringHash. */
+struct StringEqual {
+    using is_transparent = void; /**< Enables heterogeneous lookup. */
+
+    /** @brief Compares the characters of @p lhs and @p rhs. */
+    bool operator()(std::string_view lhs, std::string_view rhs) const noexcept {
+        return lhs == rhs;
+    }
+};
+
+/**
+ * @brief Generic separately chained hash map.
+ * @tparam K Key type.
+ * @tparam V Value type, may be move-only.
+ * @tparam Hash Hash policy, callable as Hash{}(key).
+ * @tparam Eq Equality policy, callable as Eq{}(lhs, rhs).
+ */
+template <class K, class V, class Hash = std::hash<K>, class Eq = std::equal_to<K>>
+class HashMap {
+public:
+    /** @brief Initial capacity of the map, same as the C table. */
+    static constexpr std::size_t kInitialCapacity = 10;
+    /** @brief Load factor used while resizing, same as the C table. */
+    static constexpr double kLoadFactorThreshold = 0.75;
+
+    /** @brief Creates an empty map with the given number of containers. */
+    explicit HashMap(std::size_t capacity = kInitialCapacity)
+        : table_(new Node*[capacity == 0 ? 1 : capacity]()), size_(0), capacity_(capacity == 0 ? 1 : capacity) {}
+
+    HashMap(const HashMap&) = delete;
+    HashMap& operator=(const HashMap&) = delete;
+
+    /**
+     * @brief Takes over the containers of @p other, leaving it empty.
+     * @details The source keeps no containers; it stays usable and allocates a fresh array
+     *          on its next insertion.
+     */
+    HashMap(HashMap&& other) noexcept
+        : table_(std::exchange(other.table_, nullptr)), size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)) {}
+
+    /** @brief Releases the current contents and takes over the containers of @p other, see the move constructor. */
+    HashMap& operator=(HashMap&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            table_ = std::exchange(other.table_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+        }
+        return *this;
+    }
+
+    ~HashMap() { destroy(); }
+
+    /** @brief Number of key-value pairs in the map. */
+    std::size_t size() const noexcept { return size_; }
+    /** @brief Current number of containers. */
+    std::size_t capacity() const noexcept { return capacity_; }
+    /** @brief Whether the map holds no pairs. */
+    bool empty() const noexcept { return size_ == 0; }
+
+    /**
+     * @brief Inserts a pair if @p key is absent, constructing the value in place from @p args.
+     * @details Nothing is constructed when the key already exists, so move-only arguments
+     *          are left untouched in that case.
+     * @return Pointer to the stored value and whether an insertion took place.
+     */
+    template <class KArg, class... Args>
+    std::pair<V*, bool> try_emplace(KArg&& key, Args&&... args) {
+        const std::size_t hash = Hash{}(key);
+        if (Node* found = findNode(key, hash)) {
+            return {&found->value, false};
+        }
+        growIfNeeded();
+        Node* node = new Node(hash, std::forward<KArg>(key), std::forward<Args>(args)...);
+        link(node);
+        return {&node->value, true};
+    }
+
+    /** @brief Same as try_emplace, mirroring the std::unordered_map spelling. */
+    template <class KArg, class... Args>
+    std::pair<V*, bool> emplace(KArg&& key, Args&&... args) {
+        return try_emplace(std::forward<KArg>(key), std::forward<Args>(args)...);
+    }
+
+    /** @brief Inserts @p value under @p key, replacing any existing value. */
+    template <class KArg, class VArg>
+    V& insert_or_assign(KArg&& key, VArg&& value) {
+        auto result = try_emplace(std::forward<KArg>(key), std::forward<VArg>(value));
+        if (!result.second) {
+            *result.first = std::forward<VArg>(value);
+        }
+        return *result.first;
+    }
+
+    /** @brief Looks up @p key, returning the value or nullptr. */
+    template <class Q>
+    V* find(const Q& key) {
+        Node* node = findNode(key, Hash{}(key));
+        return node != nullptr ? &node->value : nullptr;
+    }
+
+    /** @brief Looks up @p key, returning the value or nullptr. */
+    template <class Q>
+    const V* find(const Q& key) const {
+        const Node* node = findNode(key, Hash{}(key));
+        return node != nullptr ? &node->value : nullptr;
+    }
+
+    /** @brief Whether @p key is present. */
+    template <class Q>
+    bool contains(const Q& key) const {
+        return find(key) != nullptr;
+    }
+
+    /** @brief Removes @p key, returning whether it was present. */
+    template <class Q>
+    bool erase(const Q& key) {
+        if (capacity_ == 0) {
+            return false;
+        }
+        const std::size_t hash = Hash{}(key);
+        Node** link = &table_[hash % capacity_];
+        while (*link != nullptr) {
+            Node* current = *link;
+            if (current->hash == hash && Eq{}(current->key, key)) {
+                *link = current->next;
+                delete current;
+                size_--;
+                return true;
+            }
+            link = &current->next;
+        }
+        return false;
+    }
+
+    /** @brief Grows the container array so @p count pairs fit without resizing. */
+    void reserve(std::size_t count) {
+        std::size_t needed = static_cast<std::size_t>(count / kLoadFactorThreshold) + 1;
+        if (needed > capacity_) {
+            rehash(needed);
+        }
+    }
+
+    /** @brief Calls @p fn(key, value) for every pair, in container order. */
+    template <class F>
+    void for_each(F&& fn) const {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            for (const Node* node = table_[i]; node != nullptr; node = node->next) {
+                fn(node->key, node->value);
+            }
+        }
+    }
+
+private:
+    /** @brief Key-value node; the hash is cached so resizing never rehashes keys. */
+    struct Node {
+        template <class KArg, class... Args>
+        Node(std::size_t h, KArg&& k, Args&&... args)
+            : hash(h), key(std::forward<KArg>(k)), value(std::forward<Args>(args)...), next(nullptr) {}
+
+        std::size_t hash; /**< Full hash of the key. */
+        K key; /**< Key of the pair. */
+        V value; /**< Value associated with the key. */
+        Node* next; /**< Next node in the same container. */
+    };
+
+    template <class Q>
+    Node* findNode(const Q& key, std::size_t hash) const {
+        if (capacity_ == 0) {
+            return nullptr;
+        }
+        for (Node* node = table_[hash % capacity_]; node != nullptr; node = node->next) {
+            if (node->hash == hash && Eq{}(node->key, key)) {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    void link(Node* node) {
+        Node*& head = table_[node->hash % capacity_];
+        node->next = head;
+        head = node;
+        size_++;
+    }
+
+    void growIfNeeded() {
+        // A moved-from map has no containers left
+        if (capacity_ == 0) {
+            rehash(kInitialCapacity);
+        } else if (static_cast<double>(size_) / capacity_ > kLoadFactorThreshold) {
+            rehash(capacity_ * 2);
+        }
+    }
+
+    void rehash(std::size_t newCapacity) {
+        Node** newTable = new Node*[newCapacity]();
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            Node* node = table_[i];
+            while (node != nullptr) {
+                Node* next = node->next;
+                Node*& head = newTable[node->hash % newCapacity];
+                node->next = head;
+                head = node;
+                node = next;
+            }
+        }
+        delete[] table_;
+        table_ = newTable;
+        capacity_ = newCapacity;
+    }
+
+    void destroy() noexcept {
+        if (table_ == nullptr) {
+            return;
+        }
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            Node* node = table_[i];
+            while (node != nullptr) {
+                Node* next = node->next;
+                delete node;
+                node = next;
+            }
+        }
+        delete[] table_;
+        table_ = nullptr;
+    }
+
+    Node** table_; /**< Array of container heads. */
+    std::size_t size_; /**< Number of key-value pairs. */
+    std::size_t capacity_; /**< Number of containers. */
+};
+
+#endif /* HASH_MAP_HPP */
@@ -0,0 +1,169 @@
+/**
+ * @file hash_map_test.cpp
+ * @brief Demonstrates the generic HashMap template and benchmarks it against
+ *        std::unordered_map and the C Hash Table.
+ *        Build with: gcc -O2 -c hash_table.c ordered_index.c membership_filter.c value_codec.c key_hash.c change_feed.c entry_arena.c hot_keys.c && g++ -std=c++17 -O2 hash_map_test.cpp hash_table.o ordered_index.o membership_filter.o value_codec.o key_hash.o change_feed.o entry_arena.o hot_keys.o -lpthread -lm -o hash_map_test
+ *        Run with an optional pair count: ./hash_map_test [pairs]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "hash_map.hpp"
+#include "hash_table.h"
+
+/** @brief Default number of key-value pairs used by the benchmark. */
+#define BENCH_DEFAULT_PAIRS 50000
+
+/** @brief String keyed map with heterogeneous lookup. */
+template <class V>
+using StringHashMap = HashMap<std::string, V, StringHash, StringEqual>;
+
+/** @brief Seconds elapsed since @p start. */
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Shows move-only values, emplace and std::string_view lookups.
+ */
+static void demo() {
+    // Values are move-only, constructed in place from the emplace arguments
+    StringHashMap<std::unique_ptr<std::string>> players;
+    players.emplace("maradona", std::make_unique<std::string>("Argentina"));
+    players.emplace("pele", std::make_unique<std::string>("Brazil"));
+    players.emplace("zidane", std::make_unique<std::string>("France"));
+
+    // Look up with a string_view, no temporary std::string is built
+    std::string_view zidane = "zidane";
+    printf("Zidane Country : %s\n", players.find(zidane)->get()->c_str());
+    printf("Pele Country: %s\n", players.find(std::string_view("pele"))->get()->c_str());
+
+    players.erase(std::string_view("maradona"));
+    if (players.find(std::string_view("maradona")) == nullptr) {
+        printf("Maradona Country Entry was successfully removed.\n");
+    }
+
+    // A moved-from map is empty and can be used again
+    StringHashMap<std::unique_ptr<std::string>> moved(std::move(players));
+    players.emplace("cruyff", std::make_unique<std::string>("Netherlands"));
+    if (players.size() == 1 && players.find(std::string_view("cruyff")) != nullptr &&
+        players.find(std::string_view("pele")) == nullptr && moved.size() == 2) {
+        printf("Moved-from map was successfully reused.\n");
+    }
+    players = std::move(moved);
+    moved.emplace("pele", std::make_unique<std::string>("Brazil"));
+    printf("Pele Country after moving back: %s\n", players.find(std::string_view("pele"))->get()->c_str());
+}
+
+/**
+ * @brief Times inserts, hit lookups and miss lookups for the three tables.
+ * @param pairs Number of key-value pairs to insert.
+ */
+static void benchmark(int pairs) {
+    // Present and absent keys, handed to each table as string_views or C strings
+    std::vector<std::string> keys, missing;
+    keys.reserve(pairs);
+    missing.reserve(pairs);
+    for (int i = 0; i < pairs; ++i) {
+        keys.push_back("player-" + std::to_string(i));
+        missing.push_back("nobody-" + std::to_string(i));
+    }
+
+    printf("%-22s %12s %12s %12s\n", "table (ns/op)", "insert", "hit", "miss");
+
+    // Generic HashMap, looked up through string_view
+    {
+        StringHashMap<std::string> map;
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& key : keys) {
+            map.emplace(key, "Country");
+        }
+        double insert = secondsSince(start);
+        size_t found = 0;
+        start = std::chrono::steady_clock::now();
+        for (const std::string& key : keys) {
+            found += map.find(std::string_view(key)) != nullptr;
+        }
+        double hit = secondsSince(start);
+        start = std::chrono::steady_clock::now();
+        for (const std::string& key : missing) {
+            found += map.find(std::string_view(key)) != nullptr;
+        }
+        double miss = secondsSince(start);
+        printf("%-22s %12.1f %12.1f %12.1f (%zu)\n", "HashMap", insert * 1e9 / pairs, hit * 1e9 / pairs,
+               miss * 1e9 / pairs, found);
+    }
+
+    // std::unordered_map, C++17 lookups need a std::string key
+    {
+        std::unordered_map<std::string, std::string> map;
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& key : keys) {
+            map.emplace(key, "Country");
+        }
+        double insert = secondsSince(start);
+        size_t found = 0;
+        start = std::chrono::steady_clock::now();
+        for (const std::string& key : keys) {
+            found += map.find(std::string(std::string_view(key))) != map.end();
+        }
+        double hit = secondsSince(start);
+        start = std::chrono::steady_clock::now();
+        for (const std::string& key : missing) {
+            found += map.find(std::string(std::string_view(key))) != map.end();
+        }
+        double miss = secondsSince(start);
+        printf("%-22s %12.1f %12.1f %12.1f (%zu)\n", "std::unordered_map", insert * 1e9 / pairs,
+               hit * 1e9 / pairs, miss * 1e9 / pairs, found);
+    }
+
+    // C Hash Table
+    {
+        HashTable table;
+        initHashTable(&table, INITIAL_CAPACITY);
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& key : keys) {
+            insertKeyValPair(&table, key.c_str(), "Country");
+        }
+        double insert = secondsSince(start);
+        size_t found = 0;
+        start = std::chrono::steady_clock::now();
+        for (const std::string& key : keys) {
+            found += lookup_hashTable(&table, key.c_str()) != NULL;
+        }
+        double hit = secondsSince(start);
+        start = std::chrono::steady_clock::now();
+        for (const std::string& key : missing) {
+            found += lookup_hashTable(&table, key.c_str()) != NULL;
+        }
+        double miss = secondsSince(start);
+        printf("%-22s %12.1f %12.1f %12.1f (%zu)\n", "C HashTable", insert * 1e9 / pairs, hit * 1e9 / pairs,
+               miss * 1e9 / pairs, found);
+        freeHashTable(&table);
+    }
+}
+
+/**
+ * @brief Runs the demonstration followed by the benchmark.
+ * @param argc Number of command-line arguments.
+ * @param argv Optional number of pairs for the benchmark.
+ * @return 0 on successful execution.
+ */
+int main(int argc, char* argv[]) {
+    int pairs = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_PAIRS;
+    if (pairs <= 0) {
+        fprintf(stderr, "Usage: %s [pairs]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    demo();
+    benchmark(pairs);
+    return 0;
+}
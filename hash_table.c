@@ -0,0 +1,1944 @@
+/**
+ * @file hash_table.c
+ * @brief Implementation of the Hash Table declared in hash_table.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "hash_table.h"
+#include "value_codec.h"
+#include "key_hash.h"
+#include "bucket_engine.h"
+
+/** @brief Lookup counters owned by one thread, padded to a full cache line. */
+struct LookupCounterSlot {
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong hits; /**< Lookups that found the key. */
+    atomic_ullong misses; /**< Lookups that did not find the key. */
+};
+
+/** @brief Range of old containers moved by one rehash worker. */
+typedef struct {
+    Bucket* oldTable; /**< Array of containers being replaced. */
+    Bucket* newTable; /**< Array of containers receiving the pairs. */
+    int newCapacity; /**< Number of containers in newTable. */
+    int first; /**< First old container of the range. */
+    int last; /**< One past the last old container of the range. */
+    int keepOld; /**< Leave the old containers intact, a snapshot still reads them. */
+    size_t entryBytes; /**< Bytes of container arrays allocated for the range. */
+} RehashRange;
+
+/** @brief Snapshot state of one container. */
+enum {
+    SNAPSHOT_LIVE, /**< Unchanged since the snapshot, nobody has claimed it yet. */
+    SNAPSHOT_READING, /**< The snapshot reader is reading the live container. */
+    SNAPSHOT_READ, /**< The snapshot reader is done with the live container. */
+    SNAPSHOT_COPYING, /**< A writer is copying the container before changing it. */
+    SNAPSHOT_COPIED, /**< The snapshot view of the container is in copies. */
+};
+
+/** @brief Key or value removed while a snapshot is active. */
+typedef struct {
+    void* allocation; /**< Allocation of the string. */
+    size_t bytes; /**< Size of the allocation. */
+} DeferredFree;
+
+/**
+ * @brief Point-in-time view of a hash table.
+ * @details Writers copy a container the first time they change it while the snapshot is
+ *          active, and the reader claims each container it reads, so both sides agree on
+ *          which version belongs to the snapshot without blocking each other. Strings freed
+ *          by removals are kept until the snapshot is released.
+ */
+struct HashTableSnapshot {
+    Bucket* table; /**< Array of containers at the time of the snapshot. */
+    int capacity; /**< Number of containers in table. */
+    size_t tableMappedBytes; /**< Mapping length of table, 0 when it is on the heap. */
+    int ownsTable; /**< A resize handed table over to the snapshot. */
+    atomic_uchar* states; /**< SNAPSHOT_* state of each container. */
+    Bucket* copies; /**< Copies made by writers before changing a container. */
+    DeferredFree* deferredFrees; /**< Strings removed while the snapshot is active. */
+    size_t deferredCount; /**< Number of strings in deferredFrees. */
+    size_t deferredSlots; /**< Capacity of deferredFrees. */
+    size_t extraBytes; /**< Memory held only because of the snapshot. */
+    int numericValues; /**< The values are numbers, as in the table. */
+};
+
+/**
+ * @brief Value stored compressed.
+ * @details Containers point one byte past the start of the header, so the lowest pointer bit
+ *          tells compressed values from plain strings, which malloc and the arenas always align.
+ */
+typedef struct {
+    uint32_t length; /**< Length of the original value, without the terminator. */
+    uint32_t compressedLength; /**< Number of compressed bytes in data. */
+    unsigned char data[]; /**< Compressed bytes. */
+} CompressedValue;
+
+/** @brief Caller visit of an ordered index scan, wrapped to hand out plain value strings. */
+typedef struct {
+    const HashTable* ht; /**< Table being scanned. */
+    OrderedIndexVisit visit; /**< Function called for each pair. */
+    void* context; /**< Opaque pointer passed to visit. */
+} ScanVisit;
+
+/*  FUNCTION DEFINITIONS */
+
+/** 
+ * @brief Returns the lookup counter slot owned by the calling thread.
+ * @details Each thread is handed the next slot on its first lookup, so counters are
+ *          updated without sharing cache lines until more than STATS_COUNTER_SLOTS threads exist.
+ * @return Index into HashTable::lookupCounters.
+ */
+static int statsSlotIndex(void) {
+    static atomic_int nextSlot = 0;
+    static _Thread_local int slot = -1;
+
+    if (slot < 0) {
+        slot = atomic_fetch_add(&nextSlot, 1) % STATS_COUNTER_SLOTS;
+    }
+    return slot;
+}
+
+/** 
+ * @brief Maps an anonymous region aligned to HUGE_PAGE_SIZE and advises huge pages for it.
+ * @param length Length of the region, a multiple of HUGE_PAGE_SIZE.
+ * @return Start of the region, or NULL if the mapping failed.
+ */
+static void* mapTransparentHugePages(size_t length) {
+    // Over-map by one huge page so the region can be trimmed to a huge page boundary
+    char* raw = (char*)mmap(NULL, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return NULL;
+    }
+    char* aligned = (char*)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+    if (aligned > raw) {
+        munmap(raw, aligned - raw);
+    }
+    munmap(aligned + length, raw + HUGE_PAGE_SIZE - aligned);
+
+    // Failure only means the kernel keeps using regular pages
+    madvise(aligned, length, MADV_HUGEPAGE);
+    return aligned;
+}
+
+/** 
+ * @brief Applies the table NUMA policy to a mapping that has not been touched yet.
+ * @details Uses the raw mbind system call so no libnuma is needed. Failure (for example a
+ *          kernel without NUMA support) leaves the kernel default first-touch placement.
+ * @param ht Pointer to the hash table whose policy is used.
+ * @param start Start of the mapping.
+ * @param length Length of the mapping.
+ */
+static void bindToNumaNodes(const HashTable* ht, void* start, size_t length) {
+    unsigned long nodeMask = 0;
+    int mode;
+
+    if (ht->numaPolicy == NUMA_INTERLEAVE) {
+        int nodes = numaNodeCount();
+        nodeMask = nodes >= (int)(8 * sizeof(nodeMask)) ? ~0UL : (1UL << nodes) - 1;
+        mode = MPOL_INTERLEAVE;
+    } else {
+        nodeMask = 1UL << ht->numaNode;
+        mode = MPOL_BIND;
+    }
+    syscall(SYS_mbind, start, length, mode, &nodeMask, 8 * sizeof(nodeMask), 0);
+}
+
+/** 
+ * @brief Allocates a zeroed array of containers following the table page and NUMA policies.
+ * @param ht Pointer to the hash table whose policies are used.
+ * @param capacity Number of containers.
+ * @param mappedBytes Receives the length of the mapping, or 0 for a heap allocation.
+ * @return Pointer to the array of empty containers.
+ */
+static Bucket* allocateContainers(const HashTable* ht, int capacity, size_t* mappedBytes) {
+    size_t bytes = sizeof(Bucket) * capacity;
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    void* containers = NULL;
+    *mappedBytes = 0;
+
+    // Small arrays stay on the heap, a huge page would be mostly empty
+    int hugePages = ht->pagePolicy != PAGES_DEFAULT && bytes >= HUGE_PAGE_SIZE;
+    // NUMA placement works on whole pages, so placed arrays are mapped on their own
+    int placed = ht->numaPolicy != NUMA_DEFAULT && bytes >= pageSize;
+
+    if (hugePages || placed) {
+        size_t alignment = hugePages ? HUGE_PAGE_SIZE : pageSize;
+        size_t length = (bytes + alignment - 1) & ~(alignment - 1);
+        if (hugePages && ht->pagePolicy == PAGES_HUGETLB) {
+            containers = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (containers == MAP_FAILED) {
+                containers = NULL;
+            }
+        }
+        if (containers == NULL && hugePages) {
+            containers = mapTransparentHugePages(length);
+        }
+        if (containers == NULL && !hugePages) {
+            containers = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (containers == MAP_FAILED) {
+                containers = NULL;
+            }
+        }
+        if (containers != NULL) {
+            // Place the pages before anything touches them
+            if (ht->numaPolicy != NUMA_DEFAULT) {
+                bindToNumaNodes(ht, containers, length);
+            }
+            // Anonymous mappings are zero filled, so every container starts empty
+            *mappedBytes = length;
+            return (Bucket*)containers;
+        }
+    }
+
+    containers = calloc(capacity, sizeof(Bucket));
+    if (containers == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    return (Bucket*)containers;
+}
+
+/** 
+ * @brief Releases an array of containers allocated by allocateContainers.
+ * @param containers Pointer to the array.
+ * @param mappedBytes Length of the mapping, or 0 for a heap allocation.
+ */
+static void releaseContainers(Bucket* containers, size_t mappedBytes) {
+    if (mappedBytes > 0) {
+        munmap(containers, mappedBytes);
+    } else {
+        free(containers);
+    }
+}
+
+/** 
+ * @brief Moves the array of containers to a fresh allocation made with the current policies.
+ * @param ht Pointer to the hash table.
+ */
+static void reallocateContainers(HashTable* ht) {
+    size_t newMappedBytes;
+    Bucket* newTable = allocateContainers(ht, ht->capacity, &newMappedBytes);
+    memcpy(newTable, ht->table, sizeof(Bucket) * ht->capacity);
+    releaseContainers(ht->table, ht->tableMappedBytes);
+    ht->table = newTable;
+    ht->tableMappedBytes = newMappedBytes;
+}
+
+/** @brief Container functions of Bucket: growBucket, appendToBucket, removeFromBucket, releaseBucket, findInBucket. */
+DEFINE_STRING_BUCKET_ENGINE(Bucket, BUCKET_INITIAL_SLOTS)
+
+/** 
+ * @brief Whether a pair is the newest of its key, the one lookups return.
+ * @param bucket Pointer to the container.
+ * @param slot Slot of the pair.
+ * @return Non-zero if no later pair of the container has the same key.
+ */
+static int isNewestPair(const Bucket* bucket, int slot) {
+    return findInBucket(bucket, bucket->hashes[slot], bucket->keys[slot], bucket->lengths[slot]) == slot;
+}
+
+/** 
+ * @brief Pair of the same key that a pair shadows.
+ * @param bucket Pointer to the container.
+ * @param slot Slot of the shadowing pair.
+ * @return Slot of the latest earlier pair with the same key, or -1 if there is none.
+ */
+static int shadowedPair(const Bucket* bucket, int slot) {
+    for (int i = slot - 1; i >= 0; --i) {
+        if (bucket->hashes[i] == bucket->hashes[slot] && bucket->lengths[i] == bucket->lengths[slot] &&
+            equalKeyBytes(bucket->keys[i], bucket->keys[slot], bucket->lengths[slot])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/** 
+ * @brief Whether a stored value is compressed.
+ * @param stored Value pointer kept in a container.
+ * @return Non-zero for a compressed value.
+ */
+static int isCompressedValue(const char* stored) {
+    return ((uintptr_t)stored & 1) != 0;
+}
+
+/** 
+ * @brief Header of a compressed value.
+ * @param stored Tagged value pointer kept in a container.
+ * @return Pointer to the header.
+ */
+static CompressedValue* asCompressedValue(const char* stored) {
+    return (CompressedValue*)((uintptr_t)stored - 1);
+}
+
+/** 
+ * @brief Start of the allocation behind a stored value, the pointer to free.
+ * @param stored Value pointer kept in a container.
+ * @return Pointer returned by malloc.
+ */
+static void* valueAllocation(char* stored) {
+    return isCompressedValue(stored) ? (void*)asCompressedValue(stored) : (void*)stored;
+}
+
+/** 
+ * @brief Bytes allocated for a stored value.
+ * @param stored Value pointer kept in a container.
+ * @return Number of bytes.
+ */
+static size_t storedValueBytes(const char* stored) {
+    if (isCompressedValue(stored)) {
+        return sizeof(CompressedValue) + asCompressedValue(stored)->compressedLength;
+    }
+    return strlen(stored) + 1;
+}
+
+/** 
+ * @brief Copies a key or value into memory owned by the table.
+ * @details Once compaction is enabled the copy is carved from the arenas of the table, unless
+ *          it is too long for them.
+ * @param ht Pointer to the hash table.
+ * @param bytes Bytes to copy.
+ * @param length Number of bytes, terminator included.
+ * @return The copy.
+ */
+static char* copyPairString(const HashTable* ht, const void* bytes, size_t length) {
+    char* copy = ht->arenas != NULL ? allocateEntryString(ht->arenas, length) : NULL;
+    if (copy == NULL) {
+        copy = (char*)malloc(length);
+        if (copy == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(copy, bytes, length);
+    return copy;
+}
+
+/** 
+ * @brief Whether a key or value allocation came from the heap rather than an arena.
+ * @param ht Pointer to the hash table.
+ * @param allocation Allocation of the key or value.
+ * @return Non-zero for a heap allocation.
+ */
+static int isHeapString(const HashTable* ht, const void* allocation) {
+    return ht->arenas == NULL || !ownsEntryString(ht->arenas, allocation);
+}
+
+/** 
+ * @brief Frees a key or value allocation, from an arena or from the heap.
+ * @param ht Pointer to the hash table.
+ * @param allocation Allocation of the key or value.
+ * @param bytes Size of the allocation.
+ */
+static void releasePairString(HashTable* ht, void* allocation, size_t bytes) {
+    if (isHeapString(ht, allocation)) {
+        free(allocation);
+    } else {
+        releaseEntryString(ht->arenas, allocation, bytes);
+    }
+}
+
+/** 
+ * @brief Copies a value for storage, compressed when it reaches the table threshold and shrinks.
+ * @param ht Pointer to the hash table.
+ * @param value Value to store.
+ * @param length Length of the value.
+ * @return Copy owned by the table, tagged when compressed.
+ */
+static char* storeValue(const HashTable* ht, const char* value, size_t length) {
+    if (ht->compressionThreshold > 0 && length >= ht->compressionThreshold && length <= UINT32_MAX) {
+        CompressedValue* compressed = (CompressedValue*)malloc(sizeof(CompressedValue) + compressedBound(length));
+        if (compressed == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        size_t compressedLength = compressValue(value, length, compressed->data, compressedBound(length));
+
+        // Keep the value plain unless compression actually saves memory
+        if (compressedLength > 0 && sizeof(CompressedValue) + compressedLength < length + 1) {
+            compressed->length = (uint32_t)length;
+            compressed->compressedLength = (uint32_t)compressedLength;
+            if (ht->arenas != NULL) {
+                char* dense = copyPairString(ht, compressed, sizeof(CompressedValue) + compressedLength);
+                free(compressed);
+                return dense + 1;
+            }
+            CompressedValue* shrunk = (CompressedValue*)realloc(compressed, sizeof(CompressedValue) + compressedLength);
+            if (shrunk != NULL) {
+                compressed = shrunk;
+            }
+            return (char*)((uintptr_t)compressed + 1);
+        }
+        free(compressed);
+    }
+    return copyPairString(ht, value, length + 1);
+}
+
+/** 
+ * @brief Copies a stored value into a caller buffer, decompressing it if needed.
+ * @param stored Value pointer kept in a container.
+ * @param buffer Buffer receiving the value, always terminated when not empty.
+ * @param bufferSize Size of the buffer, longer values are truncated.
+ * @return Length of the whole value.
+ */
+static size_t copyValue(const char* stored, char* buffer, size_t bufferSize) {
+    size_t length;
+    size_t copied;
+
+    if (isCompressedValue(stored)) {
+        const CompressedValue* compressed = asCompressedValue(stored);
+        length = compressed->length;
+        copied = bufferSize > 0 ? decompressValue(compressed->data, compressed->compressedLength, buffer, bufferSize - 1) : 0;
+    } else {
+        length = strlen(stored);
+        copied = bufferSize > 0 ? (length < bufferSize - 1 ? length : bufferSize - 1) : 0;
+        memcpy(buffer, stored, copied);
+    }
+    if (bufferSize > 0) {
+        buffer[copied] = '\0';
+    }
+    return length;
+}
+
+/** 
+ * @brief Plain string of a stored value.
+ * @details Compressed values are decompressed into a buffer owned by the calling thread,
+ *          which the next call on that thread overwrites.
+ * @param stored Value pointer kept in a container.
+ * @return The value as a string.
+ */
+static const char* valueString(const char* stored) {
+    static _Thread_local char* buffer = NULL;
+    static _Thread_local size_t bufferSize = 0;
+
+    if (!isCompressedValue(stored)) {
+        return stored;
+    }
+    size_t needed = (size_t)asCompressedValue(stored)->length + 1;
+    if (needed > bufferSize) {
+        char* grown = (char*)realloc(buffer, needed);
+        if (grown == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        buffer = grown;
+        bufferSize = needed;
+    }
+    copyValue(stored, buffer, bufferSize);
+    return buffer;
+}
+
+_Static_assert(sizeof(char*) == sizeof(int64_t), "numbers are held in pointer sized value slots");
+
+/** 
+ * @brief Value slot holding a number.
+ * @param number Value of a numeric table.
+ * @return The number, in the place of a value pointer.
+ */
+static char* numberSlot(int64_t number) {
+    return (char*)(uintptr_t)(uint64_t)number;
+}
+
+/** 
+ * @brief Number held by a value slot of a numeric table.
+ * @param stored Value slot.
+ * @return The number.
+ */
+static int64_t slotNumber(const char* stored) {
+    return (int64_t)(uint64_t)(uintptr_t)stored;
+}
+
+/** 
+ * @brief Plain string of a stored value, formatting numbers in decimal.
+ * @details Strings built here live in a buffer owned by the calling thread, which the
+ *          next call on that thread overwrites.
+ * @param numeric The value is a number.
+ * @param stored Value slot kept in a container.
+ * @return The value as a string.
+ */
+static const char* displayValue(int numeric, const char* stored) {
+    static _Thread_local char buffer[24];
+
+    if (!numeric) {
+        return valueString(stored);
+    }
+    snprintf(buffer, sizeof(buffer), "%" PRId64, slotNumber(stored));
+    return buffer;
+}
+
+/** 
+ * @brief Publishes a mutation carrying a value to the change feed of the table.
+ * @param ht Pointer to a hash table with a change feed.
+ * @param op Kind of mutation.
+ * @param key Key of the pair.
+ * @param value Value to publish, NULL to publish @p number in decimal.
+ * @param number Number to publish when @p value is NULL.
+ */
+static void publishPairChange(HashTable* ht, ChangeOp op, const char* key, const char* value, int64_t number) {
+    char digits[24];
+
+    if (value == NULL) {
+        snprintf(digits, sizeof(digits), "%" PRId64, number);
+        value = digits;
+    }
+    publishChange(ht->changeFeed, op, key, strlen(key), value, strlen(value));
+}
+
+/** 
+ * @brief Keeps the snapshot view of a container before a writer changes it.
+ * @details If the snapshot reader already claimed the live container, the writer waits
+ *          until that single container has been read instead of copying it.
+ * @param ht Pointer to the hash table.
+ * @param index Index of the container about to change.
+ */
+static void preserveForSnapshot(HashTable* ht, unsigned int index) {
+    HashTableSnapshot* snapshot = ht->snapshot;
+    if (snapshot == NULL || snapshot->ownsTable) {
+        return;
+    }
+
+    atomic_uchar* state = &snapshot->states[index];
+    unsigned char expected = SNAPSHOT_LIVE;
+    if (atomic_compare_exchange_strong_explicit(state, &expected, SNAPSHOT_COPYING,
+                                                memory_order_acquire, memory_order_acquire)) {
+        // Copy the arrays, the strings stay shared until the snapshot is released
+        const Bucket* live = &ht->table[index];
+        Bucket* copy = &snapshot->copies[index];
+        for (int i = 0; i < live->count; ++i) {
+            snapshot->extraBytes += appendToBucket(copy, live->keys[i], live->values[i], live->hashes[i], live->lengths[i]);
+        }
+        snapshot->extraBytes += sizeof(Bucket);
+        atomic_store_explicit(state, SNAPSHOT_COPIED, memory_order_release);
+        return;
+    }
+
+    // Wait for the reader to finish the live container
+    while (expected == SNAPSHOT_READING) {
+        expected = atomic_load_explicit(state, memory_order_acquire);
+    }
+}
+
+/** 
+ * @brief Frees a removed key or value, or keeps it for the snapshot while one is active.
+ * @param ht Pointer to the hash table.
+ * @param allocation Allocation of the key or value being removed.
+ * @param bytes Size of the allocation.
+ */
+static void freePairString(HashTable* ht, void* allocation, size_t bytes) {
+    HashTableSnapshot* snapshot = ht->snapshot;
+    if (snapshot == NULL) {
+        releasePairString(ht, allocation, bytes);
+        return;
+    }
+
+    if (snapshot->deferredCount == snapshot->deferredSlots) {
+        snapshot->deferredSlots = snapshot->deferredSlots == 0 ? 64 : snapshot->deferredSlots * 2;
+        snapshot->deferredFrees = (DeferredFree*)realloc(snapshot->deferredFrees, sizeof(DeferredFree) * snapshot->deferredSlots);
+        if (snapshot->deferredFrees == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+    snapshot->deferredFrees[snapshot->deferredCount].allocation = allocation;
+    snapshot->deferredFrees[snapshot->deferredCount].bytes = bytes;
+    snapshot->deferredCount++;
+    snapshot->extraBytes += bytes;
+}
+
+/** 
+ * @brief Initializes a hash table with a given capacity.
+ * @param ht Pointer to the hash table to be initialized.
+ * @param capacity Initial capacity of the hash table.
+ */
+void initHashTable(HashTable* ht, int capacity) {
+    // Initialize each container as empty
+    ht->pagePolicy = PAGES_DEFAULT;
+    ht->numaPolicy = NUMA_DEFAULT;
+    ht->numaNode = 0;
+    ht->rehashThreads = 1;
+    ht->snapshot = NULL;
+    ht->orderedIndex = NULL;
+    ht->lookupFilter = NULL;
+    ht->memoryBudget = 0;
+    ht->budgetPolicy = BUDGET_REJECT;
+    ht->budgetCallback = NULL;
+    ht->budgetContext = NULL;
+    ht->evictionCursor = 0;
+    ht->budgetRejects = 0;
+    ht->budgetEvictions = 0;
+    ht->compressionThreshold = 0;
+    ht->compressedValues = 0;
+    ht->compressedOriginalBytes = 0;
+    ht->compressedStoredBytes = 0;
+    ht->numericValues = 0;
+    ht->changeFeed = NULL;
+    ht->arenas = NULL;
+    ht->compactionCursor = 0;
+    ht->compactionPending = 0;
+    ht->compactionTrim = 0;
+    ht->hotKeys = NULL;
+    ht->table = allocateContainers(ht, capacity, &ht->tableMappedBytes);
+    ht->size = 0;
+    ht->capacity = capacity;
+    ht->resizeCount = 0;
+    ht->resizeSeconds = 0.0;
+    ht->entryBytes = 0;
+    ht->stringBytes = 0;
+
+    // Allocate the per-thread lookup counters on their own cache lines
+    ht->lookupCounters = (LookupCounterSlot*)aligned_alloc(CACHE_LINE_SIZE, sizeof(LookupCounterSlot) * STATS_COUNTER_SLOTS);
+    if (ht->lookupCounters == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < STATS_COUNTER_SLOTS; ++i) {
+        atomic_init(&ht->lookupCounters[i].hits, 0);
+        atomic_init(&ht->lookupCounters[i].misses, 0);
+    }
+}
+
+/** 
+ * @brief Bytes an insertion will add to hashTableMemoryBytes.
+ * @details Exact for the strings, the container arrays and the ordered index; with compaction
+ *          enabled, strings carved from an arena are counted as if on the heap, plus the arena
+ *          mapped for them if the current one is full. When the insertion
+ *          resizes the table, the array of containers and the filter double and the container
+ *          arrays are re-created, which may come out slightly larger or smaller than before.
+ * @param ht Pointer to the hash table.
+ * @param hash Full hash of the key.
+ * @param pairBytes Bytes of the key and value copies.
+ * @return Number of bytes.
+ */
+static size_t insertionBytes(const HashTable* ht, unsigned int hash, size_t pairBytes) {
+    size_t needed = pairBytes;
+
+    if ((double)ht->size / ht->capacity > LOAD_FACTOR_THRESHOLD) {
+        needed += sizeof(Bucket) * ht->capacity;
+        if (ht->lookupFilter != NULL) {
+            needed += membershipFilterBytes(ht->lookupFilter);
+        }
+    } else {
+        const Bucket* bucket = &ht->table[hash % ht->capacity];
+        if (bucket->count == bucket->slots) {
+            int newSlots = bucket->slots == 0 ? BUCKET_INITIAL_SLOTS : bucket->slots;
+            needed += (size_t)newSlots * BucketSlotBytes();
+        }
+    }
+    if (ht->orderedIndex != NULL) {
+        needed += orderedIndexInsertBytes(ht->orderedIndex);
+    }
+    if (ht->arenas != NULL) {
+        needed += entryArenasGrowthBytes(ht->arenas, pairBytes);
+    }
+    return needed;
+}
+
+/** 
+ * @brief Removes the pair in a given slot, handles resizing if necessary.
+ * @param ht Pointer to the hash table.
+ * @param index Index of the container.
+ * @param slot Slot of the pair inside the container.
+ */
+static void removeSlot(HashTable* ht, unsigned int index, int slot) {
+    Bucket* bucket = &ht->table[index];
+    preserveForSnapshot(ht, index);
+
+    // Free memory for the removed pair
+    if (ht->changeFeed != NULL) {
+        publishChange(ht->changeFeed, CHANGE_REMOVE, bucket->keys[slot], bucket->lengths[slot], NULL, 0);
+    }
+    if (ht->orderedIndex != NULL) {
+        removeOrderedIndex(ht->orderedIndex, bucket->keys[slot]);
+    }
+    if (ht->lookupFilter != NULL) {
+        removeMembershipFilter(ht->lookupFilter, bucket->hashes[slot]);
+    }
+    // A pair the removed one shadowed becomes the newest of its key again, earlier slots keep their place
+    int restored = ht->orderedIndex != NULL && isNewestPair(bucket, slot) ? shadowedPair(bucket, slot) : -1;
+    char* value = bucket->values[slot];
+    size_t keyBytes = (size_t)bucket->lengths[slot] + 1;
+    ht->stringBytes -= keyBytes;
+    freePairString(ht, bucket->keys[slot], keyBytes);
+    if (!ht->numericValues) {
+        size_t valueBytes = storedValueBytes(value);
+        if (isCompressedValue(value)) {
+            ht->compressedValues--;
+            ht->compressedOriginalBytes -= asCompressedValue(value)->length + 1;
+            ht->compressedStoredBytes -= valueBytes;
+        }
+        ht->stringBytes -= valueBytes;
+        freePairString(ht, valueAllocation(value), valueBytes);
+    }
+
+    // Close the hole, keeping the pairs in insertion order
+    removeFromBucket(bucket, slot);
+    if (restored >= 0) {
+        insertOrderedIndex(ht->orderedIndex, bucket->keys[restored], bucket->values[restored]);
+    }
+    if (bucket->count == 0) {
+        ht->entryBytes -= releaseBucket(bucket);
+    }
+
+    // Decrement the size of the hashtable
+    ht->size--;
+
+    // Check if resizing is needed, halving keeps the load factor below the growth threshold
+    if ((double)ht->size / ht->capacity < SHRINK_LOAD_FACTOR && ht->capacity / 2 >= INITIAL_CAPACITY) {
+        shrinkHashTable(ht);
+    }
+}
+
+/** 
+ * @brief Removes one pair to make room under the memory budget.
+ * @details Walks the containers round-robin from HashTable::evictionCursor, so evictions
+ *          spread over the whole table instead of emptying one region.
+ * @param ht Pointer to the hash table.
+ * @return 1 if a pair was removed, 0 if the table is empty.
+ */
+static int evictPair(HashTable* ht) {
+    if (ht->size == 0) {
+        return 0;
+    }
+    unsigned int index = (unsigned int)ht->evictionCursor % ht->capacity;
+    while (ht->table[index].count == 0) {
+        index = (index + 1) % ht->capacity;
+    }
+    ht->evictionCursor = (int)((index + 1) % ht->capacity);
+    removeSlot(ht, index, ht->table[index].count - 1);
+    ht->budgetEvictions++;
+    return 1;
+}
+
+/** 
+ * @brief Makes sure an insertion fits in the memory budget, following the budget policy.
+ * @param ht Pointer to the hash table.
+ * @param hash Full hash of the key.
+ * @param pairBytes Bytes of the key and value copies.
+ * @return 1 if the insertion may go ahead, 0 if it must be rejected.
+ */
+static int reserveMemory(HashTable* ht, unsigned int hash, size_t pairBytes) {
+    for (;;) {
+        // Evictions and callbacks change both sides, so recompute each round
+        size_t used = hashTableMemoryBytes(ht);
+        size_t needed = insertionBytes(ht, hash, pairBytes);
+        if (used + needed <= ht->memoryBudget) {
+            return 1;
+        }
+        if (ht->budgetPolicy == BUDGET_EVICT) {
+            if (!evictPair(ht)) {
+                return 0;
+            }
+        } else if (ht->budgetPolicy == BUDGET_CALLBACK && ht->budgetCallback != NULL) {
+            if (!ht->budgetCallback(ht, used + needed - ht->memoryBudget, ht->budgetContext)) {
+                return 0;
+            }
+        } else {
+            return 0;
+        }
+    }
+}
+
+/** 
+ * @brief Appends a pair whose value is already in its stored form, handles resizing if necessary.
+ * @param ht Pointer to the hash table.
+ * @param hash Full hash of the key.
+ * @param key Key of the pair.
+ * @param ownedKey Heap copy of the key handed over by the caller, NULL to duplicate @p key here.
+ * @param value Value as given by the caller, for the change feed; unused by numeric tables.
+ * @param ownedValue Stored value, released here if the memory budget rejects the pair.
+ * @param valueLength Length of the original value, used for the compression statistics.
+ * @param reserved The caller already made room for the pair under the memory budget.
+ * @return 1 if the pair was inserted, 0 if the memory budget rejected it.
+ */
+static int insertStoredPair(HashTable* ht, unsigned int hash, const char* key, char* ownedKey, const char* value, char* ownedValue, size_t valueLength, int reserved) {
+    // Make room for the pair if the table has a budget; numbers take no memory of their own
+    size_t valueBytes = ht->numericValues ? 0 : storedValueBytes(ownedValue);
+    size_t keyLength = strlen(key);
+    size_t pairBytes = keyLength + 1 + valueBytes;
+    if (ht->memoryBudget > 0 && !reserved && !reserveMemory(ht, hash, pairBytes)) {
+        if (!ht->numericValues) {
+            releasePairString(ht, valueAllocation(ownedValue), valueBytes);
+        }
+        free(ownedKey);
+        ht->budgetRejects++;
+        return 0;
+    }
+
+    // Check if resizing is needed
+    if ((double)ht->size / ht->capacity > LOAD_FACTOR_THRESHOLD) {
+        resizeHashTable(ht);
+    }
+
+    // Calculate the container index
+    unsigned int index = hash % ht->capacity;
+    Bucket* bucket = &ht->table[index];
+    preserveForSnapshot(ht, index);
+
+    // Copy the key, into an arena when compaction is enabled, and append the pair to the container
+    if (ownedKey == NULL) {
+        ownedKey = copyPairString(ht, key, keyLength + 1);
+    }
+    if (ht->orderedIndex != NULL) {
+        // The index holds only the newest pair of a key, which the new pair shadows
+        int shadowed = findInBucket(bucket, hash, key, keyLength);
+        if (shadowed >= 0) {
+            removeOrderedIndex(ht->orderedIndex, bucket->keys[shadowed]);
+        }
+        insertOrderedIndex(ht->orderedIndex, ownedKey, ownedValue);
+    }
+    ht->entryBytes += appendToBucket(bucket, ownedKey, ownedValue, hash, (unsigned int)keyLength);
+    if (ht->lookupFilter != NULL) {
+        addMembershipFilter(ht->lookupFilter, hash);
+    }
+
+    // Account for the memory owned by the new pair
+    ht->stringBytes += pairBytes;
+    if (!ht->numericValues && isCompressedValue(ownedValue)) {
+        ht->compressedValues++;
+        ht->compressedOriginalBytes += valueLength + 1;
+        ht->compressedStoredBytes += valueBytes;
+    }
+    if (ht->changeFeed != NULL) {
+        publishPairChange(ht, CHANGE_INSERT, ownedKey, ht->numericValues ? NULL : value, slotNumber(ownedValue));
+    }
+
+    // Increment the size of the hashtable
+    ht->size++;
+    return 1;
+}
+
+/** 
+ * @brief Inserts a key-value pair into the hash table, handles resizing if necessary.
+ * @details With a memory budget set, the budget policy runs first and nothing but the
+ *          compressed value, if any, is allocated for a rejected pair. Numeric tables parse
+ *          the value as a decimal integer. A key already present is added again rather than
+ *          replaced: lookups return the newest value, and removing the key brings the
+ *          previous one back.
+ * @param ht Pointer to the hash table.
+ * @param key Key of the pair.
+ * @param value Value associated with the key.
+ * @return 1 if the pair was inserted, 0 if the memory budget rejected it.
+ */
+int insertKeyValPair(HashTable* ht, const char* key, const char* value) {
+    return insertHashedKeyValPair(ht, hashKey(key), key, value);
+}
+
+/** 
+ * @brief Inserts a key-value pair whose hash the caller already computed, see insertKeyValPair.
+ * @param ht Pointer to the hash table.
+ * @param hash hashKey of @p key.
+ * @param key Key of the pair.
+ * @param value Value associated with the key.
+ * @return 1 if the pair was inserted, 0 if the memory budget rejected it.
+ */
+int insertHashedKeyValPair(HashTable* ht, unsigned int hash, const char* key, const char* value) {
+    // Copy the value
+    if (ht->numericValues) {
+        return insertStoredPair(ht, hash, key, NULL, NULL, numberSlot(strtoll(value, NULL, 10)), 0, 0);
+    }
+    size_t valueLength = strlen(value);
+
+    // Check plain values against the budget before copying them, so a rejected pair carves nothing from an arena
+    int compressible = ht->compressionThreshold > 0 && valueLength >= ht->compressionThreshold;
+    if (ht->memoryBudget > 0 && !compressible && !reserveMemory(ht, hash, strlen(key) + 1 + valueLength + 1)) {
+        ht->budgetRejects++;
+        return 0;
+    }
+    return insertStoredPair(ht, hash, key, NULL, value, storeValue(ht, value, valueLength), valueLength, !compressible);
+}
+
+/** 
+ * @brief Inserts a pair whose strings and hash the caller already prepared, taking ownership.
+ * @details Saves the copies and the hashing insertKeyValPair makes, e.g. for a bulk import
+ *          that allocated the strings on other threads. Values above the compression threshold
+ *          are still compressed, and numeric tables parse the value.
+ * @param ht Pointer to the hash table.
+ * @param hash hashKey of @p key.
+ * @param key Heap allocated key, freed by the table.
+ * @param value Heap allocated value, freed by the table.
+ * @return 1 if the pair was inserted, 0 if the memory budget rejected it and freed both strings.
+ */
+int adoptKeyValPair(HashTable* ht, unsigned int hash, char* key, char* value) {
+    // Adopted strings stay on the heap until a compaction pass moves them
+    if (ht->arenas != NULL) {
+        ht->compactionPending = 1;
+    }
+    if (ht->numericValues) {
+        int64_t number = strtoll(value, NULL, 10);
+        free(value);
+        return insertStoredPair(ht, hash, key, key, NULL, numberSlot(number), 0, 0);
+    }
+    size_t valueLength = strlen(value);
+    if (ht->compressionThreshold > 0 && valueLength >= ht->compressionThreshold) {
+        // The plain value outlives the insertion for the change feed
+        char* stored = storeValue(ht, value, valueLength);
+        int inserted = insertStoredPair(ht, hash, key, key, value, stored, valueLength, 0);
+        free(value);
+        return inserted;
+    }
+    return insertStoredPair(ht, hash, key, key, value, value, valueLength, 0);
+}
+
+/** 
+ * @brief Removes a key-value pair from the hash table, handles resizing if necessary.
+ * @details The table is halved once its load factor drops below SHRINK_LOAD_FACTOR, and
+ *          never below INITIAL_CAPACITY.
+ * @param ht Pointer to the hash table.
+ * @param key Key of the pair to be removed.
+ */
+void removeKeyValPair(HashTable* ht, const char* key) {
+    removeHashedKeyValPair(ht, hashKey(key), key);
+}
+
+/** 
+ * @brief Removes a key-value pair whose hash the caller already computed.
+ * @param ht Pointer to the hash table.
+ * @param hash hashKey of @p key.
+ * @param key Key of the pair to be removed.
+ */
+void removeHashedKeyValPair(HashTable* ht, unsigned int hash, const char* key) {
+    // Calculate the container index
+    unsigned int index = hash % ht->capacity;
+
+    int slot = findInBucket(&ht->table[index], hash, key, strlen(key));
+    if (slot >= 0) {
+        removeSlot(ht, index, slot);
+    }
+}
+
+/** 
+ * @brief Finds the stored value of a key whose hash is known and counts the lookup.
+ * @details The value slot is read atomically, since addToExistingValue may be changing
+ *          a number under a shared lock.
+ * @param ht Pointer to the hash table.
+ * @param hash hashKey of @p key.
+ * @param key Key to look up.
+ * @param length Length of the key.
+ * @param stored Receives the value slot kept in the container.
+ * @return 1 if the key was found, 0 otherwise.
+ */
+static int findHashedValue(const HashTable* ht, unsigned int hash, const char* key, size_t length, const char** stored) {
+    LookupCounterSlot* counters = &ht->lookupCounters[statsSlotIndex()];
+
+    // Most missing keys are turned away before touching a container
+    if (ht->lookupFilter != NULL && !mayContainMembershipFilter(ht->lookupFilter, hash)) {
+        atomic_fetch_add_explicit(&counters->misses, 1, memory_order_relaxed);
+        return 0;
+    }
+    if (ht->hotKeys != NULL) {
+        sampleHotKey(ht->hotKeys, hash);
+    }
+    const Bucket* bucket = &ht->table[hash % ht->capacity];
+
+    int slot = findInBucket(bucket, hash, key, length);
+    if (slot >= 0) {
+        atomic_fetch_add_explicit(&counters->hits, 1, memory_order_relaxed);
+        *stored = __atomic_load_n(&bucket->values[slot], __ATOMIC_RELAXED);
+        return 1;
+    }
+
+    // Key not found
+    atomic_fetch_add_explicit(&counters->misses, 1, memory_order_relaxed);
+    return 0;
+}
+
+/** 
+ * @brief Finds the stored value of a key and counts the lookup, see findHashedValue.
+ * @param ht Pointer to the hash table.
+ * @param key Key to look up.
+ * @param stored Receives the value slot kept in the container.
+ * @return 1 if the key was found, 0 otherwise.
+ */
+static int findValue(const HashTable* ht, const char* key, const char** stored) {
+    size_t length = strlen(key);
+    return findHashedValue(ht, hashKeyBytes(key, length), key, length, stored);
+}
+
+/** 
+ * @brief Looks up the value associated with a given key in the hash table.
+ * @details A compressed value is decompressed, and a number formatted, into a buffer owned
+ *          by the calling thread that only stays valid until its next lookup;
+ *          lookup_hashTableInto avoids that copy.
+ * @param ht Pointer to the hash table.
+ * @param key Key to look up.
+ * @return Value associated with the key, or NULL if not found.
+ */
+const char* lookup_hashTable(const HashTable* ht, const char* key) {
+    const char* stored;
+    return findValue(ht, key, &stored) ? displayValue(ht->numericValues, stored) : NULL;
+}
+
+/** 
+ * @brief Copies a value slot into a caller buffer, see lookup_hashTableInto.
+ * @param ht Pointer to the hash table.
+ * @param stored Value slot kept in the container.
+ * @param buffer Buffer receiving the value, always terminated when not empty.
+ * @param bufferSize Size of the buffer, longer values are truncated.
+ * @return Length of the whole value.
+ */
+static int copyStoredValue(const HashTable* ht, const char* stored, char* buffer, size_t bufferSize) {
+    if (ht->numericValues) {
+        return snprintf(buffer, bufferSize, "%" PRId64, slotNumber(stored));
+    }
+    return (int)copyValue(stored, buffer, bufferSize);
+}
+
+/** 
+ * @brief Looks up a key and copies its value into a caller buffer.
+ * @details Compressed values are decompressed straight into @p buffer, stopping once it is full.
+ *          Numbers are formatted in decimal.
+ * @param ht Pointer to the hash table.
+ * @param key Key to look up.
+ * @param buffer Buffer receiving the value, always terminated when not empty.
+ * @param bufferSize Size of the buffer, longer values are truncated.
+ * @return Length of the whole value, or -1 if the key was not found.
+ */
+int lookup_hashTableInto(const HashTable* ht, const char* key, char* buffer, size_t bufferSize) {
+    const char* stored;
+    return findValue(ht, key, &stored) ? copyStoredValue(ht, stored, buffer, bufferSize) : -1;
+}
+
+/** 
+ * @brief Looks up a key whose hash the caller already computed, see lookup_hashTableInto.
+ * @param ht Pointer to the hash table.
+ * @param hash hashKey of @p key.
+ * @param key Key to look up.
+ * @param buffer Buffer receiving the value, always terminated when not empty.
+ * @param bufferSize Size of the buffer, longer values are truncated.
+ * @return Length of the whole value, or -1 if the key was not found.
+ */
+int lookupHashedKeyInto(const HashTable* ht, unsigned int hash, const char* key, char* buffer, size_t bufferSize) {
+    const char* stored;
+    return findHashedValue(ht, hash, key, strlen(key), &stored) ? copyStoredValue(ht, stored, buffer, bufferSize) : -1;
+}
+
+/** 
+ * @brief Frees the memory allocated for the hash table and its key-value pairs.
+ * @param ht Pointer to the hash table to be freed.
+ */
+void freeHashTable(HashTable* ht) {
+    // Iterate through each container in the hashtable
+    for (int i = 0; i < ht->capacity; ++i) {
+        Bucket* bucket = &ht->table[i];
+        // Free memory for the keys and values, then the container arrays
+        for (int j = 0; j < bucket->count; ++j) {
+            if (isHeapString(ht, bucket->keys[j])) {
+                free(bucket->keys[j]);
+            }
+            if (!ht->numericValues && isHeapString(ht, valueAllocation(bucket->values[j]))) {
+                free(valueAllocation(bucket->values[j]));
+            }
+        }
+        releaseBucket(bucket);
+    }
+    // Free the array of containers, then the arenas holding the other strings all at once
+    releaseContainers(ht->table, ht->tableMappedBytes);
+    if (ht->arenas != NULL) {
+        freeEntryArenas(ht->arenas);
+        free(ht->arenas);
+    }
+    free(ht->lookupCounters);
+    if (ht->orderedIndex != NULL) {
+        freeOrderedIndex(ht->orderedIndex);
+        free(ht->orderedIndex);
+    }
+    if (ht->lookupFilter != NULL) {
+        freeMembershipFilter(ht->lookupFilter);
+        free(ht->lookupFilter);
+    }
+    free(ht->hotKeys);
+}
+
+/** 
+ * @brief Moves the pairs of a range of old containers into the new array of containers.
+ * @details The new capacity is a multiple of the old one, so old container i only feeds new
+ *          containers i, i + capacity, ..., and workers with disjoint ranges never write the
+ *          same container.
+ * @param arg Pointer to the RehashRange to move.
+ * @return NULL.
+ */
+static void* rehashRange(void* arg) {
+    RehashRange* range = (RehashRange*)arg;
+
+    for (int i = range->first; i < range->last; ++i) {
+        Bucket* bucket = &range->oldTable[i];
+        for (int j = 0; j < bucket->count; ++j) {
+            unsigned int hash = bucket->hashes[j];
+            range->entryBytes += appendToBucket(&range->newTable[hash % range->newCapacity], bucket->keys[j],
+                                                bucket->values[j], hash, bucket->lengths[j]);
+        }
+        if (!range->keepOld) {
+            releaseBucket(bucket);
+        }
+    }
+    return NULL;
+}
+
+/** 
+ * @brief Sizes the lookup filter for the current capacity and fills it from the stored hashes.
+ * @details The filter holds up to capacity * LOAD_FACTOR_THRESHOLD keys at its target rate,
+ *          which is as many as the table holds before it grows again.
+ * @param ht Pointer to the hash table.
+ */
+static void rebuildLookupFilter(HashTable* ht) {
+    MembershipFilter* filter = ht->lookupFilter;
+    double falsePositiveRate = filter->falsePositiveRate;
+
+    freeMembershipFilter(filter);
+    initMembershipFilter(filter, (size_t)(ht->capacity * LOAD_FACTOR_THRESHOLD) + 1, falsePositiveRate);
+    for (int i = 0; i < ht->capacity; ++i) {
+        const Bucket* bucket = &ht->table[i];
+        for (int j = 0; j < bucket->count; ++j) {
+            addMembershipFilter(filter, bucket->hashes[j]);
+        }
+    }
+}
+
+/** 
+ * @brief Moves every pair into a new array of containers.
+ * @details Keys are not rehashed, the full hash stored next to each pair gives the new container.
+ *          When growing large arrays the work is split across HashTable::rehashThreads workers.
+ *          With a snapshot active the old array is handed over to it instead of being freed.
+ * @param ht Pointer to the hash table.
+ * @param newCapacity Number of containers of the new array.
+ */
+static void rehashTable(HashTable* ht, int newCapacity) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Allocate memory for the new array of containers, each initialized as empty
+    size_t newMappedBytes;
+    Bucket* newTable = allocateContainers(ht, newCapacity, &newMappedBytes);
+    HashTableSnapshot* snapshot = ht->snapshot;
+    int keepOld = snapshot != NULL && !snapshot->ownsTable;
+
+    // Split the current containers into one range per worker; ranges only stay
+    // disjoint in the new array when it grows, so shrinking runs on one thread
+    int workers = ht->capacity >= PARALLEL_REHASH_MIN_CONTAINERS && newCapacity > ht->capacity ? ht->rehashThreads : 1;
+    RehashRange ranges[MAX_REHASH_THREADS];
+    pthread_t threads[MAX_REHASH_THREADS];
+    int started[MAX_REHASH_THREADS] = { 0 };
+    for (int w = 0; w < workers; ++w) {
+        ranges[w] = (RehashRange){ ht->table, newTable, newCapacity,
+                                   (int)((long long)ht->capacity * w / workers),
+                                   (int)((long long)ht->capacity * (w + 1) / workers), keepOld, 0 };
+    }
+
+    // Move every pair of every current container into its new container, the caller
+    // takes the first range and runs any range whose thread could not be started
+    for (int w = 1; w < workers; ++w) {
+        started[w] = pthread_create(&threads[w], NULL, rehashRange, &ranges[w]) == 0;
+    }
+    rehashRange(&ranges[0]);
+    size_t entryBytes = ranges[0].entryBytes;
+    for (int w = 1; w < workers; ++w) {
+        if (started[w]) {
+            pthread_join(threads[w], NULL);
+        } else {
+            rehashRange(&ranges[w]);
+        }
+        entryBytes += ranges[w].entryBytes;
+    }
+
+    if (keepOld) {
+        // The snapshot now owns the old array, changes to the new one no longer concern it
+        snapshot->ownsTable = 1;
+        snapshot->extraBytes += ht->entryBytes + sizeof(Bucket) * ht->capacity;
+    } else {
+        // Free the memory allocated for the old array of containers
+        releaseContainers(ht->table, ht->tableMappedBytes);
+    }
+    // Update the hash table with the new array of containers and capacity
+    ht->table = newTable;
+    ht->tableMappedBytes = newMappedBytes;
+    ht->capacity = newCapacity;
+    ht->entryBytes = entryBytes;
+    if (ht->lookupFilter != NULL) {
+        rebuildLookupFilter(ht);
+    }
+
+    // Record the resize in the table statistics
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ht->resizeCount++;
+    ht->resizeSeconds += (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/** 
+ * @brief Resizes the hash table by doubling its size and redistributing existing key-value pairs.
+ * @param ht Pointer to the hash table to be resized.
+ */
+void resizeHashTable(HashTable* ht) {
+    // Calculate the new capacity (double the current capacity)
+    rehashTable(ht, ht->capacity * 2);
+}
+
+/** 
+ * @brief Grows the table once so that @p pairs fit without further resizing.
+ * @details The capacity is multiplied by a power of two, so each new container is fed by a
+ *          single old one and the rehash can still be split across threads.
+ * @param ht Pointer to the hash table.
+ * @param pairs Number of pairs the table should hold.
+ */
+void reserveHashTable(HashTable* ht, int pairs) {
+    int newCapacity = ht->capacity;
+    while ((double)pairs / newCapacity > LOAD_FACTOR_THRESHOLD && newCapacity <= INT32_MAX / 2) {
+        newCapacity *= 2;
+    }
+    if (newCapacity > ht->capacity) {
+        rehashTable(ht, newCapacity);
+    }
+}
+
+/** 
+ * @brief Shrinks the hash table by halving its size and redistributing existing key-value pairs.
+ * @details Called by removals below SHRINK_LOAD_FACTOR. That bound is a quarter of the growth
+ *          threshold, so the halved table is at most half as loaded as the growth threshold and
+ *          alternating inserts and removals cannot make it grow and shrink back and forth.
+ * @param ht Pointer to the hash table to be shrunk.
+ */
+void shrinkHashTable(HashTable* ht) {
+    rehashTable(ht, ht->capacity / 2);
+}
+
+/** 
+ * @brief Hash function of the keys.
+ * @details Uses the implementation from key_hash.h selected at startup: AES-NI or CRC32C
+ *          when the CPU has them, FNV-1a otherwise.
+ * @param key Key for which the hash value is calculated.
+ * @return Calculated hash value, stored next to the key in its container.
+ */
+unsigned int hashKey(const char* key) {
+    return hashKeyBytes(key, strlen(key));
+}
+
+/** 
+ * @brief Container index of a key.
+ * @param key Key for which the index is calculated.
+ * @param capacity Current capacity of the hash table.
+ * @return Hash value of the key rounded to the hashtable capacity.
+ */
+unsigned int hashFunction(const char* key, int capacity) {
+    // Round the calculated hash value to fit within the hashtable capacity
+    return hashKey(key) % capacity;
+}
+
+/** 
+ * @brief Collects a statistics snapshot of the hash table.
+ * @details The chain-length histogram is built from every container, and the
+ *          per-thread lookup counters are summed, so the call costs O(capacity).
+ * @param ht Pointer to the hash table.
+ * @param stats Pointer to the structure receiving the statistics.
+ */
+void getHashTableStats(const HashTable* ht, HashTableStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->size = ht->size;
+    stats->capacity = ht->capacity;
+    stats->loadFactor = (double)ht->size / ht->capacity;
+    stats->resizeCount = ht->resizeCount;
+    stats->resizeSeconds = ht->resizeSeconds;
+    stats->entryBytes = ht->entryBytes;
+    stats->stringBytes = ht->stringBytes;
+    stats->bucketBytes = sizeof(Bucket) * ht->capacity;
+    stats->indexBytes = ht->orderedIndex != NULL ? ht->orderedIndex->bytes : 0;
+    stats->filterBytes = ht->lookupFilter != NULL ? membershipFilterBytes(ht->lookupFilter) : 0;
+    stats->totalBytes = hashTableMemoryBytes(ht);
+    stats->memoryBudget = ht->memoryBudget;
+    stats->budgetRejects = ht->budgetRejects;
+    stats->budgetEvictions = ht->budgetEvictions;
+    stats->compressedValues = ht->compressedValues;
+    stats->compressedOriginalBytes = ht->compressedOriginalBytes;
+    stats->compressedStoredBytes = ht->compressedStoredBytes;
+    if (ht->arenas != NULL) {
+        stats->arenaMappedBytes = ht->arenas->mappedBytes;
+        stats->arenaReleasedBytes = (size_t)ht->arenas->releasedPages * ENTRY_ARENA_PAGE_BYTES;
+        stats->arenasReleased = ht->arenas->releasedArenas;
+    }
+
+    // Build the chain-length histogram
+    for (int i = 0; i < ht->capacity; ++i) {
+        int length = ht->table[i].count;
+        if (length > stats->longestChain) {
+            stats->longestChain = length;
+        }
+        stats->chainHistogram[length < CHAIN_HISTOGRAM_BUCKETS ? length : CHAIN_HISTOGRAM_BUCKETS - 1]++;
+    }
+
+    // Aggregate the per-thread lookup counters
+    for (int i = 0; i < STATS_COUNTER_SLOTS; ++i) {
+        stats->lookupHits += atomic_load_explicit(&ht->lookupCounters[i].hits, memory_order_relaxed);
+        stats->lookupMisses += atomic_load_explicit(&ht->lookupCounters[i].misses, memory_order_relaxed);
+    }
+}
+
+/** 
+ * @brief Prints a statistics snapshot in a human readable form.
+ * @param stats Pointer to the statistics to print.
+ */
+void printHashTableStats(const HashTableStats* stats) {
+    printf("Size: %d, Capacity: %d, Load factor: %.2f\n", stats->size, stats->capacity, stats->loadFactor);
+    printf("Resizes: %lu (%.6f s)\n", stats->resizeCount, stats->resizeSeconds);
+    printf("Memory: entries %zu B, strings %zu B, containers %zu B, index %zu B, filter %zu B\n",
+           stats->entryBytes, stats->stringBytes, stats->bucketBytes, stats->indexBytes, stats->filterBytes);
+    printf("Total memory: %zu B", stats->totalBytes);
+    if (stats->memoryBudget > 0) {
+        printf(" of %zu B budget (%lu rejected, %lu evicted)", stats->memoryBudget, stats->budgetRejects, stats->budgetEvictions);
+    }
+    printf("\n");
+    if (stats->compressedValues > 0) {
+        printf("Compressed values: %lu, %zu B stored for %zu B (ratio %.2f)\n", stats->compressedValues,
+               stats->compressedStoredBytes, stats->compressedOriginalBytes,
+               (double)stats->compressedOriginalBytes / stats->compressedStoredBytes);
+    }
+    if (stats->arenaMappedBytes > 0) {
+        printf("Arenas: %zu B mapped, %zu B of pages and %lu arenas released\n", stats->arenaMappedBytes,
+               stats->arenaReleasedBytes, stats->arenasReleased);
+    }
+    printf("Lookups: %llu hits, %llu misses\n", stats->lookupHits, stats->lookupMisses);
+    printf("Chain lengths (longest %d):", stats->longestChain);
+    for (int i = 0; i < CHAIN_HISTOGRAM_BUCKETS; ++i) {
+        printf(" %d%s:%lu", i, i == CHAIN_HISTOGRAM_BUCKETS - 1 ? "+" : "", stats->chainHistogram[i]);
+    }
+    printf("\n");
+}
+
+/** 
+ * @brief Selects the memory backing of the array of containers.
+ * @details The current array is moved to the new backing right away; arrays smaller
+ *          than HUGE_PAGE_SIZE stay on the heap until a resize makes them large enough.
+ *          String arenas enabled later by enableHashTableCompaction follow the policy too.
+ * @param ht Pointer to the hash table.
+ * @param policy Page policy to use from now on.
+ */
+void setHashTablePagePolicy(HashTable* ht, PagePolicy policy) {
+    ht->pagePolicy = policy;
+    reallocateContainers(ht);
+}
+
+/** 
+ * @brief Selects the NUMA placement of the array of containers.
+ * @details Like the page policy, the current array is moved right away and every
+ *          resize allocates with the same placement.
+ * @param ht Pointer to the hash table.
+ * @param policy NUMA policy to use from now on.
+ * @param node Node to bind to with NUMA_BIND, ignored otherwise.
+ */
+void setHashTableNumaPolicy(HashTable* ht, NumaPolicy policy, int node) {
+    ht->numaPolicy = policy;
+    ht->numaNode = node;
+    reallocateContainers(ht);
+}
+
+/** 
+ * @brief Number of NUMA nodes of the machine.
+ * @details Parsed once from /sys/devices/system/node/online ("0" or "0-1"), 1 when unavailable.
+ * @return Number of online NUMA nodes.
+ */
+int numaNodeCount(void) {
+    static atomic_int nodes = 0;
+
+    if (atomic_load(&nodes) == 0) {
+        int first = 0, last = 0;
+        FILE* online = fopen("/sys/devices/system/node/online", "r");
+        if (online != NULL) {
+            if (fscanf(online, "%d-%d", &first, &last) < 2) {
+                last = first;
+            }
+            fclose(online);
+        }
+        atomic_store(&nodes, last + 1);
+    }
+    return atomic_load(&nodes);
+}
+
+/** 
+ * @brief Sets the number of threads resizeHashTable uses on large arrays of containers.
+ * @param ht Pointer to the hash table.
+ * @param threads Number of threads, clamped to 1..MAX_REHASH_THREADS.
+ */
+void setHashTableRehashThreads(HashTable* ht, int threads) {
+    ht->rehashThreads = threads < 1 ? 1 : threads > MAX_REHASH_THREADS ? MAX_REHASH_THREADS : threads;
+}
+
+/** 
+ * @brief Freezes a consistent view of the table for a background reader.
+ * @details Must be called by the thread that inserts and removes. Afterwards writers keep
+ *          running while another thread walks the view with forEachSnapshotPair. Only one
+ *          snapshot can be active, and page or NUMA policies must not change meanwhile.
+ * @param ht Pointer to the hash table.
+ * @return The snapshot, or NULL if one is already active.
+ */
+HashTableSnapshot* snapshotHashTable(HashTable* ht) {
+    if (ht->snapshot != NULL) {
+        return NULL;
+    }
+
+    HashTableSnapshot* snapshot = (HashTableSnapshot*)calloc(1, sizeof(HashTableSnapshot));
+    if (snapshot == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    snapshot->table = ht->table;
+    snapshot->capacity = ht->capacity;
+    snapshot->tableMappedBytes = ht->tableMappedBytes;
+    snapshot->numericValues = ht->numericValues;
+    snapshot->states = (atomic_uchar*)calloc(ht->capacity, sizeof(atomic_uchar));
+    snapshot->copies = (Bucket*)calloc(ht->capacity, sizeof(Bucket));
+    if (snapshot->states == NULL || snapshot->copies == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    snapshot->extraBytes = sizeof(HashTableSnapshot) + sizeof(atomic_uchar) * ht->capacity;
+
+    ht->snapshot = snapshot;
+    return snapshot;
+}
+
+/** 
+ * @brief Calls @p visit for every pair of the snapshot.
+ * @details Safe to run on another thread while the owner keeps inserting and removing.
+ * @param snapshot Snapshot to walk.
+ * @param visit Function called with each key and value.
+ * @param context Opaque pointer passed to @p visit.
+ */
+void forEachSnapshotPair(HashTableSnapshot* snapshot, void (*visit)(const char* key, const char* value, void* context), void* context) {
+    for (int i = 0; i < snapshot->capacity; ++i) {
+        atomic_uchar* state = &snapshot->states[i];
+        unsigned char expected = SNAPSHOT_LIVE;
+
+        // Claim the live container, or use the copy a writer made
+        if (atomic_compare_exchange_strong_explicit(state, &expected, SNAPSHOT_READING,
+                                                    memory_order_acquire, memory_order_acquire)) {
+            const Bucket* live = &snapshot->table[i];
+            for (int j = 0; j < live->count; ++j) {
+                visit(live->keys[j], displayValue(snapshot->numericValues, live->values[j]), context);
+            }
+            atomic_store_explicit(state, SNAPSHOT_READ, memory_order_release);
+            continue;
+        }
+        while (expected == SNAPSHOT_COPYING) {
+            expected = atomic_load_explicit(state, memory_order_acquire);
+        }
+        const Bucket* copy = expected == SNAPSHOT_COPIED ? &snapshot->copies[i] : &snapshot->table[i];
+        for (int j = 0; j < copy->count; ++j) {
+            visit(copy->keys[j], displayValue(snapshot->numericValues, copy->values[j]), context);
+        }
+    }
+}
+
+/** 
+ * @brief Memory held only because of the snapshot.
+ * @details Covers the per-container states, copied containers, a handed over array of
+ *          containers and removed strings waiting to be freed.
+ * @param snapshot Snapshot to inspect.
+ * @return Number of extra bytes.
+ */
+size_t snapshotExtraBytes(const HashTableSnapshot* snapshot) {
+    return snapshot->extraBytes;
+}
+
+/** 
+ * @brief Releases a snapshot once its reader is done.
+ * @details Must be called by the thread that inserts and removes, after forEachSnapshotPair returned.
+ * @param ht Pointer to the hash table the snapshot was taken from.
+ * @param snapshot Snapshot to release.
+ */
+void releaseHashTableSnapshot(HashTable* ht, HashTableSnapshot* snapshot) {
+    ht->snapshot = NULL;
+
+    // Copies and a handed over array share their strings with the table, only the arrays go
+    for (int i = 0; i < snapshot->capacity; ++i) {
+        releaseBucket(&snapshot->copies[i]);
+        if (snapshot->ownsTable) {
+            releaseBucket(&snapshot->table[i]);
+        }
+    }
+    if (snapshot->ownsTable) {
+        releaseContainers(snapshot->table, snapshot->tableMappedBytes);
+    }
+
+    // Strings removed meanwhile are no longer referenced by anyone
+    for (size_t i = 0; i < snapshot->deferredCount; ++i) {
+        releasePairString(ht, snapshot->deferredFrees[i].allocation, snapshot->deferredFrees[i].bytes);
+    }
+    free(snapshot->deferredFrees);
+    free(snapshot->states);
+    free(snapshot->copies);
+    free(snapshot);
+}
+
+/** 
+ * @brief Maintains an ordered index of the keys alongside the containers from now on.
+ * @details The index points at the key and value strings the table already owns, and is
+ *          built from the current pairs. Only the newest pair of a key is indexed, so scans
+ *          see the same value as lookups. Lookups do not use it; insertions and removals
+ *          keep it up to date.
+ * @param ht Pointer to the hash table.
+ */
+void enableOrderedIndex(HashTable* ht) {
+    if (ht->orderedIndex != NULL) {
+        return;
+    }
+    ht->orderedIndex = (OrderedIndex*)malloc(sizeof(OrderedIndex));
+    if (ht->orderedIndex == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    initOrderedIndex(ht->orderedIndex);
+
+    for (int i = 0; i < ht->capacity; ++i) {
+        const Bucket* bucket = &ht->table[i];
+        for (int j = 0; j < bucket->count; ++j) {
+            if (isNewestPair(bucket, j)) {
+                insertOrderedIndex(ht->orderedIndex, bucket->keys[j], bucket->values[j]);
+            }
+        }
+    }
+}
+
+/** 
+ * @brief Passes an indexed pair on to the caller visit with its value decompressed.
+ * @details The index keeps the value slot from the time of the insertion, which for a number
+ *          may be outdated, so numbers are read again from their container.
+ * @param key Key of the pair.
+ * @param value Value pointer kept in the container.
+ * @param context Pointer to the ScanVisit.
+ * @return Whatever the caller visit returned.
+ */
+static int visitIndexedPair(const char* key, const char* value, void* context) {
+    const ScanVisit* scan = (const ScanVisit*)context;
+    const HashTable* ht = scan->ht;
+
+    if (ht->numericValues) {
+        size_t length = strlen(key);
+        unsigned int hash = hashKeyBytes(key, length);
+        const Bucket* bucket = &ht->table[hash % ht->capacity];
+        int slot = findInBucket(bucket, hash, key, length);
+        if (slot < 0) {
+            return 0;
+        }
+        value = bucket->values[slot];
+    }
+    return scan->visit(key, displayValue(ht->numericValues, value), scan->context);
+}
+
+/** 
+ * @brief Visits the pairs whose key starts with @p prefix, in key order.
+ * @param ht Pointer to the hash table.
+ * @param prefix Required prefix.
+ * @param visit Function called for each pair, returning non-zero stops the scan.
+ * @param context Opaque pointer passed to @p visit.
+ * @return 1 if the scan ran, 0 if the ordered index is not enabled.
+ */
+int scanHashTablePrefix(const HashTable* ht, const char* prefix, OrderedIndexVisit visit, void* context) {
+    if (ht->orderedIndex == NULL) {
+        return 0;
+    }
+    ScanVisit scan = { ht, visit, context };
+    scanOrderedIndexPrefix(ht->orderedIndex, prefix, visitIndexedPair, &scan);
+    return 1;
+}
+
+/** 
+ * @brief Visits the pairs with low <= key < high, in key order.
+ * @param ht Pointer to the hash table.
+ * @param low Inclusive lower bound.
+ * @param high Exclusive upper bound, NULL for none.
+ * @param visit Function called for each pair, returning non-zero stops the scan.
+ * @param context Opaque pointer passed to @p visit.
+ * @return 1 if the scan ran, 0 if the ordered index is not enabled.
+ */
+int scanHashTableRange(const HashTable* ht, const char* low, const char* high, OrderedIndexVisit visit, void* context) {
+    if (ht->orderedIndex == NULL) {
+        return 0;
+    }
+    ScanVisit scan = { ht, visit, context };
+    scanOrderedIndexRange(ht->orderedIndex, low, high, visitIndexedPair, &scan);
+    return 1;
+}
+
+/** 
+ * @brief Consults a membership filter before the containers from now on.
+ * @details Lookups of most missing keys then return without touching a container. The
+ *          filter is built from the stored hashes, kept up to date by insertions and removals
+ *          and resized together with the table. Calling it again changes the target rate.
+ * @param ht Pointer to the hash table.
+ * @param falsePositiveRate Fraction of missing keys allowed through to the containers, e.g. 0.01.
+ */
+void enableLookupFilter(HashTable* ht, double falsePositiveRate) {
+    if (ht->lookupFilter == NULL) {
+        ht->lookupFilter = (MembershipFilter*)calloc(1, sizeof(MembershipFilter));
+        if (ht->lookupFilter == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+    ht->lookupFilter->falsePositiveRate = falsePositiveRate;
+    rebuildLookupFilter(ht);
+}
+
+/** 
+ * @brief Bounds the memory of the table.
+ * @details Every insertion first works out the bytes it will add and, when the total would go
+ *          over @p budget, applies @p policy before allocating anything. A callback returning
+ *          non-zero must have freed memory (for example by removing pairs) or raised the budget.
+ * @param ht Pointer to the hash table.
+ * @param budget Upper bound on hashTableMemoryBytes, 0 to remove the bound.
+ * @param policy What to do with insertions that do not fit.
+ * @param callback Function called with BUDGET_CALLBACK, NULL otherwise.
+ * @param context Opaque pointer passed to @p callback.
+ */
+void setHashTableMemoryBudget(HashTable* ht, size_t budget, BudgetPolicy policy, BudgetCallback callback, void* context) {
+    ht->memoryBudget = budget;
+    ht->budgetPolicy = policy;
+    ht->budgetCallback = callback;
+    ht->budgetContext = context;
+}
+
+/** 
+ * @brief Every byte the table allocated.
+ * @details Covers the array of containers (its whole mapping when mapped), the container
+ *          arrays, the key and value copies, the lookup counters, the ordered index, the
+ *          lookup filter and the hot key sketch. With compaction enabled, the strings carved
+ *          from arenas are replaced by the arena mappings, spares included, and their
+ *          bookkeeping. Memory held by an active snapshot is reported by snapshotExtraBytes.
+ * @param ht Pointer to the hash table.
+ * @return Number of bytes.
+ */
+size_t hashTableMemoryBytes(const HashTable* ht) {
+    size_t bytes = ht->tableMappedBytes > 0 ? ht->tableMappedBytes : sizeof(Bucket) * ht->capacity;
+    bytes += ht->entryBytes + ht->stringBytes + sizeof(LookupCounterSlot) * STATS_COUNTER_SLOTS;
+
+    if (ht->orderedIndex != NULL) {
+        bytes += sizeof(OrderedIndex) + ht->orderedIndex->bytes;
+    }
+    if (ht->lookupFilter != NULL) {
+        bytes += sizeof(MembershipFilter) + membershipFilterBytes(ht->lookupFilter);
+    }
+    if (ht->hotKeys != NULL) {
+        bytes += sizeof(HotKeySketch);
+    }
+    if (ht->arenas != NULL) {
+        // stringBytes covers the arena strings too, the mappings take their place
+        bytes = bytes - ht->arenas->stringBytes + entryArenasBytes(ht->arenas);
+    }
+    return bytes;
+}
+
+/** 
+ * @brief Stores long values compressed from now on.
+ * @details Values inserted later that are at least @p threshold bytes long are compressed
+ *          when that saves memory; values already stored are left as they are. Tables that
+ *          never set a threshold skip the codec entirely.
+ * @param ht Pointer to the hash table.
+ * @param threshold Shortest value to compress, 0 to stop compressing.
+ */
+void setHashTableCompression(HashTable* ht, size_t threshold) {
+    ht->compressionThreshold = threshold;
+}
+
+/** 
+ * @brief Stores values as 64-bit integers held in the containers from now on.
+ * @details Only an empty table switches, since the values already stored would otherwise be
+ *          read as numbers and never released. Numbers need no allocation of their own, so
+ *          incrementKeyValue updates a counter with one probe and no allocation. String
+ *          values given to insertKeyValPair are parsed in decimal, and lookups format the
+ *          number back into a string. Compression does not apply to numbers.
+ * @param ht Pointer to the hash table.
+ * @return 1 if the table now holds numbers, 0 if it is not empty and nothing changed.
+ */
+int setHashTableNumericValues(HashTable* ht) {
+    if (ht->size > 0) {
+        return 0;
+    }
+    ht->numericValues = 1;
+    return 1;
+}
+
+/** 
+ * @brief Adds @p delta to the number of a key, inserting the key with @p delta if absent.
+ * @details Decrement with a negative delta. Only for numeric tables; a string table is left
+ *          untouched, since adding to its value slots would overwrite the string pointers.
+ * @param ht Pointer to the hash table.
+ * @param key Key of the counter.
+ * @param delta Amount to add.
+ * @param newValue Receives the number after the addition, may be NULL.
+ * @return 1 on success, 0 if the table is not numeric or the memory budget rejected a new key.
+ */
+int incrementKeyValue(HashTable* ht, const char* key, int64_t delta, int64_t* newValue) {
+    if (!ht->numericValues) {
+        return 0;
+    }
+    size_t length = strlen(key);
+    unsigned int hash = hashKeyBytes(key, length);
+    unsigned int index = hash % ht->capacity;
+    Bucket* bucket = &ht->table[index];
+
+    int slot = findInBucket(bucket, hash, key, length);
+    if (slot < 0) {
+        if (newValue != NULL) {
+            *newValue = delta;
+        }
+        return insertStoredPair(ht, hash, key, NULL, NULL, numberSlot(delta), 0, 0);
+    }
+    preserveForSnapshot(ht, index);
+    int64_t number = slotNumber(bucket->values[slot]) + delta;
+    bucket->values[slot] = numberSlot(number);
+    if (ht->changeFeed != NULL) {
+        publishPairChange(ht, CHANGE_ADD, key, NULL, delta);
+    }
+    if (newValue != NULL) {
+        *newValue = number;
+    }
+    return 1;
+}
+
+/** 
+ * @brief Atomically adds @p delta to the number of a key already in the table.
+ * @details The addition is a lock-free fetch-add on the value slot, so any number of threads
+ *          may call this at once as long as none inserts or removes meanwhile, e.g. under the
+ *          shared lock of a ShardedHashTable. Changes are not preserved for a snapshot.
+ * @param ht Pointer to a numeric hash table.
+ * @param key Key of the counter.
+ * @param delta Amount to add.
+ * @param newValue Receives the number after the addition, may be NULL.
+ * @return 1 on success, 0 if the table is not numeric or the key is absent and nothing was added.
+ */
+int addToExistingValue(HashTable* ht, const char* key, int64_t delta, int64_t* newValue) {
+    if (!ht->numericValues) {
+        return 0;
+    }
+    size_t length = strlen(key);
+    unsigned int hash = hashKeyBytes(key, length);
+    Bucket* bucket = &ht->table[hash % ht->capacity];
+
+    int slot = findInBucket(bucket, hash, key, length);
+    if (slot < 0) {
+        return 0;
+    }
+    // The slot is pointer sized, and GCC does not scale additions to pointers in __atomic builtins
+    char* old = __atomic_fetch_add(&bucket->values[slot], (uintptr_t)(uint64_t)delta, __ATOMIC_RELAXED);
+    if (ht->changeFeed != NULL) {
+        publishPairChange(ht, CHANGE_ADD, key, NULL, delta);
+    }
+    if (newValue != NULL) {
+        *newValue = slotNumber(old) + delta;
+    }
+    return 1;
+}
+
+/** 
+ * @brief Looks up the number of a key in a numeric table.
+ * @param ht Pointer to the hash table.
+ * @param key Key to look up.
+ * @param value Receives the number.
+ * @return 1 if the key was found, 0 if it is absent or the table is not numeric.
+ */
+int lookup_hashTableNumber(const HashTable* ht, const char* key, int64_t* value) {
+    const char* stored;
+    if (!ht->numericValues || !findValue(ht, key, &stored)) {
+        return 0;
+    }
+    *value = slotNumber(stored);
+    return 1;
+}
+
+/** 
+ * @brief Publishes every later mutation of the table to a change feed.
+ * @details Insertions publish CHANGE_INSERT with the value as given, removals and budget
+ *          evictions CHANGE_REMOVE, and counter increments CHANGE_ADD with the delta, which
+ *          commutes, so concurrent addToExistingValue calls may publish in either order.
+ *          Pairs already in the table are not published. The feed is not owned by the
+ *          table; the shards of a ShardedHashTable may share one, since publishing is lock-free.
+ * @param ht Pointer to the hash table.
+ * @param feed Feed to publish to, NULL to stop publishing.
+ */
+void setHashTableChangeFeed(HashTable* ht, ChangeFeed* feed) {
+    ht->changeFeed = feed;
+}
+
+/** 
+ * @brief Keeps the key and value copies in dense arenas from now on, see compactHashTable.
+ * @details Later insertions carve their strings from 1 MiB arenas instead of the heap; strings
+ *          already in the table, and those handed over to adoptKeyValPair, move there during
+ *          compaction passes. Strings longer than ENTRY_ARENA_MAX_STRING always stay on the heap.
+ *          Under a huge page policy the arenas are single 2 MiB huge pages, given back whole
+ *          rather than page by page; the arenas keep the policy in force at this call.
+ *          From then on hashTableMemoryBytes, and so the memory budget, counts the arena
+ *          mappings instead of the strings carved from them; getHashTableStats reports the
+ *          mapped bytes and the pages given back.
+ * @param ht Pointer to the hash table.
+ */
+void enableHashTableCompaction(HashTable* ht) {
+    if (ht->arenas != NULL) {
+        return;
+    }
+    ht->arenas = (EntryArenas*)malloc(sizeof(EntryArenas));
+    if (ht->arenas == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    EntryArenaPages pages = ht->pagePolicy == PAGES_HUGETLB ? ARENA_PAGES_HUGETLB
+                          : ht->pagePolicy == PAGES_TRANSPARENT_HUGE ? ARENA_PAGES_TRANSPARENT_HUGE : ARENA_PAGES_REGULAR;
+    initEntryArenas(ht->arenas, pages);
+    ht->compactionCursor = 0;
+    ht->compactionPending = ht->size > 0;
+    ht->compactionTrim = 0;
+}
+
+/** 
+ * @brief Moves the strings of a pair that sit on the heap or in an arena being evacuated.
+ * @param ht Pointer to the hash table.
+ * @param bucket Container of the pair.
+ * @param slot Slot of the pair inside the container.
+ * @return Bytes moved.
+ */
+static size_t relocatePair(HashTable* ht, Bucket* bucket, int slot) {
+    char* key = bucket->keys[slot];
+    char* value = bucket->values[slot];
+    int moveKey = shouldMoveEntryString(ht->arenas, key);
+    int moveValue = !ht->numericValues && shouldMoveEntryString(ht->arenas, valueAllocation(value));
+    size_t moved = 0;
+
+    if (!moveKey && !moveValue) {
+        return 0;
+    }
+    // Strings too long for an arena stay where they are
+    size_t keyBytes = (size_t)bucket->lengths[slot] + 1;
+    size_t valueBytes = ht->numericValues ? 0 : storedValueBytes(value);
+    moveKey = moveKey && keyBytes <= ENTRY_ARENA_MAX_STRING;
+    moveValue = moveValue && valueBytes <= ENTRY_ARENA_MAX_STRING;
+    if (!moveKey && !moveValue) {
+        return 0;
+    }
+    // The ordered index finds its entries by key pointer, so it drops the pair while it moves
+    int indexed = ht->orderedIndex != NULL && isNewestPair(bucket, slot);
+    if (indexed) {
+        removeOrderedIndex(ht->orderedIndex, key);
+    }
+    if (moveKey) {
+        ht->compactionTrim |= isHeapString(ht, key);
+        bucket->keys[slot] = copyPairString(ht, key, keyBytes);
+        releasePairString(ht, key, keyBytes);
+        moved += keyBytes;
+    }
+    if (moveValue) {
+        void* allocation = valueAllocation(value);
+        ht->compactionTrim |= isHeapString(ht, allocation);
+        char* copy = copyPairString(ht, allocation, valueBytes);
+        bucket->values[slot] = isCompressedValue(value) ? copy + 1 : copy;
+        releasePairString(ht, allocation, valueBytes);
+        moved += valueBytes;
+    }
+    if (indexed) {
+        insertOrderedIndex(ht->orderedIndex, bucket->keys[slot], bucket->values[slot]);
+    }
+    return moved;
+}
+
+/** 
+ * @brief Runs one bounded step of the incremental compaction of the key and value copies.
+ * @details A pass walks the containers from HashTable::compactionCursor over as many steps as
+ *          it takes. Each step marks the arenas whose live strings fill less than
+ *          COMPACTION_OCCUPANCY of them for evacuation, and the pass moves every string of
+ *          those arenas, and every string still on the heap, into the current arena, so the
+ *          marked arenas empty and are released with madvise(MADV_DONTNEED). Pages
+ *          emptied by ordinary removals are released as soon as that happens. A pass that
+ *          moved heap strings ends with malloc_trim, which gives the freed heap pages back.
+ *          A step stops after moving about @p maxBytes, counting COMPACTION_VISIT_BYTES per
+ *          container visited, and nothing is done while no arena is sparse, so calling it
+ *          after every batch of mutations costs little. It mutates the table: run it where
+ *          insertions and removals run, under the exclusive lock when readers share the
+ *          table, never while a snapshot is active (it then does nothing), and note that it
+ *          invalidates value pointers returned by lookup_hashTable like any other mutation.
+ * @param ht Pointer to a hash table with compaction enabled.
+ * @param maxBytes Work allowed in this step; at least one container is visited.
+ * @return Bytes of strings moved.
+ */
+size_t compactHashTable(HashTable* ht, size_t maxBytes) {
+    size_t moved = 0;
+    size_t work = 0;
+
+    if (ht->arenas == NULL || ht->snapshot != NULL) {
+        return 0;
+    }
+    // A shrink may have left the cursor past the containers, restart the pass then
+    if (ht->compactionCursor >= ht->capacity) {
+        ht->compactionCursor = 0;
+    }
+    // Arenas only get sparser outside the current one, so marking them again at every step
+    // lets the running pass start on those that crossed the threshold since
+    int sparse = startEntryEvacuation(ht->arenas, COMPACTION_OCCUPANCY);
+    if (ht->compactionCursor == 0) {
+        if (sparse == 0 && !ht->compactionPending) {
+            return 0;
+        }
+        ht->compactionPending = 0;
+    }
+
+    do {
+        Bucket* bucket = &ht->table[ht->compactionCursor];
+        for (int j = 0; j < bucket->count; ++j) {
+            size_t bytes = relocatePair(ht, bucket, j);
+            moved += bytes;
+            work += bytes;
+        }
+        work += COMPACTION_VISIT_BYTES;
+
+        // End of the pass: the heap strings moved out left free chunks behind
+        if (++ht->compactionCursor == ht->capacity) {
+            ht->compactionCursor = 0;
+#ifdef __GLIBC__
+            if (ht->compactionTrim) {
+                malloc_trim(0);
+            }
+#endif
+            ht->compactionTrim = 0;
+            break;
+        }
+    } while (work < maxBytes);
+    return moved;
+}
+
+/** 
+ * @brief Samples lookups into a count-min sketch from now on, see hot_keys.h.
+ * @details Lookups of any thread may be sampled concurrently; the sketch costs one extra
+ *          branch per lookup and a few relaxed atomic additions per sampled one.
+ * @param ht Pointer to the hash table.
+ */
+void enableHotKeyTracking(HashTable* ht) {
+    if (ht->hotKeys != NULL) {
+        return;
+    }
+    // Each block of the sketch must sit on a cache line of its own
+    size_t bytes = (sizeof(HotKeySketch) + HOT_KEY_BLOCK_BYTES - 1) & ~(size_t)(HOT_KEY_BLOCK_BYTES - 1);
+    ht->hotKeys = (HotKeySketch*)aligned_alloc(HOT_KEY_BLOCK_BYTES, bytes);
+    if (ht->hotKeys == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    initHotKeySketch(ht->hotKeys);
+}
+
+/** 
+ * @brief Whether a key takes at least 1/HOT_KEY_SHARE of the recent lookups of the table.
+ * @param ht Pointer to the hash table.
+ * @param key Key to check, present in the table or not.
+ * @return Non-zero for a hot key, 0 otherwise or when hot key tracking is disabled.
+ */
+int isHashTableHotKey(const HashTable* ht, const char* key) {
+    return ht->hotKeys != NULL && isHotKey(ht->hotKeys, hashKey(key));
+}
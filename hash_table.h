@@ -0,0 +1,210 @@
+/**
+ * @file hash_table.h
+ * @brief Hash Table for Data storage with string keys and values.
+ *        O(1) run time for value look up, Hash Function, and Resizing of hash table.
+ */
+
+#ifndef HASH_TABLE_H
+#define HASH_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ordered_index.h"
+#include "membership_filter.h"
+#include "change_feed.h"
+#include "entry_arena.h"
+#include "hot_keys.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Initial capacity of the hashtable. */
+#define INITIAL_CAPACITY 10
+/** @brief Load factor used while resizing. */
+#define LOAD_FACTOR_THRESHOLD 0.75
+/** @brief Load factor below which removals halve the table, well under the growth threshold. */
+#define SHRINK_LOAD_FACTOR (LOAD_FACTOR_THRESHOLD / 4)
+/** @brief Number of per-thread lookup counter slots; threads beyond this share slots. */
+#define STATS_COUNTER_SLOTS 64
+/** @brief Buckets of the chain-length histogram; the last one collects all longer chains. */
+#define CHAIN_HISTOGRAM_BUCKETS 8
+/** @brief Cache line size used to keep counter slots of different threads apart. */
+#define CACHE_LINE_SIZE 64
+
+/** @brief Size of a huge page; arrays of containers smaller than this never use huge pages. */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+/** @brief Upper bound on the worker threads of one parallel rehash. */
+#define MAX_REHASH_THREADS 64
+/** @brief Arrays with fewer containers are always rehashed on the calling thread. */
+#define PARALLEL_REHASH_MIN_CONTAINERS 65536
+/** @brief Number of pair slots a container allocates the first time it is used. */
+#define BUCKET_INITIAL_SLOTS 2
+/** @brief Arenas whose live strings fill less than this share of them are evacuated by compaction. */
+#define COMPACTION_OCCUPANCY 0.5
+/** @brief Work a compaction step counts for each container it visits, in bytes moved. */
+#define COMPACTION_VISIT_BYTES 64
+
+/**
+ * @brief Container holding the key-value pairs that hash to it, as parallel arrays.
+ * @details Probing scans only the dense hashes array; keys are compared on a hash and length
+ *          match and values are read on a key match. The arrays share one allocation that starts at keys.
+ */
+typedef struct {
+    char** keys; /**< Keys of the pairs. */
+    char** values; /**< Values associated with the keys. */
+    unsigned int* hashes; /**< Full hash of each key. */
+    unsigned int* lengths; /**< Length of each key, so key comparisons know where to stop. */
+    int count; /**< Number of pairs in the container. */
+    int slots; /**< Number of pairs the arrays can hold. */
+} Bucket;
+
+/** @brief How the array of containers is backed by memory. */
+typedef enum {
+    PAGES_DEFAULT, /**< Regular heap allocation. */
+    PAGES_TRANSPARENT_HUGE, /**< Huge page aligned anonymous mapping advised with MADV_HUGEPAGE. */
+    PAGES_HUGETLB, /**< Explicit MAP_HUGETLB pages, falling back to transparent huge pages when none are reserved. */
+} PagePolicy;
+
+/** @brief NUMA placement of the array of containers. */
+typedef enum {
+    NUMA_DEFAULT, /**< First-touch placement by the kernel. */
+    NUMA_INTERLEAVE, /**< Pages spread round-robin across all NUMA nodes. */
+    NUMA_BIND, /**< Pages bound to HashTable::numaNode. */
+} NumaPolicy;
+
+/** @brief Lookup counters owned by one thread, defined in hash_table.c. */
+typedef struct LookupCounterSlot LookupCounterSlot;
+
+/** @brief Point-in-time view of a hash table, defined in hash_table.c. */
+typedef struct HashTableSnapshot HashTableSnapshot;
+
+/** @brief What an insertion does when it would take the table over its memory budget. */
+typedef enum {
+    BUDGET_REJECT, /**< Refuse the insertion. */
+    BUDGET_EVICT, /**< Remove pairs, walking the containers round-robin, until the new pair fits. */
+    BUDGET_CALLBACK, /**< Ask HashTable::budgetCallback, which may free memory or raise the budget. */
+} BudgetPolicy;
+
+struct HashTable;
+
+/**
+ * @brief Called with BUDGET_CALLBACK when an insertion needs @p neededBytes more than the budget allows.
+ * @return Non-zero to check the budget again, 0 to reject the insertion.
+ */
+typedef int (*BudgetCallback)(struct HashTable* ht, size_t neededBytes, void* context);
+
+/** @brief Structure representing the Hash Table. */
+typedef struct HashTable {
+    Bucket* table; /**< Array of containers, each holding the pairs whose hashes collide on it. */
+    int size; /**< Number of key-value pairs in the hashtable. */
+    int capacity; /**< Current capacity of the hashtable. */
+    unsigned long resizeCount; /**< Number of times the table was resized. */
+    double resizeSeconds; /**< Total wall time spent inside resizeHashTable. */
+    size_t entryBytes; /**< Bytes allocated for the per-container pair arrays. */
+    size_t stringBytes; /**< Bytes allocated for the duplicated keys and values. */
+    LookupCounterSlot* lookupCounters; /**< Per-thread lookup counters, summed by getHashTableStats. */
+    PagePolicy pagePolicy; /**< Memory backing used for the array of containers and the string arenas. */
+    size_t tableMappedBytes; /**< Length of the mapping behind table, 0 when it came from the heap. */
+    NumaPolicy numaPolicy; /**< NUMA placement of the array of containers. */
+    int numaNode; /**< Node the containers are bound to with NUMA_BIND. */
+    int rehashThreads; /**< Threads used by resizeHashTable on large arrays, 1 for serial. */
+    HashTableSnapshot* snapshot; /**< Active snapshot, NULL when none. */
+    OrderedIndex* orderedIndex; /**< Optional ordered index over the same key strings, NULL when disabled. */
+    MembershipFilter* lookupFilter; /**< Optional filter consulted before the containers, NULL when disabled. */
+    size_t memoryBudget; /**< Upper bound on hashTableMemoryBytes, 0 for none. */
+    BudgetPolicy budgetPolicy; /**< What insertions do when they would exceed the budget. */
+    BudgetCallback budgetCallback; /**< Called with BUDGET_CALLBACK. */
+    void* budgetContext; /**< Opaque pointer passed to budgetCallback. */
+    int evictionCursor; /**< Next container BUDGET_EVICT takes a pair from. */
+    unsigned long budgetRejects; /**< Insertions refused because of the budget. */
+    unsigned long budgetEvictions; /**< Pairs removed to stay within the budget. */
+    size_t compressionThreshold; /**< Values at least this long are stored compressed, 0 for never. */
+    unsigned long compressedValues; /**< Number of values stored compressed. */
+    size_t compressedOriginalBytes; /**< Bytes the compressed values would take as plain strings. */
+    size_t compressedStoredBytes; /**< Bytes the compressed values take, headers included. */
+    int numericValues; /**< Values are 64-bit integers held in the containers instead of strings. */
+    ChangeFeed* changeFeed; /**< Feed receiving every mutation, NULL when disabled. */
+    EntryArenas* arenas; /**< Arenas holding the key and value copies once compaction is enabled, NULL when disabled. */
+    int compactionCursor; /**< Next container the compaction pass visits, 0 between passes. */
+    int compactionPending; /**< Strings may still be on the heap, so the next pass runs even without sparse arenas. */
+    int compactionTrim; /**< The running pass moves strings off the heap, which is trimmed when it ends. */
+    HotKeySketch* hotKeys; /**< Sketch sampling the lookups, NULL when hot key tracking is disabled. */
+} HashTable;
+
+/** @brief Snapshot of the hash table health returned by getHashTableStats. */
+typedef struct {
+    int size; /**< Number of key-value pairs. */
+    int capacity; /**< Number of containers. */
+    double loadFactor; /**< size / capacity. */
+    unsigned long chainHistogram[CHAIN_HISTOGRAM_BUCKETS]; /**< Containers per chain length, last entry is "or longer". */
+    int longestChain; /**< Length of the longest chain. */
+    unsigned long resizeCount; /**< Number of resizes so far. */
+    double resizeSeconds; /**< Total time spent resizing. */
+    size_t entryBytes; /**< Bytes allocated for the per-container pair arrays. */
+    size_t stringBytes; /**< Bytes allocated for keys and values. */
+    size_t bucketBytes; /**< Bytes allocated for the array of containers. */
+    size_t indexBytes; /**< Bytes allocated for the ordered index. */
+    size_t filterBytes; /**< Bytes allocated for the lookup filter. */
+    size_t totalBytes; /**< Every byte the table allocated, as returned by hashTableMemoryBytes. */
+    size_t memoryBudget; /**< Memory budget, 0 for none. */
+    unsigned long budgetRejects; /**< Insertions refused because of the budget. */
+    unsigned long budgetEvictions; /**< Pairs removed to stay within the budget. */
+    unsigned long compressedValues; /**< Values stored compressed. */
+    size_t compressedOriginalBytes; /**< Plain size of the compressed values. */
+    size_t compressedStoredBytes; /**< Stored size of the compressed values. */
+    size_t arenaMappedBytes; /**< Bytes mapped for the string arenas, 0 without compaction. */
+    size_t arenaReleasedBytes; /**< Bytes of single emptied pages given back from the arenas so far. */
+    unsigned long arenasReleased; /**< Arenas emptied and released whole, kept as spares or unmapped. */
+    unsigned long long lookupHits; /**< Successful lookups. */
+    unsigned long long lookupMisses; /**< Failed lookups. */
+} HashTableStats;
+
+/*  FUNCTION DECLARATIONS   */
+void initHashTable(HashTable* ht, int capacity);
+int insertKeyValPair(HashTable* ht, const char* key, const char* value);
+int insertHashedKeyValPair(HashTable* ht, unsigned int hash, const char* key, const char* value);
+int adoptKeyValPair(HashTable* ht, unsigned int hash, char* key, char* value);
+void removeKeyValPair(HashTable* ht, const char* key);
+void removeHashedKeyValPair(HashTable* ht, unsigned int hash, const char* key);
+const char* lookup_hashTable(const HashTable* ht, const char* key);
+int lookup_hashTableInto(const HashTable* ht, const char* key, char* buffer, size_t bufferSize);
+int lookupHashedKeyInto(const HashTable* ht, unsigned int hash, const char* key, char* buffer, size_t bufferSize);
+void freeHashTable(HashTable* ht);
+void resizeHashTable(HashTable* ht);
+void reserveHashTable(HashTable* ht, int pairs);
+void shrinkHashTable(HashTable* ht);
+unsigned int hashKey(const char* key);
+unsigned int hashFunction(const char* key, int capacity);
+void getHashTableStats(const HashTable* ht, HashTableStats* stats);
+void printHashTableStats(const HashTableStats* stats);
+void setHashTablePagePolicy(HashTable* ht, PagePolicy policy);
+void setHashTableNumaPolicy(HashTable* ht, NumaPolicy policy, int node);
+int numaNodeCount(void);
+void setHashTableRehashThreads(HashTable* ht, int threads);
+HashTableSnapshot* snapshotHashTable(HashTable* ht);
+void forEachSnapshotPair(HashTableSnapshot* snapshot, void (*visit)(const char* key, const char* value, void* context), void* context);
+size_t snapshotExtraBytes(const HashTableSnapshot* snapshot);
+void releaseHashTableSnapshot(HashTable* ht, HashTableSnapshot* snapshot);
+void enableOrderedIndex(HashTable* ht);
+int scanHashTablePrefix(const HashTable* ht, const char* prefix, OrderedIndexVisit visit, void* context);
+int scanHashTableRange(const HashTable* ht, const char* low, const char* high, OrderedIndexVisit visit, void* context);
+void enableLookupFilter(HashTable* ht, double falsePositiveRate);
+void setHashTableMemoryBudget(HashTable* ht, size_t budget, BudgetPolicy policy, BudgetCallback callback, void* context);
+size_t hashTableMemoryBytes(const HashTable* ht);
+void setHashTableCompression(HashTable* ht, size_t threshold);
+int setHashTableNumericValues(HashTable* ht);
+int incrementKeyValue(HashTable* ht, const char* key, int64_t delta, int64_t* newValue);
+int addToExistingValue(HashTable* ht, const char* key, int64_t delta, int64_t* newValue);
+int lookup_hashTableNumber(const HashTable* ht, const char* key, int64_t* value);
+void setHashTableChangeFeed(HashTable* ht, ChangeFeed* feed);
+void enableHashTableCompaction(HashTable* ht);
+size_t compactHashTable(HashTable* ht, size_t maxBytes);
+void enableHotKeyTracking(HashTable* ht);
+int isHashTableHotKey(const HashTable* ht, const char* key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HASH_TABLE_H */
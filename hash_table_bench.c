@@ -0,0 +1,2748 @@
+/**
+ * @file hash_table_bench.c
+ * @brief Benchmark suite for the Hash Table.
+ *        Each scenario builds its own table and prints one line per measurement.
+ *        Hardware cache counters are read through perf_event_open when the kernel allows it.
+ *        Build with: gcc -O2 hash_table_bench.c hash_table.c ordered_index.c membership_filter.c value_codec.c key_hash.c change_feed.c entry_arena.c hot_keys.c bulk_import.c int_hash_table.c mvcc_hash_table.c extendible_hash_table.c sharded_hash_table.c compact_hash_table.c linear_hash_table.c disk_hash_table.c -lpthread -lm -o hash_table_bench
+ *        Run with: ./hash_table_bench <scenario> [pairs]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "hash_table.h"
+#include "sharded_hash_table.h"
+#include "compact_hash_table.h"
+#include "linear_hash_table.h"
+#include "disk_hash_table.h"
+#include "key_hash.h"
+#include "bulk_import.h"
+#include "mvcc_hash_table.h"
+#include "extendible_hash_table.h"
+#include "change_feed.h"
+#include "int_hash_table.h"
+#include "bucket_engine.h"
+
+/** @brief Default number of key-value pairs used by a scenario. */
+#define BENCH_DEFAULT_PAIRS 100000
+/** @brief Maximum length of a generated key or value. */
+#define BENCH_KEY_LENGTH 32
+/** @brief Upper bound on the pairs of the compress scenario, each value is several KB. */
+#define BENCH_MAX_BLOB_PAIRS 20000
+/** @brief Buffer pool of the disk scenario, in pages. */
+#define BENCH_DISK_CACHE_PAGES 1024
+/** @brief Page file of the disk scenario, in the current directory so it lands on local disk. */
+#define BENCH_DISK_PATH "hash_table_bench.pages"
+/** @brief Distinct keys counted by the counter scenario. */
+#define BENCH_COUNTER_KEYS 10000
+/** @brief Largest number of threads of the counter scenario. */
+#define BENCH_MAX_COUNTER_THREADS 8
+/** @brief Random keys per length in the avalanche test of the hash scenario. */
+#define BENCH_AVALANCHE_KEYS 2000
+/** @brief Longest key of the hash scenario. */
+#define BENCH_MAX_HASH_KEY 64
+/** @brief Input file of the import scenario, in the current directory. */
+#define BENCH_IMPORT_PATH "hash_table_bench.csv"
+/** @brief Keys updated and read in the mvcc scenario. */
+#define BENCH_MVCC_KEYS 10000
+/** @brief Keys a reader of the mvcc scenario reads twice per snapshot. */
+#define BENCH_MVCC_READ_SET 16
+/** @brief Reader threads of the mvcc scenario. */
+#define BENCH_MVCC_READERS 4
+/** @brief Writer threads of the mvcc scenario. */
+#define BENCH_MVCC_WRITERS 2
+/** @brief Key groups updated together in the batch scenario. */
+#define BENCH_BATCH_GROUPS 100
+/** @brief Largest group of keys of the batch scenario. */
+#define BENCH_MAX_BATCH_KEYS 100
+/** @brief Largest number of inserting threads in the extendible scenario. */
+#define BENCH_MAX_GROWTH_THREADS 8
+/** @brief Ring of the changefeed scenario, large enough for every record of a run. */
+#define BENCH_FEED_BYTES (4 * 1024 * 1024)
+/** @brief Ring of the changefeed scenario that a slow consumer cannot keep up with. */
+#define BENCH_SMALL_FEED_BYTES (64 * 1024)
+/** @brief Pairs inserted by the defrag scenario for each pair still live after its shrink. */
+#define BENCH_DEFRAG_PEAK_FACTOR 4
+/** @brief Remove and insert rounds of the defrag scenario, per live pair. */
+#define BENCH_DEFRAG_CHURN_FACTOR 16
+/** @brief Mutations between two compaction steps in the defrag scenario. */
+#define BENCH_DEFRAG_STEP_OPS 64
+/** @brief Work allowed per compaction step in the defrag scenario. */
+#define BENCH_DEFRAG_STEP_BYTES (64 * 1024)
+/** @brief Longest value of the defrag scenario. */
+#define BENCH_DEFRAG_MAX_VALUE 240
+/** @brief Longest key of the keycmp scenario. */
+#define BENCH_MAX_LONG_KEY 400
+/** @brief Threads of the hotkeys scenario. */
+#define BENCH_HOT_THREADS 32
+/** @brief Exponent of the Zipf distribution of the hotkeys lookups. */
+#define BENCH_HOT_ZIPF 0.99
+/** @brief Keys each hotkeys thread draws up front and cycles through. */
+#define BENCH_HOT_DRAWS 65536
+/** @brief Number of hardware counters opened around a measured section. */
+#define PERF_COUNTER_COUNT 3
+
+/** @brief Hardware cache miss counters around a measured section. */
+typedef struct {
+    int fds[PERF_COUNTER_COUNT]; /**< L1D, LLC and dTLB read-miss counters, -1 when unavailable. */
+} PerfCounters;
+
+/** @brief Work of one pinned thread in the numa scenario. */
+typedef struct {
+    ShardedHashTable* table; /**< Table under test. */
+    int shard; /**< Shard the thread searches. */
+    char** keys; /**< Keys stored in that shard. */
+    int keyCount; /**< Number of keys. */
+    unsigned int seed; /**< Seed of the random key order. */
+    int found; /**< Number of keys found. */
+} NumaWork;
+
+/** @brief Background serialization of a snapshot in the snapshot scenario. */
+typedef struct {
+    HashTableSnapshot* snapshot; /**< Snapshot to serialize. */
+    FILE* output; /**< Destination of the "key,value" lines. */
+    int pairs; /**< Number of pairs written. */
+    double seconds; /**< Time taken to write the snapshot. */
+} SnapshotWork;
+
+/** @brief Work of one thread in the counter scenario. */
+typedef struct {
+    ShardedHashTable* table; /**< Table under test. */
+    char** keys; /**< Keys to count, all already in the table. */
+    int increments; /**< Number of increments to make. */
+    unsigned int seed; /**< Seed of the random key order. */
+} CounterWork;
+
+/** @brief Work of one reader or writer thread in the mvcc scenario. */
+typedef struct {
+    ShardedHashTable* sharded; /**< Locked table under test, NULL when testing mvcc. */
+    MvccHashTable* mvcc; /**< Versioned table under test, NULL when testing sharded. */
+    char** keys; /**< Keys updated and read. */
+    int updates; /**< Updates a writer makes. */
+    unsigned int seed; /**< Seed of the random key order. */
+    volatile int* stop; /**< Set once every writer finished, readers stop then. */
+    long lookups; /**< Lookups a reader made. */
+    long changedReads; /**< Lookups that saw a different value the second time. */
+} MvccWork;
+
+/** @brief Writer or checker thread of the batch scenario. */
+typedef struct {
+    ShardedHashTable* table; /**< Table under test. */
+    char** keys; /**< BENCH_BATCH_GROUPS groups of groupSize consecutive keys. */
+    int groupSize; /**< Keys per group. */
+    int useBatch; /**< Writer applies groups as one batch instead of separate calls. */
+    int rounds; /**< Groups a writer updates. */
+    volatile int* stop; /**< Set once the writer finished, the checker stops then. */
+    long checks; /**< Groups the checker read. */
+    long tornGroups; /**< Groups the checker saw partly updated. */
+} BatchWork;
+
+/** @brief Inserting thread of the extendible scenario. */
+typedef struct {
+    ExtendibleHashTable* extendible; /**< Table under test, NULL when testing sharded. */
+    ShardedHashTable* sharded; /**< Table under test, NULL when testing extendible. */
+    char** keys; /**< Keys this thread inserts. */
+    int count; /**< Number of keys. */
+    double* latencies; /**< Receives the time of each insertion. */
+} GrowthWork;
+
+/** @brief Consumer thread of the changefeed scenario. */
+typedef struct {
+    ChangeFeedCursor cursor; /**< Cursor opened before the writer starts. */
+    int slow; /**< Sleep after every record, like a consumer that cannot keep up. */
+    volatile int* stop; /**< Set once the writer finished, the consumer drains and stops then. */
+    long records; /**< Records read. */
+    uint64_t maxLag; /**< Largest lag seen before a read, in bytes. */
+} FeedWork;
+
+/** @brief Thread of the hotkeys scenario. */
+typedef struct {
+    ShardedHashTable* table; /**< Table under test. */
+    char** keys; /**< Keys of the table, by Zipf rank. */
+    const int* draws; /**< Ranks drawn from the Zipf distribution, cycled through. */
+    int operations; /**< Lookups and writes to make. */
+    int cached; /**< Look up through a ReadCache instead of the shard locks. */
+    int writeEvery; /**< One operation in writeEvery rewrites its key, 0 for lookups only. */
+    unsigned int seed; /**< Seed picking the writes. */
+    ReadCache cache; /**< Cache of the thread when cached is set. */
+    int found; /**< Lookups that found their key. */
+} HotKeyWork;
+
+/** @brief A named benchmark scenario. */
+typedef struct {
+    const char* name; /**< Name given on the command line. */
+    void (*run)(int pairs); /**< Runs the scenario with the given number of pairs. */
+} Scenario;
+
+/** @brief Hardware caches whose read misses are counted, in PerfCounters order. */
+static const unsigned long long perfCacheIds[PERF_COUNTER_COUNT] = {
+    PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_DTLB,
+};
+/** @brief Names of the counted caches, in PerfCounters order. */
+static const char* const perfCacheNames[PERF_COUNTER_COUNT] = { "L1D", "LLC", "dTLB" };
+
+/*  FUNCTION DECLARATIONS   */
+static double nowSeconds(void);
+static char** makeKeys(const char* prefix, int count);
+static void freeKeys(char** keys, int count);
+static unsigned int nextRandom(unsigned int* state);
+static void shuffle(int* order, int count);
+static int openCacheCounter(unsigned long long cacheId);
+static void startPerfCounters(PerfCounters* counters);
+static void stopPerfCounters(PerfCounters* counters, const char* label, int operations);
+static void benchLookup(int pairs);
+static void benchHugePages(int pairs);
+static int nodeCpus(int node, cpu_set_t* cpus);
+static void startPinnedThread(pthread_t* thread, const cpu_set_t* cpus, void* (*run)(void*), void* arg);
+static void* numaInsertThread(void* arg);
+static void* numaLookupThread(void* arg);
+static void benchNuma(int pairs);
+static void benchRehash(int pairs);
+static void writeSnapshotPair(const char* key, const char* value, void* context);
+static void* snapshotThread(void* arg);
+static double churn(HashTable* table, char** inserted, char** removed, int first, int last);
+static void benchSnapshot(int pairs);
+static int countPair(const char* key, const char* value, void* context);
+static int scanAllForPrefix(const HashTable* table, const char* prefix);
+static void benchIndex(int pairs);
+static void benchFilter(int pairs);
+static int raiseBudget(HashTable* table, size_t neededBytes, void* context);
+static void benchBudget(int pairs);
+static char* makeJsonBlob(unsigned int* state);
+static void benchCompress(int pairs);
+static void countVisit(const char* key, const char* value, void* context);
+static void benchCompact(int pairs);
+static int compareDoubles(const void* a, const void* b);
+static void printLatencies(const char* label, double* latencies, int count);
+static void runGrowth(int linear, char** keys, int pairs);
+static void benchLinear(int pairs);
+static void benchDisk(int pairs);
+static void* counterThread(void* arg);
+static void benchCounter(int pairs);
+static void avalancheBias(KeyHashFunction hash, int length, double* worst, double* mean);
+static double bucketChiSquare(KeyHashFunction hash, int keys, unsigned int buckets);
+static void benchHash(int pairs);
+static void benchImport(int pairs);
+static void* mvccWriterThread(void* arg);
+static void* mvccReaderThread(void* arg);
+static void runMvccContention(MvccWork* base, char** keys, int pairs, const char* label);
+static void benchMvcc(int pairs);
+static void updateGroup(ShardedHashTable* table, WriteBatch* batch, char** keys, int groupSize, int round);
+static void* batchWriterThread(void* arg);
+static void* batchCheckerThread(void* arg);
+static void benchBatch(int pairs);
+static void* growthThread(void* arg);
+static void benchExtendible(int pairs);
+static double threadCpuSeconds(void);
+static void* feedConsumerThread(void* arg);
+static double runFeedWrites(HashTable* table, char** keys, int pairs);
+static void benchChangeFeed(int pairs);
+static double runIntKeyPass(int mode, void* table, const uint64_t* ids, char** formatted, const int* order, int count, int lookup);
+static void benchIntKey(int pairs);
+static void benchDefrag(int pairs);
+static char** makeLongKeys(int count, int length);
+static int compareHashes(const void* a, const void* b);
+static int countHashCollisions(char** keys, int count);
+static void benchKeyCompare(int pairs);
+static void drawZipf(int* draws, int count, int keys, unsigned int seed);
+static void* hotKeyThread(void* arg);
+static double runHotKeys(ShardedHashTable* table, HotKeyWork* work, char** keys, const int* draws, int operations, int cached, int writeEvery);
+static void benchHotKeys(int pairs);
+
+/** @brief Scenarios selectable from the command line. */
+static const Scenario scenarios[] = {
+    { "lookup", benchLookup },
+    { "hugepage", benchHugePages },
+    { "numa", benchNuma },
+    { "rehash", benchRehash },
+    { "snapshot", benchSnapshot },
+    { "index", benchIndex },
+    { "filter", benchFilter },
+    { "budget", benchBudget },
+    { "compress", benchCompress },
+    { "compact", benchCompact },
+    { "linear", benchLinear },
+    { "disk", benchDisk },
+    { "counter", benchCounter },
+    { "hash", benchHash },
+    { "import", benchImport },
+    { "mvcc", benchMvcc },
+    { "batch", benchBatch },
+    { "extendible", benchExtendible },
+    { "changefeed", benchChangeFeed },
+    { "intkey", benchIntKey },
+    { "defrag", benchDefrag },
+    { "keycmp", benchKeyCompare },
+    { "hotkeys", benchHotKeys },
+};
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Runs the scenario named on the command line.
+ * @param argc Number of command-line arguments.
+ * @param argv Scenario name followed by an optional pair count.
+ * @return 0 on successful execution.
+ */
+int main(int argc, char* argv[]) {
+    int pairs = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_PAIRS;
+
+    for (size_t i = 0; argc > 1 && pairs > 0 && i < sizeof(scenarios) / sizeof(scenarios[0]); ++i) {
+        if (strcmp(argv[1], scenarios[i].name) == 0) {
+            scenarios[i].run(pairs);
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "Usage: %s <scenario> [pairs]\nScenarios:", argv[0]);
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i) {
+        fprintf(stderr, " %s", scenarios[i].name);
+    }
+    fprintf(stderr, "\n");
+    return EXIT_FAILURE;
+}
+
+/**
+ * @brief Monotonic wall clock in seconds.
+ * @return Current time in seconds.
+ */
+static double nowSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Generates keys of the form "<prefix>-<index>".
+ * @param prefix Prefix shared by all keys.
+ * @param count Number of keys.
+ * @return Array of heap allocated keys, released with freeKeys.
+ */
+static char** makeKeys(const char* prefix, int count) {
+    char** keys = (char**)malloc(sizeof(char*) * count);
+    if (keys == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < count; ++i) {
+        char key[BENCH_KEY_LENGTH];
+        snprintf(key, sizeof(key), "%s-%d", prefix, i);
+        keys[i] = strdup(key);
+    }
+    return keys;
+}
+
+/**
+ * @brief Releases keys created by makeKeys.
+ * @param keys Array of keys.
+ * @param count Number of keys.
+ */
+static void freeKeys(char** keys, int count) {
+    for (int i = 0; i < count; ++i) {
+        free(keys[i]);
+    }
+    free(keys);
+}
+
+/**
+ * @brief xorshift32 pseudo random generator.
+ * @param state Generator state, must not be zero.
+ * @return Next pseudo random number.
+ */
+static unsigned int nextRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Fills @p order with a random permutation of 0..count-1.
+ * @param order Array receiving the permutation.
+ * @param count Number of elements.
+ */
+static void shuffle(int* order, int count) {
+    unsigned int state = 2463534242u;
+    for (int i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    for (int i = count - 1; i > 0; --i) {
+        int j = (int)(nextRandom(&state) % (unsigned int)(i + 1));
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+}
+
+/**
+ * @brief Opens a user space read-miss counter for the given hardware cache.
+ * @param cacheId PERF_COUNT_HW_CACHE_* identifier.
+ * @return File descriptor of the counter, or -1 when counters are unavailable.
+ */
+static int openCacheCounter(unsigned long long cacheId) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = cacheId | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * @brief Opens and enables the cache miss counters.
+ * @param counters Counters to start.
+ */
+static void startPerfCounters(PerfCounters* counters) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        counters->fds[i] = openCacheCounter(perfCacheIds[i]);
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+/**
+ * @brief Stops the cache miss counters and prints misses per operation.
+ * @param counters Counters started by startPerfCounters.
+ * @param label Name of the measured section.
+ * @param operations Number of operations in the section.
+ */
+static void stopPerfCounters(PerfCounters* counters, const char* label, int operations) {
+    int available = 0;
+
+    printf("  %-12s", label);
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        unsigned long long misses;
+        if (counters->fds[i] < 0) {
+            continue;
+        }
+        ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counters->fds[i], &misses, sizeof(misses)) == (ssize_t)sizeof(misses)) {
+            printf(" %s misses/op: %.2f", perfCacheNames[i], (double)misses / operations);
+            available++;
+        }
+        close(counters->fds[i]);
+    }
+    printf("%s\n", available > 0 ? "" : " cache misses/op: n/a (perf_event_open unavailable)");
+}
+
+/**
+ * @brief Lookup latency and cache misses for present and absent keys in random order.
+ * @param pairs Number of key-value pairs in the table.
+ */
+static void benchLookup(int pairs) {
+    char** keys = makeKeys("player", pairs);
+    char** missing = makeKeys("nobody", pairs);
+    int* order = (int*)malloc(sizeof(int) * pairs);
+    if (order == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    shuffle(order, pairs);
+
+    HashTable table;
+    initHashTable(&table, INITIAL_CAPACITY);
+    for (int i = 0; i < pairs; ++i) {
+        insertKeyValPair(&table, keys[i], "Country");
+    }
+
+    // Present keys
+    PerfCounters counters;
+    int found = 0;
+    startPerfCounters(&counters);
+    double start = nowSeconds();
+    for (int i = 0; i < pairs; ++i) {
+        found += lookup_hashTable(&table, keys[order[i]]) != NULL;
+    }
+    double hit = nowSeconds() - start;
+    printf("lookup hit : %.1f ns/op (%d found)\n", hit * 1e9 / pairs, found);
+    stopPerfCounters(&counters, "hit", pairs);
+
+    // Absent keys
+    found = 0;
+    startPerfCounters(&counters);
+    start = nowSeconds();
+    for (int i = 0; i < pairs; ++i) {
+        found += lookup_hashTable(&table, missing[order[i]]) != NULL;
+    }
+    double miss = nowSeconds() - start;
+    printf("lookup miss: %.1f ns/op (%d found)\n", miss * 1e9 / pairs, found);
+    stopPerfCounters(&counters, "miss", pairs);
+
+    freeHashTable(&table);
+    free(order);
+    freeKeys(keys, pairs);
+    freeKeys(missing, pairs);
+}
+
+/**
+ * @brief Random lookup latency and dTLB misses with the array of containers on regular
+ *        pages, transparent huge pages and explicit hugetlb pages.
+ * @param pairs Number of key-value pairs in each table.
+ */
+static void benchHugePages(int pairs) {
+    static const PagePolicy policies[] = { PAGES_DEFAULT, PAGES_TRANSPARENT_HUGE, PAGES_HUGETLB };
+    static const char* const names[] = { "default", "thp", "hugetlb" };
+
+    char** keys = makeKeys("player", pairs);
+    int* order = (int*)malloc(sizeof(int) * pairs);
+    if (order == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    shuffle(order, pairs);
+
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); ++p) {
+        HashTable table;
+        initHashTable(&table, INITIAL_CAPACITY);
+        setHashTablePagePolicy(&table, policies[p]);
+        for (int i = 0; i < pairs; ++i) {
+            insertKeyValPair(&table, keys[i], "Country");
+        }
+
+        PerfCounters counters;
+        int found = 0;
+        startPerfCounters(&counters);
+        double start = nowSeconds();
+        for (int i = 0; i < pairs; ++i) {
+            found += lookup_hashTable(&table, keys[order[i]]) != NULL;
+        }
+        double elapsed = nowSeconds() - start;
+        printf("%-8s: %.1f ns/lookup, containers %zu MB %s (%d found)\n", names[p], elapsed * 1e9 / pairs,
+               sizeof(Bucket) * table.capacity >> 20, table.tableMappedBytes > 0 ? "mapped" : "on heap", found);
+        stopPerfCounters(&counters, names[p], pairs);
+
+        freeHashTable(&table);
+    }
+
+    free(order);
+    freeKeys(keys, pairs);
+}
+
+/**
+ * @brief Reads the CPUs of a NUMA node from /sys/devices/system/node/node<N>/cpulist.
+ * @param node NUMA node.
+ * @param cpus Receives the CPUs of the node, or every CPU when sysfs has no node information.
+ * @return Number of CPUs in @p cpus.
+ */
+static int nodeCpus(int node, cpu_set_t* cpus) {
+    char path[64];
+    int first, last;
+    FILE* list;
+
+    CPU_ZERO(cpus);
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    list = fopen(path, "r");
+    if (list == NULL) {
+        sched_getaffinity(0, sizeof(*cpus), cpus);
+        return CPU_COUNT(cpus);
+    }
+
+    // The list looks like "0-15,32-47"
+    while (fscanf(list, "%d", &first) == 1) {
+        last = first;
+        if (fgetc(list) == '-') {
+            if (fscanf(list, "%d", &last) != 1) {
+                last = first;
+            }
+            fgetc(list);
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            CPU_SET(cpu, cpus);
+        }
+    }
+    fclose(list);
+    return CPU_COUNT(cpus);
+}
+
+/**
+ * @brief Starts a thread restricted to the given CPUs.
+ * @param thread Receives the thread handle.
+ * @param cpus CPUs the thread may run on.
+ * @param run Thread function.
+ * @param arg Argument of the thread function.
+ */
+static void startPinnedThread(pthread_t* thread, const cpu_set_t* cpus, void* (*run)(void*), void* arg) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setaffinity_np(&attr, sizeof(*cpus), cpus);
+    if (pthread_create(thread, &attr, run, arg) != 0) {
+        perror("Error in pthread_create");
+        exit(EXIT_FAILURE);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+/**
+ * @brief Inserts the keys of one node, routed to the shard of the node the thread runs on.
+ * @param arg Pointer to the NumaWork of the thread.
+ * @return NULL.
+ */
+static void* numaInsertThread(void* arg) {
+    NumaWork* work = (NumaWork*)arg;
+    for (int i = 0; i < work->keyCount; ++i) {
+        insertShardedKeyValPair(work->table, work->keys[i], "Country");
+    }
+    return NULL;
+}
+
+/**
+ * @brief Looks up every key of one shard once, in random order.
+ * @param arg Pointer to the NumaWork of the thread.
+ * @return NULL.
+ */
+static void* numaLookupThread(void* arg) {
+    NumaWork* work = (NumaWork*)arg;
+    char value[BENCH_KEY_LENGTH];
+    for (int i = 0; i < work->keyCount; ++i) {
+        int index = (int)(nextRandom(&work->seed) % (unsigned int)work->keyCount);
+        work->found += lookupInShard(work->table, work->shard, work->keys[index], value, sizeof(value));
+    }
+    return NULL;
+}
+
+/**
+ * @brief Local versus remote lookup throughput with one shard per NUMA node.
+ * @details Each node inserts its own keys from a thread pinned to it, so the shard memory
+ *          is local to that node. Then every CPU of every node runs lookups, first against
+ *          the shard of its own node and then against the shard of the next node.
+ * @param pairs Total number of key-value pairs, split evenly across nodes.
+ */
+static void benchNuma(int pairs) {
+    ShardedHashTable table;
+    initShardedHashTable(&table, 0, INITIAL_CAPACITY, ROUTE_BY_NUMA_NODE);
+    int nodes = table.shardCount;
+    int perNode = pairs / nodes;
+
+    cpu_set_t* cpus = (cpu_set_t*)malloc(sizeof(cpu_set_t) * nodes);
+    char*** keys = (char***)malloc(sizeof(char**) * nodes);
+    NumaWork* inserts = (NumaWork*)calloc(nodes, sizeof(NumaWork));
+    pthread_t* inserters = (pthread_t*)malloc(sizeof(pthread_t) * nodes);
+    if (cpus == NULL || keys == NULL || inserts == NULL || inserters == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    // Populate each shard from its own node
+    int threadCount = 0;
+    for (int node = 0; node < nodes; ++node) {
+        char prefix[BENCH_KEY_LENGTH];
+        snprintf(prefix, sizeof(prefix), "node%d", node);
+        keys[node] = makeKeys(prefix, perNode);
+        threadCount += nodeCpus(node, &cpus[node]);
+        inserts[node] = (NumaWork){ &table, node, keys[node], perNode, 0, 0 };
+        startPinnedThread(&inserters[node], &cpus[node], numaInsertThread, &inserts[node]);
+    }
+    for (int node = 0; node < nodes; ++node) {
+        pthread_join(inserters[node], NULL);
+    }
+
+    NumaWork* lookups = (NumaWork*)calloc(threadCount, sizeof(NumaWork));
+    pthread_t* threads = (pthread_t*)malloc(sizeof(pthread_t) * threadCount);
+    if (lookups == NULL || threads == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%d NUMA node(s), %d lookup threads, %d pairs per shard\n", nodes, threadCount, perNode);
+    for (int remote = 0; remote <= 1; ++remote) {
+        int started = 0;
+        double start = nowSeconds();
+        for (int node = 0; node < nodes; ++node) {
+            int shard = (node + remote) % nodes;
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (!CPU_ISSET(cpu, &cpus[node])) {
+                    continue;
+                }
+                cpu_set_t single;
+                CPU_ZERO(&single);
+                CPU_SET(cpu, &single);
+                lookups[started] = (NumaWork){ &table, shard, keys[shard], perNode, 2463534242u + cpu, 0 };
+                startPinnedThread(&threads[started], &single, numaLookupThread, &lookups[started]);
+                started++;
+            }
+        }
+        int found = 0;
+        for (int i = 0; i < started; ++i) {
+            pthread_join(threads[i], NULL);
+            found += lookups[i].found;
+        }
+        double elapsed = nowSeconds() - start;
+        printf("%-6s: %.2f M lookups/s (%d found)\n", remote ? "remote" : "local",
+               (double)started * perNode / elapsed / 1e6, found);
+    }
+
+    freeShardedHashTable(&table);
+    for (int node = 0; node < nodes; ++node) {
+        freeKeys(keys[node], perNode);
+    }
+    free(lookups);
+    free(threads);
+    free(inserters);
+    free(inserts);
+    free(keys);
+    free(cpus);
+}
+
+/**
+ * @brief Wall time of one resizeHashTable call against the number of rehash threads.
+ * @param pairs Number of key-value pairs in the table being resized.
+ */
+static void benchRehash(int pairs) {
+    static const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+
+    char** keys = makeKeys("player", pairs);
+    for (size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t) {
+        HashTable table;
+        initHashTable(&table, INITIAL_CAPACITY);
+        for (int i = 0; i < pairs; ++i) {
+            insertKeyValPair(&table, keys[i], "Country");
+        }
+
+        setHashTableRehashThreads(&table, threadCounts[t]);
+        double start = nowSeconds();
+        resizeHashTable(&table);
+        double elapsed = nowSeconds() - start;
+        printf("%2d thread(s): %.1f ms to resize %d pairs into %d containers\n", threadCounts[t],
+               elapsed * 1e3, table.size, table.capacity);
+
+        freeHashTable(&table);
+    }
+    freeKeys(keys, pairs);
+}
+
+/**
+ * @brief Writes one snapshot pair as a "key,value" line.
+ * @param key Key of the pair.
+ * @param value Value of the pair.
+ * @param context Pointer to the SnapshotWork being written.
+ */
+static void writeSnapshotPair(const char* key, const char* value, void* context) {
+    SnapshotWork* work = (SnapshotWork*)context;
+    fprintf(work->output, "%s,%s\n", key, value);
+    work->pairs++;
+}
+
+/**
+ * @brief Serializes a snapshot in the background.
+ * @param arg Pointer to the SnapshotWork of the thread.
+ * @return NULL.
+ */
+static void* snapshotThread(void* arg) {
+    SnapshotWork* work = (SnapshotWork*)arg;
+    double start = nowSeconds();
+    forEachSnapshotPair(work->snapshot, writeSnapshotPair, work);
+    fflush(work->output);
+    work->seconds = nowSeconds() - start;
+    return NULL;
+}
+
+/**
+ * @brief Inserts one new key and removes one existing key per step.
+ * @param table Table being written.
+ * @param inserted Keys to insert.
+ * @param removed Keys to remove.
+ * @param first First step.
+ * @param last One past the last step.
+ * @return Elapsed seconds.
+ */
+static double churn(HashTable* table, char** inserted, char** removed, int first, int last) {
+    double start = nowSeconds();
+    for (int i = first; i < last; ++i) {
+        insertKeyValPair(table, inserted[i], "Country");
+        removeKeyValPair(table, removed[i]);
+    }
+    return nowSeconds() - start;
+}
+
+/**
+ * @brief Write throughput with and without a snapshot being serialized in the background,
+ *        and the extra memory the snapshot holds.
+ * @param pairs Number of key-value pairs in the table.
+ */
+static void benchSnapshot(int pairs) {
+    char** keys = makeKeys("player", pairs);
+    char** fresh = makeKeys("fresh", pairs);
+    HashTable table;
+    initHashTable(&table, INITIAL_CAPACITY);
+    for (int i = 0; i < pairs; ++i) {
+        insertKeyValPair(&table, keys[i], "Country");
+    }
+
+    // Writes without a snapshot
+    int half = pairs / 2;
+    double idle = churn(&table, fresh, keys, 0, half);
+    printf("no snapshot    : %.2f M writes/s\n", 2.0 * half / idle / 1e6);
+
+    // Writes while a background thread serializes a snapshot
+    SnapshotWork work = { snapshotHashTable(&table), tmpfile(), 0, 0.0 };
+    if (work.output == NULL) {
+        perror("Error in tmpfile");
+        exit(EXIT_FAILURE);
+    }
+    int expected = table.size;
+    pthread_t writer;
+    if (pthread_create(&writer, NULL, snapshotThread, &work) != 0) {
+        perror("Error in pthread_create");
+        exit(EXIT_FAILURE);
+    }
+    double active = churn(&table, fresh, keys, half, pairs);
+    pthread_join(writer, NULL);
+    printf("during snapshot: %.2f M writes/s\n", 2.0 * (pairs - half) / active / 1e6);
+    printf("snapshot       : %d of %d pairs written in %.1f ms, %.1f MB extra memory\n", work.pairs, expected,
+           work.seconds * 1e3, snapshotExtraBytes(work.snapshot) / 1048576.0);
+
+    releaseHashTableSnapshot(&table, work.snapshot);
+    fclose(work.output);
+    freeHashTable(&table);
+    freeKeys(keys, pairs);
+    freeKeys(fresh, pairs);
+}
+
+/**
+ * @brief Counts the pairs visited by a scan.
+ * @param key Key of the pair.
+ * @param value Value of the pair.
+ * @param context Pointer to the int counter.
+ * @return 0 to continue the scan.
+ */
+static int countPair(const char* key, const char* value, void* context) {
+    (void)key;
+    (void)value;
+    (*(int*)context)++;
+    return 0;
+}
+
+/**
+ * @brief Prefix query without the ordered index, a full walk of every container.
+ * @param table Table to search.
+ * @param prefix Required prefix.
+ * @return Number of matching pairs.
+ */
+static int scanAllForPrefix(const HashTable* table, const char* prefix) {
+    size_t length = strlen(prefix);
+    int matches = 0;
+    for (int i = 0; i < table->capacity; ++i) {
+        const Bucket* bucket = &table->table[i];
+        for (int j = 0; j < bucket->count; ++j) {
+            matches += strncmp(bucket->keys[j], prefix, length) == 0;
+        }
+    }
+    return matches;
+}
+
+/**
+ * @brief Insert and lookup cost with the ordered index enabled, and prefix query speed
+ *        through the index against a full scan.
+ * @param pairs Number of key-value pairs in the table.
+ */
+static void benchIndex(int pairs) {
+    static const char* const prefixes[] = { "player-1", "player-42", "player-999", "player-12345" };
+    char** keys = makeKeys("player", pairs);
+    int* order = (int*)malloc(sizeof(int) * pairs);
+    if (order == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    shuffle(order, pairs);
+
+    for (int indexed = 0; indexed <= 1; ++indexed) {
+        HashTable table;
+        initHashTable(&table, INITIAL_CAPACITY);
+        if (indexed) {
+            enableOrderedIndex(&table);
+        }
+        double start = nowSeconds();
+        for (int i = 0; i < pairs; ++i) {
+            insertKeyValPair(&table, keys[order[i]], "Country");
+        }
+        double insert = nowSeconds() - start;
+        int found = 0;
+        start = nowSeconds();
+        for (int i = 0; i < pairs; ++i) {
+            found += lookup_hashTable(&table, keys[order[i]]) != NULL;
+        }
+        double lookup = nowSeconds() - start;
+        printf("%-10s: insert %.1f ns, lookup %.1f ns (%d found)\n", indexed ? "indexed" : "no index",
+               insert * 1e9 / pairs, lookup * 1e9 / pairs, found);
+
+        for (size_t p = 0; p < sizeof(prefixes) / sizeof(prefixes[0]); ++p) {
+            int matches = 0;
+            start = nowSeconds();
+            if (indexed) {
+                scanHashTablePrefix(&table, prefixes[p], countPair, &matches);
+            } else {
+                matches = scanAllForPrefix(&table, prefixes[p]);
+            }
+            double elapsed = nowSeconds() - start;
+            printf("  prefix %-14s %7d matches in %10.1f us\n", prefixes[p], matches, elapsed * 1e6);
+        }
+        if (indexed) {
+            printf("  index memory: %.1f bytes/pair\n", (double)table.orderedIndex->bytes / pairs);
+        }
+        freeHashTable(&table);
+    }
+
+    free(order);
+    freeKeys(keys, pairs);
+}
+
+/**
+ * @brief Miss and hit latency without and with the lookup filter at several false positive
+ *        rates, with the measured rate and the filter memory per key.
+ * @param pairs Number of key-value pairs in the table.
+ */
+static void benchFilter(int pairs) {
+    static const double rates[] = { 0.0, 0.1, 0.01, 0.001 };
+    char** keys = makeKeys("player", pairs);
+    char** missing = makeKeys("nobody", pairs);
+    int* order = (int*)malloc(sizeof(int) * pairs);
+    if (order == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    shuffle(order, pairs);
+
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r) {
+        HashTable table;
+        initHashTable(&table, INITIAL_CAPACITY);
+        if (rates[r] > 0.0) {
+            enableLookupFilter(&table, rates[r]);
+        }
+        for (int i = 0; i < pairs; ++i) {
+            insertKeyValPair(&table, keys[i], "Country");
+        }
+
+        // Absent keys, the case the filter is for
+        PerfCounters counters;
+        int found = 0;
+        startPerfCounters(&counters);
+        double start = nowSeconds();
+        for (int i = 0; i < pairs; ++i) {
+            found += lookup_hashTable(&table, missing[order[i]]) != NULL;
+        }
+        double miss = nowSeconds() - start;
+
+        // Present keys pay for the filter probe on top of the container
+        start = nowSeconds();
+        for (int i = 0; i < pairs; ++i) {
+            found += lookup_hashTable(&table, keys[order[i]]) != NULL;
+        }
+        double hit = nowSeconds() - start;
+
+        if (rates[r] > 0.0) {
+            int passed = 0;
+            for (int i = 0; i < pairs; ++i) {
+                passed += mayContainMembershipFilter(table.lookupFilter, hashKey(missing[i]));
+            }
+            printf("filter %-6g: miss %.1f ns, hit %.1f ns, false positives %.4f, %.2f bytes/key (%d found)\n",
+                   rates[r], miss * 1e9 / pairs, hit * 1e9 / pairs, (double)passed / pairs,
+                   (double)membershipFilterBytes(table.lookupFilter) / pairs, found);
+        } else {
+            printf("no filter   : miss %.1f ns, hit %.1f ns (%d found)\n", miss * 1e9 / pairs, hit * 1e9 / pairs, found);
+        }
+        stopPerfCounters(&counters, "miss+hit", 2 * pairs);
+        freeHashTable(&table);
+    }
+
+    free(order);
+    freeKeys(keys, pairs);
+    freeKeys(missing, pairs);
+}
+
+/**
+ * @brief Budget callback that raises the budget by a quarter and counts its calls.
+ * @param table Table over budget.
+ * @param neededBytes Bytes missing for the insertion.
+ * @param context Pointer to the int call counter.
+ * @return 1 to retry the insertion.
+ */
+static int raiseBudget(HashTable* table, size_t neededBytes, void* context) {
+    (*(int*)context)++;
+    table->memoryBudget += table->memoryBudget / 4 + neededBytes;
+    return 1;
+}
+
+/**
+ * @brief Insert cost of the budget check under each policy, and the accounted bytes against
+ *        what the heap actually handed out.
+ * @param pairs Number of key-value pairs inserted.
+ */
+static void benchBudget(int pairs) {
+    static const char* const names[] = { "no budget", "unreached", "reject", "evict", "callback" };
+    char** keys = makeKeys("player", pairs);
+    size_t fullBytes = 0;
+
+    // The first pass only warms up the allocator and measures the unbounded table
+    for (int pass = 0; pass <= 5; ++pass) {
+        int mode = pass == 0 ? 0 : pass - 1;
+        HashTable table;
+        int calls = 0, inserted = 0;
+        struct mallinfo2 before = mallinfo2();
+        initHashTable(&table, INITIAL_CAPACITY);
+        if (mode == 1) {
+            setHashTableMemoryBudget(&table, SIZE_MAX, BUDGET_REJECT, NULL, NULL);
+        } else if (mode > 1) {
+            BudgetPolicy policy = mode == 2 ? BUDGET_REJECT : mode == 3 ? BUDGET_EVICT : BUDGET_CALLBACK;
+            setHashTableMemoryBudget(&table, fullBytes / 2, policy, raiseBudget, &calls);
+        }
+
+        double start = nowSeconds();
+        for (int i = 0; i < pairs; ++i) {
+            inserted += insertKeyValPair(&table, keys[i], "Country");
+        }
+        double elapsed = nowSeconds() - start;
+        size_t accounted = hashTableMemoryBytes(&table);
+        struct mallinfo2 after = mallinfo2();
+        size_t heap = (after.uordblks + after.hblkhd) - (before.uordblks + before.hblkhd);
+        if (pass == 0) {
+            fullBytes = accounted;
+            freeHashTable(&table);
+            continue;
+        }
+
+        printf("%-10s: insert %.1f ns, %d inserted, %lu rejected, %lu evicted, %d callbacks\n", names[mode],
+               elapsed * 1e9 / pairs, inserted, table.budgetRejects, table.budgetEvictions, calls);
+        printf("  accounted %zu B, budget %zu B, allocator %zu B\n", accounted, table.memoryBudget, heap);
+        freeHashTable(&table);
+    }
+
+    freeKeys(keys, pairs);
+}
+
+/**
+ * @brief Builds a JSON document of 2 to 4 KB with repeated field names and random numbers.
+ * @param state Random generator state.
+ * @return Heap allocated document.
+ */
+static char* makeJsonBlob(unsigned int* state) {
+    static const char* const countries[] = { "Argentina", "Brazil", "France", "Germany", "Italy", "Spain" };
+    int records = 16 + (int)(nextRandom(state) % 16);
+    size_t capacity = 160 * (size_t)records + 16;
+    char* blob = (char*)malloc(capacity);
+    if (blob == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t length = (size_t)snprintf(blob, capacity, "[");
+    for (int i = 0; i < records; ++i) {
+        length += (size_t)snprintf(blob + length, capacity - length,
+                                   "{\"id\": %u, \"country\": \"%s\", \"goals\": %u, \"caps\": %u, \"active\": %s}%s",
+                                   nextRandom(state) % 1000000, countries[nextRandom(state) % 6], nextRandom(state) % 1000,
+                                   nextRandom(state) % 200, nextRandom(state) % 2 ? "true" : "false", i + 1 < records ? ", " : "]");
+    }
+    return blob;
+}
+
+/**
+ * @brief Memory, compression ratio, and insert and lookup latency of multi-KB JSON values
+ *        stored plain and compressed.
+ * @param pairs Number of key-value pairs, capped at BENCH_MAX_BLOB_PAIRS.
+ */
+static void benchCompress(int pairs) {
+    if (pairs > BENCH_MAX_BLOB_PAIRS) {
+        pairs = BENCH_MAX_BLOB_PAIRS;
+    }
+    char** keys = makeKeys("player", pairs);
+    char** blobs = (char**)malloc(sizeof(char*) * pairs);
+    int* order = (int*)malloc(sizeof(int) * pairs);
+    char* buffer = (char*)malloc(8192);
+    if (blobs == NULL || order == NULL || buffer == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    unsigned int state = 12345;
+    for (int i = 0; i < pairs; ++i) {
+        blobs[i] = makeJsonBlob(&state);
+    }
+    shuffle(order, pairs);
+
+    for (int compressed = 0; compressed <= 1; ++compressed) {
+        HashTable table;
+        initHashTable(&table, INITIAL_CAPACITY);
+        if (compressed) {
+            setHashTableCompression(&table, 256);
+        }
+
+        double start = nowSeconds();
+        for (int i = 0; i < pairs; ++i) {
+            insertKeyValPair(&table, keys[i], blobs[i]);
+        }
+        double insert = nowSeconds() - start;
+
+        // Copy into a caller buffer, the way a server answers a request
+        size_t total = 0;
+        start = nowSeconds();
+        for (int i = 0; i < pairs; ++i) {
+            total += (size_t)lookup_hashTableInto(&table, keys[order[i]], buffer, 8192);
+        }
+        double into = nowSeconds() - start;
+
+        // Borrow the string, free for plain values
+        start = nowSeconds();
+        for (int i = 0; i < pairs; ++i) {
+            total += lookup_hashTable(&table, keys[order[i]])[0] == '[';
+        }
+        double borrow = nowSeconds() - start;
+
+        printf("%-10s: %.1f MB, insert %.1f us, lookup into buffer %.2f us, lookup %.2f us",
+               compressed ? "compressed" : "plain", hashTableMemoryBytes(&table) / 1e6, insert * 1e6 / pairs,
+               into * 1e6 / pairs, borrow * 1e6 / pairs);
+        if (compressed) {
+            printf(", ratio %.2f", (double)table.compressedOriginalBytes / table.compressedStoredBytes);
+        }
+        printf(" (%zu)\n", total);
+        freeHashTable(&table);
+    }
+
+    for (int i = 0; i < pairs; ++i) {
+        free(blobs[i]);
+    }
+    free(blobs);
+    free(order);
+    free(buffer);
+    freeKeys(keys, pairs);
+}
+
+/**
+ * @brief Counts the pairs of an iteration and touches their values.
+ * @param key Key of the pair.
+ * @param value Value of the pair.
+ * @param context Pointer to the size_t counter.
+ */
+static void countVisit(const char* key, const char* value, void* context) {
+    (void)key;
+    *(size_t*)context += (unsigned char)value[0];
+}
+
+/**
+ * @brief Bytes per entry, and insert, lookup and iteration speed of the chained table
+ *        against the compact insertion-ordered table.
+ * @param pairs Number of key-value pairs in each table.
+ */
+static void benchCompact(int pairs) {
+    char** keys = makeKeys("player", pairs);
+    int* order = (int*)malloc(sizeof(int) * pairs);
+    if (order == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    shuffle(order, pairs);
+
+    // Chained table
+    struct mallinfo2 before = mallinfo2();
+    HashTable table;
+    initHashTable(&table, INITIAL_CAPACITY);
+    double start = nowSeconds();
+    for (int i = 0; i < pairs; ++i) {
+        insertKeyValPair(&table, keys[i], "Country");
+    }
+    double insert = nowSeconds() - start;
+    struct mallinfo2 after = mallinfo2();
+    int found = 0;
+    start = nowSeconds();
+    for (int i = 0; i < pairs; ++i) {
+        found += lookup_hashTable(&table, keys[order[i]]) != NULL;
+    }
+    double lookup = nowSeconds() - start;
+    size_t visited = 0;
+    start = nowSeconds();
+    for (int i = 0; i < table.capacity; ++i) {
+        const Bucket* bucket = &table.table[i];
+        for (int j = 0; j < bucket->count; ++j) {
+            countVisit(bucket->keys[j], bucket->values[j], &visited);
+        }
+    }
+    double iterate = nowSeconds() - start;
+    size_t layout = sizeof(Bucket) * table.capacity + table.entryBytes;
+    printf("chained: layout %.1f B/entry, with strings %.1f B/entry, allocator %.1f B/entry\n",
+           (double)layout / pairs, (double)(layout + table.stringBytes) / pairs,
+           (double)((after.uordblks + after.hblkhd) - (before.uordblks + before.hblkhd)) / pairs);
+    printf("  insert %.1f ns, lookup %.1f ns, iterate %.2f ns/pair (%d found, %zu)\n",
+           insert * 1e9 / pairs, lookup * 1e9 / pairs, iterate * 1e9 / pairs, found, visited);
+    freeHashTable(&table);
+
+    // Compact table
+    before = mallinfo2();
+    CompactHashTable compact;
+    initCompactHashTable(&compact, 0);
+    start = nowSeconds();
+    for (int i = 0; i < pairs; ++i) {
+        insertCompactKeyValPair(&compact, keys[i], "Country");
+    }
+    insert = nowSeconds() - start;
+    after = mallinfo2();
+    found = 0;
+    start = nowSeconds();
+    for (int i = 0; i < pairs; ++i) {
+        found += lookup_compactHashTable(&compact, keys[order[i]]) != NULL;
+    }
+    lookup = nowSeconds() - start;
+    visited = 0;
+    start = nowSeconds();
+    forEachCompactPair(&compact, countVisit, &visited);
+    iterate = nowSeconds() - start;
+    layout = compactHashTableMemoryBytes(&compact) - compact.stringBytes;
+    printf("compact: layout %.1f B/entry, with strings %.1f B/entry, allocator %.1f B/entry, %d-byte index\n",
+           (double)layout / pairs, (double)compactHashTableMemoryBytes(&compact) / pairs,
+           (double)((after.uordblks + after.hblkhd) - (before.uordblks + before.hblkhd)) / pairs, compact.indexWidth);
+    printf("  insert %.1f ns, lookup %.1f ns, iterate %.2f ns/pair (%d found, %zu)\n",
+           insert * 1e9 / pairs, lookup * 1e9 / pairs, iterate * 1e9 / pairs, found, visited);
+    freeCompactHashTable(&compact);
+
+    free(order);
+    freeKeys(keys, pairs);
+}
+
+/**
+ * @brief qsort comparison of two doubles.
+ * @param a Pointer to the first double.
+ * @param b Pointer to the second double.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Prints the percentiles of a set of latencies, sorting them in place.
+ * @param label Name of the measurement.
+ * @param latencies Latencies in seconds.
+ * @param count Number of latencies.
+ */
+static void printLatencies(const char* label, double* latencies, int count) {
+    qsort(latencies, count, sizeof(double), compareDoubles);
+    printf("%-8s: p50 %.0f ns, p99 %.0f ns, p99.9 %.0f ns, p99.99 %.0f ns, max %.0f us\n", label,
+           latencies[count / 2] * 1e9, latencies[(int)(count * 0.99)] * 1e9, latencies[(int)(count * 0.999)] * 1e9,
+           latencies[(int)(count * 0.9999)] * 1e9, latencies[count - 1] * 1e6);
+}
+
+/**
+ * @brief Inserts every key into a doubling or a linear hashing table, timing each insertion.
+ * @details Meant to run in a child process so its peak resident set can be read on its own.
+ *          The peak of the doubling table includes the old array of containers, which stays
+ *          allocated until its rehash finishes.
+ * @param linear Use the linear hashing table instead of the doubling one.
+ * @param keys Keys to insert.
+ * @param pairs Number of keys.
+ */
+static void runGrowth(int linear, char** keys, int pairs) {
+    double* latencies = (double*)malloc(sizeof(double) * pairs);
+    if (latencies == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t peak;
+    if (linear) {
+        LinearHashTable table;
+        initLinearHashTable(&table, INITIAL_CAPACITY);
+        for (int i = 0; i < pairs; ++i) {
+            double start = nowSeconds();
+            insertLinearKeyValPair(&table, keys[i], "Country");
+            latencies[i] = nowSeconds() - start;
+        }
+        peak = table.peakBytes;
+    } else {
+        HashTable table;
+        initHashTable(&table, INITIAL_CAPACITY);
+        peak = 0;
+        for (int i = 0; i < pairs; ++i) {
+            int capacity = table.capacity;
+            double start = nowSeconds();
+            insertKeyValPair(&table, keys[i], "Country");
+            latencies[i] = nowSeconds() - start;
+            size_t bytes = hashTableMemoryBytes(&table) + (table.capacity != capacity ? sizeof(Bucket) * capacity : 0);
+            if (bytes > peak) {
+                peak = bytes;
+            }
+        }
+    }
+    printLatencies(linear ? "linear" : "doubling", latencies, pairs);
+    printf("  peak accounted memory %.1f MB\n", peak / 1e6);
+    fflush(stdout);
+    free(latencies);
+}
+
+/**
+ * @brief Per-insert latency distribution and peak memory while growing from empty, with
+ *        the doubling table against the linear hashing table.
+ * @param pairs Number of key-value pairs inserted.
+ */
+static void benchLinear(int pairs) {
+    char** keys = makeKeys("player", pairs);
+
+    for (int linear = 0; linear <= 1; ++linear) {
+        // Flush first, or the child would print the buffered output again
+        fflush(stdout);
+        pid_t child = fork();
+        if (child < 0) {
+            perror("Error in fork");
+            exit(EXIT_FAILURE);
+        }
+        if (child == 0) {
+            runGrowth(linear, keys, pairs);
+            exit(EXIT_SUCCESS);
+        }
+        int status;
+        struct rusage usage;
+        wait4(child, &status, 0, &usage);
+        printf("  peak resident set %.1f MB\n", usage.ru_maxrss / 1e3);
+    }
+
+    freeKeys(keys, pairs);
+}
+
+/**
+ * @brief Random lookups against the disk-backed table with working sets of 0.5x, 2x and 10x
+ *        the buffer pool, reporting latency, pool hit rate and page reads per lookup.
+ * @param pairs Number of timed lookups per working set.
+ */
+static void benchDisk(int pairs) {
+    const double workingSets[] = { 0.5, 2.0, 10.0 };
+    char key[BENCH_KEY_LENGTH];
+    char value[BENCH_KEY_LENGTH];
+
+    for (size_t w = 0; w < sizeof(workingSets) / sizeof(workingSets[0]); ++w) {
+        DiskHashTable table;
+        initDiskHashTable(&table, BENCH_DISK_PATH, INITIAL_CAPACITY, BENCH_DISK_CACHE_PAGES);
+
+        // Grow the file to the wanted multiple of the pool
+        uint32_t targetPages = (uint32_t)(workingSets[w] * BENCH_DISK_CACHE_PAGES);
+        int keyCount = 0;
+        double start = nowSeconds();
+        while (table.pageCount < targetPages) {
+            snprintf(key, sizeof(key), "player-%d", keyCount++);
+            insertDiskKeyValPair(&table, key, "Country");
+        }
+        flushDiskHashTable(&table);
+        double insertSeconds = nowSeconds() - start;
+
+        // One untimed pass settles the pool, then the timed pass
+        unsigned int state = 2463534242u;
+        int found = 0;
+        for (int pass = 0; pass < 2; ++pass) {
+            unsigned long long hits = table.cacheHits;
+            unsigned long long misses = table.cacheMisses;
+            start = nowSeconds();
+            for (int i = 0; i < pairs; ++i) {
+                snprintf(key, sizeof(key), "player-%u", nextRandom(&state) % (unsigned int)keyCount);
+                found += lookup_diskHashTable(&table, key, value, sizeof(value)) >= 0;
+            }
+            double seconds = nowSeconds() - start;
+            if (pass == 1) {
+                hits = table.cacheHits - hits;
+                misses = table.cacheMisses - misses;
+                printf("%4.1fx pool: %d pairs, %u pages, insert %.0f ns/pair, lookup %.0f ns, hit rate %.1f%%, %.2f reads/lookup\n",
+                       workingSets[w], keyCount, table.pageCount, insertSeconds / keyCount * 1e9, seconds / pairs * 1e9,
+                       100.0 * hits / (hits + misses), (double)misses / pairs);
+            }
+        }
+        if (found != 2 * pairs) {
+            printf("  missing keys: %d\n", 2 * pairs - found);
+        }
+        printf("  %s I/O, %llu page writes\n", table.directIo ? "direct" : "buffered", table.pageWrites);
+        freeDiskHashTable(&table);
+    }
+}
+
+/**
+ * @brief Increments random keys of the counter scenario.
+ * @param arg Pointer to the CounterWork.
+ * @return NULL.
+ */
+static void* counterThread(void* arg) {
+    CounterWork* work = (CounterWork*)arg;
+    for (int i = 0; i < work->increments; ++i) {
+        incrementShardedKeyValue(work->table, work->keys[nextRandom(&work->seed) % BENCH_COUNTER_KEYS], 1, NULL);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Counting throughput: the lookup, parse, remove and insert cycle of a string table
+ *        against incrementKeyValue on a numeric one, then sharded increments from several threads.
+ * @param pairs Number of increments per measurement and per thread.
+ */
+static void benchCounter(int pairs) {
+    char** keys = makeKeys("event", BENCH_COUNTER_KEYS);
+    char value[BENCH_KEY_LENGTH];
+    unsigned int state = 2463534242u;
+
+    // Counting with string values
+    HashTable strings;
+    initHashTable(&strings, INITIAL_CAPACITY);
+    for (int i = 0; i < BENCH_COUNTER_KEYS; ++i) {
+        insertKeyValPair(&strings, keys[i], "0");
+    }
+    double start = nowSeconds();
+    for (int i = 0; i < pairs; ++i) {
+        const char* key = keys[nextRandom(&state) % BENCH_COUNTER_KEYS];
+        lookup_hashTableInto(&strings, key, value, sizeof(value));
+        snprintf(value, sizeof(value), "%d", atoi(value) + 1);
+        removeKeyValPair(&strings, key);
+        insertKeyValPair(&strings, key, value);
+    }
+    double seconds = nowSeconds() - start;
+    printf("strings : %.2f M increments/s\n", pairs / seconds / 1e6);
+    freeHashTable(&strings);
+
+    // Counting with numbers held in the containers
+    HashTable numbers;
+    initHashTable(&numbers, INITIAL_CAPACITY);
+    setHashTableNumericValues(&numbers);
+    for (int i = 0; i < BENCH_COUNTER_KEYS; ++i) {
+        incrementKeyValue(&numbers, keys[i], 0, NULL);
+    }
+    start = nowSeconds();
+    for (int i = 0; i < pairs; ++i) {
+        incrementKeyValue(&numbers, keys[nextRandom(&state) % BENCH_COUNTER_KEYS], 1, NULL);
+    }
+    seconds = nowSeconds() - start;
+    printf("numeric : %.2f M increments/s\n", pairs / seconds / 1e6);
+    freeHashTable(&numbers);
+
+    // Sharded increments, all keys present so every increment takes the atomic path
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int threads = 1; threads <= BENCH_MAX_COUNTER_THREADS; threads *= 2) {
+        ShardedHashTable table;
+        initShardedHashTable(&table, 16, INITIAL_CAPACITY, ROUTE_BY_KEY);
+        setShardedHashTableNumericValues(&table);
+        for (int i = 0; i < BENCH_COUNTER_KEYS; ++i) {
+            incrementShardedKeyValue(&table, keys[i], 0, NULL);
+        }
+
+        CounterWork work[BENCH_MAX_COUNTER_THREADS];
+        pthread_t workers[BENCH_MAX_COUNTER_THREADS];
+        start = nowSeconds();
+        for (int t = 0; t < threads; ++t) {
+            work[t] = (CounterWork){ &table, keys, pairs, 2463534242u + (unsigned int)t };
+            if (pthread_create(&workers[t], NULL, counterThread, &work[t]) != 0) {
+                perror("Error in pthread_create");
+                exit(EXIT_FAILURE);
+            }
+        }
+        for (int t = 0; t < threads; ++t) {
+            pthread_join(workers[t], NULL);
+        }
+        seconds = nowSeconds() - start;
+
+        // Every increment must have landed
+        long long total = 0;
+        for (int i = 0; i < BENCH_COUNTER_KEYS; ++i) {
+            int64_t count = 0;
+            lookup_hashTableNumber(&table.shards[shardIndex(&table, keys[i])], keys[i], &count);
+            total += count;
+        }
+        printf("sharded : %d threads, %.2f M increments/s%s\n", threads, (double)threads * pairs / seconds / 1e6,
+               total == (long long)threads * pairs ? "" : " (lost increments)");
+        freeShardedHashTable(&table);
+    }
+    printf("  %ld CPUs online\n", online);
+
+    freeKeys(keys, BENCH_COUNTER_KEYS);
+}
+
+/**
+ * @brief Measures how far single-bit input changes are from flipping each output bit half the time.
+ * @param hash Hash function under test.
+ * @param length Key length in bytes.
+ * @param worst Receives the largest |P(flip) - 0.5| over all input and output bit pairs.
+ * @param mean Receives the average |P(flip) - 0.5|.
+ */
+static void avalancheBias(KeyHashFunction hash, int length, double* worst, double* mean) {
+    int inputBits = length * 8;
+    int* flips = (int*)calloc((size_t)inputBits * 32, sizeof(int));
+    if (flips == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    unsigned int state = 2463534242u;
+    char key[BENCH_MAX_HASH_KEY];
+
+    for (int k = 0; k < BENCH_AVALANCHE_KEYS; ++k) {
+        for (int i = 0; i < length; ++i) {
+            key[i] = (char)nextRandom(&state);
+        }
+        unsigned int base = hash(key, length);
+        for (int bit = 0; bit < inputBits; ++bit) {
+            key[bit / 8] ^= (char)(1 << (bit % 8));
+            unsigned int changed = base ^ hash(key, length);
+            key[bit / 8] ^= (char)(1 << (bit % 8));
+            for (int out = 0; out < 32; ++out) {
+                flips[bit * 32 + out] += (changed >> out) & 1;
+            }
+        }
+    }
+
+    *worst = 0.0;
+    *mean = 0.0;
+    for (int i = 0; i < inputBits * 32; ++i) {
+        double bias = (double)flips[i] / BENCH_AVALANCHE_KEYS - 0.5;
+        bias = bias < 0 ? -bias : bias;
+        *worst = bias > *worst ? bias : *worst;
+        *mean += bias;
+    }
+    *mean /= inputBits * 32;
+    free(flips);
+}
+
+/**
+ * @brief Chi-square of sequential "player-N" keys spread over containers by hash % buckets.
+ * @param hash Hash function under test.
+ * @param keys Number of keys.
+ * @param buckets Number of containers.
+ * @return Chi-square divided by its degrees of freedom, about 1 for a uniform spread.
+ */
+static double bucketChiSquare(KeyHashFunction hash, int keys, unsigned int buckets) {
+    unsigned int* counts = (unsigned int*)calloc(buckets, sizeof(unsigned int));
+    if (counts == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    char key[BENCH_KEY_LENGTH];
+    for (int i = 0; i < keys; ++i) {
+        int length = snprintf(key, sizeof(key), "player-%d", i);
+        counts[hash(key, (size_t)length) % buckets]++;
+    }
+
+    double expected = (double)keys / buckets;
+    double chiSquare = 0.0;
+    for (unsigned int i = 0; i < buckets; ++i) {
+        chiSquare += (counts[i] - expected) * (counts[i] - expected) / expected;
+    }
+    free(counts);
+    return chiSquare / (buckets - 1);
+}
+
+/**
+ * @brief Quality and speed of each key hash implementation the CPU supports: avalanche bias,
+ *        spread of sequential keys over power-of-two and table-sized container counts, and
+ *        ns/hash per key length.
+ * @param pairs Number of sequential keys in the spread test, and hashes per timed length.
+ */
+static void benchHash(int pairs) {
+    const KeyHashImplementation implementations[] = { KEY_HASH_FNV1A, KEY_HASH_CRC32C, KEY_HASH_AES };
+    const KeyHashFunction functions[] = { hashKeyFnv1a, hashKeyCrc32c, hashKeyAes };
+    const int lengths[] = { 8, 16, 32, 64 };
+    char keys[1024][BENCH_MAX_HASH_KEY];
+    unsigned int state = 2463534242u;
+
+    for (int k = 0; k < 1024; ++k) {
+        for (int i = 0; i < BENCH_MAX_HASH_KEY; ++i) {
+            keys[k][i] = (char)('a' + nextRandom(&state) % 26);
+        }
+    }
+
+    printf("hashKey uses %s\n", keyHashName(selectedKeyHash()));
+    for (size_t h = 0; h < sizeof(functions) / sizeof(functions[0]); ++h) {
+        if (!keyHashSupported(implementations[h])) {
+            printf("%-7s: not supported by this CPU\n", keyHashName(implementations[h]));
+            continue;
+        }
+        KeyHashFunction hash = functions[h];
+
+        double worst, mean;
+        avalancheBias(hash, 16, &worst, &mean);
+        printf("%-7s: avalanche bias worst %.3f mean %.4f (16-byte keys), chi2/df %.2f (2^16 containers) %.2f (10*2^14)\n",
+               keyHashName(implementations[h]), worst, mean, bucketChiSquare(hash, pairs, 1u << 16),
+               bucketChiSquare(hash, pairs, 10u << 14));
+
+        printf("        ");
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+            unsigned int sink = 0;
+            double start = nowSeconds();
+            for (int i = 0; i < pairs; ++i) {
+                sink += hash(keys[i & 1023], (size_t)lengths[l]);
+            }
+            double seconds = nowSeconds() - start;
+            printf(" %d B %.1f ns%s", lengths[l], seconds / pairs * 1e9, sink == 1 ? " " : "");
+        }
+        printf("\n");
+    }
+}
+
+/**
+ * @brief Import throughput of a "key,value" file: fgets and insertKeyValPair against the
+ *        mapped, multi-threaded importer.
+ * @param pairs Number of lines in the file.
+ */
+static void benchImport(int pairs) {
+    FILE* output = fopen(BENCH_IMPORT_PATH, "w");
+    if (output == NULL) {
+        perror("Error opening " BENCH_IMPORT_PATH);
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < pairs; ++i) {
+        fprintf(output, "player-%d,Country-%d\n", i, i % 197);
+    }
+    fclose(output);
+
+    // Baseline, the file is in the page cache for every run
+    char line[2 * BENCH_KEY_LENGTH];
+    HashTable table;
+    initHashTable(&table, INITIAL_CAPACITY);
+    double start = nowSeconds();
+    FILE* input = fopen(BENCH_IMPORT_PATH, "r");
+    if (input == NULL) {
+        perror("Error opening " BENCH_IMPORT_PATH);
+        exit(EXIT_FAILURE);
+    }
+    size_t bytes = 0;
+    while (fgets(line, sizeof(line), input) != NULL) {
+        bytes += strlen(line);
+        line[strcspn(line, "\r\n")] = '\0';
+        char* separator = strchr(line, ',');
+        if (separator != NULL) {
+            *separator = '\0';
+            insertKeyValPair(&table, line, separator + 1);
+        }
+    }
+    fclose(input);
+    double seconds = nowSeconds() - start;
+    printf("fgets   : %.1f MB, %d pairs, %.3f GB/s\n", bytes / 1e6, table.size, bytes / seconds / 1e9);
+    freeHashTable(&table);
+
+    for (int threads = 1; threads <= 4; threads *= 2) {
+        ImportStats stats;
+        initHashTable(&table, INITIAL_CAPACITY);
+        if (importKeyValueFile(&table, BENCH_IMPORT_PATH, ',', threads, &stats) != 0) {
+            perror("Error importing " BENCH_IMPORT_PATH);
+            exit(EXIT_FAILURE);
+        }
+        double total = stats.parseSeconds + stats.insertSeconds;
+        printf("import  : %d threads, %ld pairs, %.3f GB/s (parse %.3f GB/s, insert %.0f ms)%s\n", stats.threads,
+               stats.pairs, stats.bytes / total / 1e9, stats.bytes / stats.parseSeconds / 1e9, stats.insertSeconds * 1e3,
+               lookup_hashTable(&table, "player-0") != NULL ? "" : " (lookup failed)");
+        freeHashTable(&table);
+    }
+    remove(BENCH_IMPORT_PATH);
+}
+
+/**
+ * @brief Writer of the mvcc scenario, overwrites random keys with fresh values.
+ * @param arg Pointer to the MvccWork.
+ * @return NULL.
+ */
+static void* mvccWriterThread(void* arg) {
+    MvccWork* work = (MvccWork*)arg;
+    char value[BENCH_KEY_LENGTH];
+
+    for (int i = 0; i < work->updates; ++i) {
+        const char* key = work->keys[nextRandom(&work->seed) % BENCH_MVCC_KEYS];
+        snprintf(value, sizeof(value), "%u-%d", work->seed, i);
+        if (work->mvcc != NULL) {
+            insertMvccKeyValPair(work->mvcc, key, value);
+        } else {
+            insertShardedKeyValPair(work->sharded, key, value);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Reader of the mvcc scenario, reads a set of keys twice and compares the values.
+ * @details The mvcc table reads both passes from one snapshot; the sharded table has no
+ *          snapshot, so updates between the passes show up as changed reads.
+ * @param arg Pointer to the MvccWork.
+ * @return NULL.
+ */
+static void* mvccReaderThread(void* arg) {
+    MvccWork* work = (MvccWork*)arg;
+    char first[BENCH_MVCC_READ_SET][BENCH_KEY_LENGTH];
+    char again[BENCH_KEY_LENGTH];
+    const char* set[BENCH_MVCC_READ_SET];
+
+    while (!*work->stop) {
+        for (int k = 0; k < BENCH_MVCC_READ_SET; ++k) {
+            set[k] = work->keys[nextRandom(&work->seed) % BENCH_MVCC_KEYS];
+        }
+        MvccSnapshot* snapshot = work->mvcc != NULL ? openMvccSnapshot(work->mvcc) : NULL;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int k = 0; k < BENCH_MVCC_READ_SET; ++k) {
+                char* target = pass == 0 ? first[k] : again;
+                if (work->mvcc != NULL) {
+                    lookup_mvccHashTable(work->mvcc, snapshot, set[k], target, BENCH_KEY_LENGTH);
+                } else {
+                    lookup_shardedHashTable(work->sharded, set[k], target, BENCH_KEY_LENGTH);
+                }
+                if (pass == 1 && strcmp(first[k], again) != 0) {
+                    work->changedReads++;
+                }
+            }
+        }
+        if (snapshot != NULL) {
+            closeMvccSnapshot(work->mvcc, snapshot);
+        }
+        work->lookups += 2 * BENCH_MVCC_READ_SET;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs the writers and readers of the mvcc scenario against one table.
+ * @param base Table under test, the other fields are filled in per thread.
+ * @param keys Keys updated and read, all already in the table.
+ * @param pairs Updates per writer.
+ * @param label Name printed in front of the results.
+ */
+static void runMvccContention(MvccWork* base, char** keys, int pairs, const char* label) {
+    MvccWork work[BENCH_MVCC_WRITERS + BENCH_MVCC_READERS];
+    pthread_t workers[BENCH_MVCC_WRITERS + BENCH_MVCC_READERS];
+    volatile int stop = 0;
+
+    double start = nowSeconds();
+    for (int t = 0; t < BENCH_MVCC_WRITERS + BENCH_MVCC_READERS; ++t) {
+        work[t] = *base;
+        work[t].keys = keys;
+        work[t].updates = pairs;
+        work[t].seed = 2463534242u + (unsigned int)t;
+        work[t].stop = &stop;
+        void* (*run)(void*) = t < BENCH_MVCC_WRITERS ? mvccWriterThread : mvccReaderThread;
+        if (pthread_create(&workers[t], NULL, run, &work[t]) != 0) {
+            perror("Error in pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int t = 0; t < BENCH_MVCC_WRITERS; ++t) {
+        pthread_join(workers[t], NULL);
+    }
+    double seconds = nowSeconds() - start;
+    stop = 1;
+    long lookups = 0;
+    long changedReads = 0;
+    for (int t = BENCH_MVCC_WRITERS; t < BENCH_MVCC_WRITERS + BENCH_MVCC_READERS; ++t) {
+        pthread_join(workers[t], NULL);
+        lookups += work[t].lookups;
+        changedReads += work[t].changedReads;
+    }
+
+    printf("%-8s: %d writers %.2f M updates/s, %d readers %.2f M lookups/s, %ld changed reads\n", label,
+           BENCH_MVCC_WRITERS, (double)BENCH_MVCC_WRITERS * pairs / seconds / 1e6, BENCH_MVCC_READERS,
+           lookups / seconds / 1e6, changedReads);
+}
+
+/**
+ * @brief Readers doing repeated multi-key reads while writers overwrite the same keys: the
+ *        rwlock sharded table against snapshots of the versioned one, then the versions a
+ *        long snapshot pins and what collection frees once it closes.
+ * @param pairs Updates per writer.
+ */
+static void benchMvcc(int pairs) {
+    char** keys = makeKeys("account", BENCH_MVCC_KEYS);
+
+    ShardedHashTable sharded;
+    initShardedHashTable(&sharded, 16, INITIAL_CAPACITY, ROUTE_BY_KEY);
+    for (int i = 0; i < BENCH_MVCC_KEYS; ++i) {
+        insertShardedKeyValPair(&sharded, keys[i], "0");
+    }
+    MvccWork base = { &sharded, NULL, NULL, 0, 0, NULL, 0, 0 };
+    runMvccContention(&base, keys, pairs, "sharded");
+    freeShardedHashTable(&sharded);
+
+    MvccHashTable mvcc;
+    initMvccHashTable(&mvcc, 16, INITIAL_CAPACITY);
+    for (int i = 0; i < BENCH_MVCC_KEYS; ++i) {
+        insertMvccKeyValPair(&mvcc, keys[i], "0");
+    }
+    base = (MvccWork){ NULL, &mvcc, NULL, 0, 0, NULL, 0, 0 };
+    runMvccContention(&base, keys, pairs, "mvcc");
+    printf("mvcc    : %ld versions kept for %d keys, %lu reclaimed by updates\n", mvccVersionCount(&mvcc),
+           BENCH_MVCC_KEYS, mvcc.reclaimedVersions);
+
+    // A snapshot held across many updates pins one version per key it saw change
+    MvccSnapshot* pinned = openMvccSnapshot(&mvcc);
+    char before[BENCH_KEY_LENGTH];
+    char after[BENCH_KEY_LENGTH];
+    lookup_mvccHashTable(&mvcc, pinned, keys[0], before, sizeof(before));
+    unsigned int state = 2463534242u;
+    double start = nowSeconds();
+    for (int i = 0; i < pairs; ++i) {
+        char value[BENCH_KEY_LENGTH];
+        snprintf(value, sizeof(value), "pinned-%d", i);
+        insertMvccKeyValPair(&mvcc, keys[i == 0 ? 0 : nextRandom(&state) % BENCH_MVCC_KEYS], value);
+    }
+    double seconds = nowSeconds() - start;
+    lookup_mvccHashTable(&mvcc, pinned, keys[0], after, sizeof(after));
+    printf("pinned  : %.2f M updates/s, %ld versions kept%s\n", pairs / seconds / 1e6, mvccVersionCount(&mvcc),
+           strcmp(before, after) == 0 ? "" : " (snapshot changed)");
+    closeMvccSnapshot(&mvcc, pinned);
+    start = nowSeconds();
+    long freed = collectMvccGarbage(&mvcc);
+    seconds = nowSeconds() - start;
+    printf("collect : %ld versions freed in %.2f ms, %ld kept\n", freed, seconds * 1e3, mvccVersionCount(&mvcc));
+
+    freeMvccHashTable(&mvcc);
+    freeKeys(keys, BENCH_MVCC_KEYS);
+}
+
+/**
+ * @brief Sets every key of a group to the round number, with a remove and an insert per key.
+ * @param table Table to update.
+ * @param batch Batch to stage the operations in, NULL for separate calls.
+ * @param keys First key of the group.
+ * @param groupSize Keys in the group.
+ * @param round Value written.
+ */
+static void updateGroup(ShardedHashTable* table, WriteBatch* batch, char** keys, int groupSize, int round) {
+    char value[BENCH_KEY_LENGTH];
+    snprintf(value, sizeof(value), "%d", round);
+
+    for (int k = 0; k < groupSize; ++k) {
+        if (batch != NULL) {
+            batchRemoveKeyValPair(batch, keys[k]);
+            batchInsertKeyValPair(batch, keys[k], value);
+        } else {
+            removeShardedKeyValPair(table, keys[k]);
+            insertShardedKeyValPair(table, keys[k], value);
+        }
+    }
+    if (batch != NULL) {
+        applyShardedWriteBatch(table, batch);
+    }
+}
+
+/**
+ * @brief Writer of the batch scenario, updates one random group after the other.
+ * @param arg Pointer to the BatchWork.
+ * @return NULL.
+ */
+static void* batchWriterThread(void* arg) {
+    BatchWork* work = (BatchWork*)arg;
+    WriteBatch batch;
+    unsigned int state = 2463534242u;
+
+    initWriteBatch(&batch);
+    for (int round = 1; round <= work->rounds; ++round) {
+        int group = (int)(nextRandom(&state) % BENCH_BATCH_GROUPS);
+        updateGroup(work->table, work->useBatch ? &batch : NULL, &work->keys[group * work->groupSize],
+                    work->groupSize, round);
+    }
+    freeWriteBatch(&batch);
+    return NULL;
+}
+
+/**
+ * @brief Checker of the batch scenario, reads whole groups and counts those with mixed values.
+ * @details Holds the shared lock of every shard, taken in increasing order like a batch, so
+ *          each group is read at a single point in time.
+ * @param arg Pointer to the BatchWork.
+ * @return NULL.
+ */
+static void* batchCheckerThread(void* arg) {
+    BatchWork* work = (BatchWork*)arg;
+    ShardedHashTable* table = work->table;
+    char first[BENCH_KEY_LENGTH];
+    char other[BENCH_KEY_LENGTH];
+    unsigned int state = 88675123u;
+
+    while (!*work->stop) {
+        char** keys = &work->keys[(nextRandom(&state) % BENCH_BATCH_GROUPS) * work->groupSize];
+        for (int s = 0; s < table->shardCount; ++s) {
+            pthread_rwlock_rdlock(&table->locks[s].lock);
+        }
+        int torn = 0;
+        for (int k = 0; k < work->groupSize; ++k) {
+            char* target = k == 0 ? first : other;
+            if (lookup_hashTableInto(&table->shards[shardIndex(table, keys[k])], keys[k], target, BENCH_KEY_LENGTH) < 0) {
+                target[0] = '\0';
+            }
+            torn |= k > 0 && strcmp(first, other) != 0;
+        }
+        for (int s = table->shardCount - 1; s >= 0; --s) {
+            pthread_rwlock_unlock(&table->locks[s].lock);
+        }
+        work->checks++;
+        work->tornGroups += torn;
+        sched_yield();
+    }
+    return NULL;
+}
+
+/**
+ * @brief Group updates as separate calls against one write batch per group: throughput on
+ *        one thread, then groups seen half-applied by a concurrent checker.
+ * @param pairs Number of key updates per measurement.
+ */
+static void benchBatch(int pairs) {
+    static const int groupSizes[] = { 10, BENCH_MAX_BATCH_KEYS };
+    char** keys = makeKeys("batch", BENCH_BATCH_GROUPS * BENCH_MAX_BATCH_KEYS);
+
+    for (size_t g = 0; g < sizeof(groupSizes) / sizeof(groupSizes[0]); ++g) {
+        int groupSize = groupSizes[g];
+        for (int useBatch = 0; useBatch <= 1; ++useBatch) {
+            ShardedHashTable table;
+            initShardedHashTable(&table, 16, INITIAL_CAPACITY, ROUTE_BY_KEY);
+            for (int i = 0; i < BENCH_BATCH_GROUPS * groupSize; ++i) {
+                insertShardedKeyValPair(&table, keys[i], "0");
+            }
+
+            // One thread alone, so the difference is the locking and routing
+            WriteBatch batch;
+            initWriteBatch(&batch);
+            unsigned int state = 2463534242u;
+            int rounds = pairs / groupSize > 0 ? pairs / groupSize : 1;
+            double start = nowSeconds();
+            for (int round = 1; round <= rounds; ++round) {
+                int group = (int)(nextRandom(&state) % BENCH_BATCH_GROUPS);
+                updateGroup(&table, useBatch ? &batch : NULL, &keys[group * groupSize], groupSize, round);
+            }
+            double seconds = nowSeconds() - start;
+            freeWriteBatch(&batch);
+
+            // A writer racing a checker that reads whole groups
+            volatile int stop = 0;
+            BatchWork writer = { &table, keys, groupSize, useBatch, rounds, &stop, 0, 0 };
+            BatchWork checker = writer;
+            pthread_t threads[2];
+            if (pthread_create(&threads[0], NULL, batchWriterThread, &writer) != 0 ||
+                pthread_create(&threads[1], NULL, batchCheckerThread, &checker) != 0) {
+                perror("Error in pthread_create");
+                exit(EXIT_FAILURE);
+            }
+            pthread_join(threads[0], NULL);
+            stop = 1;
+            pthread_join(threads[1], NULL);
+
+            printf("%-8s: %3d keys per group, %.2f M updates/s, %ld of %ld checked groups torn\n",
+                   useBatch ? "batch" : "separate", groupSize, (double)rounds * groupSize / seconds / 1e6,
+                   checker.tornGroups, checker.checks);
+            freeShardedHashTable(&table);
+        }
+    }
+    freeKeys(keys, BENCH_BATCH_GROUPS * BENCH_MAX_BATCH_KEYS);
+}
+
+/**
+ * @brief Inserting thread of the extendible scenario, timing each insertion.
+ * @param arg Pointer to the GrowthWork.
+ * @return NULL.
+ */
+static void* growthThread(void* arg) {
+    GrowthWork* work = (GrowthWork*)arg;
+    for (int i = 0; i < work->count; ++i) {
+        double start = nowSeconds();
+        if (work->extendible != NULL) {
+            insertExtendibleKeyValPair(work->extendible, work->keys[i], "Country");
+        } else {
+            insertShardedKeyValPair(work->sharded, work->keys[i], "Country");
+        }
+        work->latencies[i] = nowSeconds() - start;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Per-insert latency while growing from empty, doubling and linear hashing against
+ *        extendible hashing, then several threads growing one extendible table against a
+ *        sharded table whose shards double under their lock.
+ * @param pairs Number of key-value pairs inserted per measurement.
+ */
+static void benchExtendible(int pairs) {
+    char** keys = makeKeys("player", pairs);
+    double* latencies = (double*)malloc(sizeof(double) * pairs);
+    if (latencies == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    // One thread, every table growing from its smallest size
+    HashTable doubling;
+    initHashTable(&doubling, INITIAL_CAPACITY);
+    for (int i = 0; i < pairs; ++i) {
+        double start = nowSeconds();
+        insertKeyValPair(&doubling, keys[i], "Country");
+        latencies[i] = nowSeconds() - start;
+    }
+    printLatencies("doubling", latencies, pairs);
+    freeHashTable(&doubling);
+
+    LinearHashTable linear;
+    initLinearHashTable(&linear, INITIAL_CAPACITY);
+    for (int i = 0; i < pairs; ++i) {
+        double start = nowSeconds();
+        insertLinearKeyValPair(&linear, keys[i], "Country");
+        latencies[i] = nowSeconds() - start;
+    }
+    printLatencies("linear", latencies, pairs);
+    freeLinearHashTable(&linear);
+
+    ExtendibleHashTable extendible;
+    initExtendibleHashTable(&extendible, 0);
+    for (int i = 0; i < pairs; ++i) {
+        double start = nowSeconds();
+        insertExtendibleKeyValPair(&extendible, keys[i], "Country");
+        latencies[i] = nowSeconds() - start;
+    }
+    printLatencies("extend", latencies, pairs);
+    printf("  global depth %d, %d buckets, %lu splits, %lu doublings\n", extendible.globalDepth,
+           extendible.bucketCount, extendible.splits, extendible.doublings);
+    freeExtendibleHashTable(&extendible);
+
+    // Threads inserting disjoint parts of the keys into one table
+    for (int threads = 1; threads <= BENCH_MAX_GROWTH_THREADS; threads *= 2) {
+        for (int useExtendible = 0; useExtendible <= 1; ++useExtendible) {
+            ShardedHashTable sharded;
+            if (useExtendible) {
+                initExtendibleHashTable(&extendible, 0);
+            } else {
+                initShardedHashTable(&sharded, 16, INITIAL_CAPACITY, ROUTE_BY_KEY);
+            }
+            GrowthWork work[BENCH_MAX_GROWTH_THREADS];
+            pthread_t workers[BENCH_MAX_GROWTH_THREADS];
+            double start = nowSeconds();
+            for (int t = 0; t < threads; ++t) {
+                int first = (int)((long)pairs * t / threads);
+                int last = (int)((long)pairs * (t + 1) / threads);
+                work[t] = (GrowthWork){ useExtendible ? &extendible : NULL, useExtendible ? NULL : &sharded,
+                                        keys + first, last - first, latencies + first };
+                if (pthread_create(&workers[t], NULL, growthThread, &work[t]) != 0) {
+                    perror("Error in pthread_create");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            for (int t = 0; t < threads; ++t) {
+                pthread_join(workers[t], NULL);
+            }
+            double seconds = nowSeconds() - start;
+
+            char label[32];
+            snprintf(label, sizeof(label), "%s x%d", useExtendible ? "extend" : "sharded", threads);
+            printf("%-11s %.2f M inserts/s\n", label, pairs / seconds / 1e6);
+            printLatencies(label, latencies, pairs);
+            if (useExtendible) {
+                freeExtendibleHashTable(&extendible);
+            } else {
+                freeShardedHashTable(&sharded);
+            }
+        }
+    }
+
+    free(latencies);
+    freeKeys(keys, pairs);
+}
+
+/**
+ * @brief CPU time of the calling thread, which excludes time other threads ran on its CPU.
+ * @return CPU time in seconds.
+ */
+static double threadCpuSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Consumer of the changefeed scenario, reads records until the writer is done and
+ *        the feed is drained.
+ * @param arg Pointer to the FeedWork.
+ * @return NULL.
+ */
+static void* feedConsumerThread(void* arg) {
+    FeedWork* work = (FeedWork*)arg;
+    ChangeRecord record;
+
+    for (;;) {
+        uint64_t lag = changeFeedLag(&work->cursor);
+        work->maxLag = lag > work->maxLag ? lag : work->maxLag;
+        int result = readChangeFeed(&work->cursor, &record);
+        if (result == CHANGE_FEED_RECORD) {
+            work->records++;
+            if (work->slow) {
+                usleep(10);
+            }
+        } else if (result == CHANGE_FEED_EMPTY) {
+            if (*work->stop) {
+                break;
+            }
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Inserts every key, then removes every key.
+ * @param table Table under test.
+ * @param keys Keys to insert and remove.
+ * @param pairs Number of keys.
+ * @return CPU time of the calling thread, in seconds.
+ */
+static double runFeedWrites(HashTable* table, char** keys, int pairs) {
+    double start = threadCpuSeconds();
+    for (int i = 0; i < pairs; ++i) {
+        insertKeyValPair(table, keys[i], "Country");
+    }
+    for (int i = 0; i < pairs; ++i) {
+        removeKeyValPair(table, keys[i]);
+    }
+    return threadCpuSeconds() - start;
+}
+
+/**
+ * @brief Write path cost of the change feed: inserts and removes without a feed, with a feed
+ *        nobody reads, and with a consumer following it, then a slow consumer on a small
+ *        ring, which writers lap without waiting. Ends with the cost of publishing alone.
+ * @details Times are CPU time of the writing thread, so a consumer sharing the CPU does not
+ *          count against the writer. The modes take turns for five rounds and the best round
+ *          of each is kept, so a noisy stretch of the machine hits all of them alike.
+ * @param pairs Number of key-value pairs inserted and removed per run.
+ */
+static void benchChangeFeed(int pairs) {
+    static const char* const labels[] = { "no feed", "feed", "feed+reader", "small+slow" };
+    char** keys = makeKeys("feed", pairs);
+    ChangeFeed feeds[4];
+    double best[4] = { 0.0 };
+    long records[4] = { 0 };
+    unsigned long overruns[4] = { 0 };
+    uint64_t lostBytes[4] = { 0 };
+    uint64_t maxLag[4] = { 0 };
+
+    for (int mode = 1; mode < 4; ++mode) {
+        initChangeFeed(&feeds[mode], mode == 3 ? BENCH_SMALL_FEED_BYTES : BENCH_FEED_BYTES);
+    }
+    for (int round = 0; round < 5; ++round) {
+        for (int mode = 0; mode < 4; ++mode) {
+            HashTable table;
+            initHashTable(&table, INITIAL_CAPACITY);
+            if (mode > 0) {
+                setHashTableChangeFeed(&table, &feeds[mode]);
+            }
+
+            volatile int stop = 0;
+            FeedWork work = { .slow = mode == 3, .stop = &stop };
+            pthread_t consumer;
+            if (mode >= 2) {
+                openChangeFeedCursor(&work.cursor, &feeds[mode]);
+                if (pthread_create(&consumer, NULL, feedConsumerThread, &work) != 0) {
+                    perror("Error in pthread_create");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            double seconds = runFeedWrites(&table, keys, pairs);
+            if (mode >= 2) {
+                stop = 1;
+                pthread_join(consumer, NULL);
+                records[mode] += work.records;
+                overruns[mode] += work.cursor.overruns;
+                lostBytes[mode] += work.cursor.lostBytes;
+                maxLag[mode] = work.maxLag > maxLag[mode] ? work.maxLag : maxLag[mode];
+                closeChangeFeedCursor(&work.cursor);
+            }
+            best[mode] = round == 0 || seconds < best[mode] ? seconds : best[mode];
+            freeHashTable(&table);
+        }
+    }
+
+    double baseline = best[0] / (2.0 * pairs) * 1e9;
+    printf("%-11s: %6.1f ns per mutation\n", labels[0], baseline);
+    for (int mode = 1; mode < 4; ++mode) {
+        double nanos = best[mode] / (2.0 * pairs) * 1e9;
+        printf("%-11s: %6.1f ns per mutation (%+.1f), %ld of %d records read, %lu overruns, "
+               "%.1f MB lost, max lag %.2f MB of %.2f MB\n",
+               labels[mode], nanos, nanos - baseline, records[mode], mode >= 2 ? 10 * pairs : 0, overruns[mode],
+               lostBytes[mode] / 1e6, maxLag[mode] / 1e6, feeds[mode].capacity / 1e6);
+    }
+
+    // The records of the table above, published with no table around them
+    double publish = 0.0;
+    for (int round = 0; round < 5; ++round) {
+        double start = threadCpuSeconds();
+        for (int i = 0; i < pairs; ++i) {
+            publishChange(&feeds[1], CHANGE_INSERT, keys[i], strlen(keys[i]), "Country", 7);
+        }
+        for (int i = 0; i < pairs; ++i) {
+            publishChange(&feeds[1], CHANGE_REMOVE, keys[i], strlen(keys[i]), NULL, 0);
+        }
+        double seconds = threadCpuSeconds() - start;
+        publish = round == 0 || seconds < publish ? seconds : publish;
+    }
+    printf("publish    : %6.1f ns per record\n", publish / (2.0 * pairs) * 1e9);
+
+    for (int mode = 1; mode < 4; ++mode) {
+        freeChangeFeed(&feeds[mode]);
+    }
+    freeKeys(keys, pairs);
+}
+
+/**
+ * @brief One timed pass of the intkey scenario over a list of IDs.
+ * @param mode 0 formats each ID with snprintf for the string table, 1 hands the string table
+ *             IDs formatted in advance, 2 uses the integer key table.
+ * @param table HashTable for modes 0 and 1, IntHashTable for mode 2.
+ * @param ids IDs to use.
+ * @param formatted The same IDs in decimal, for mode 1.
+ * @param order Order in which the IDs are used.
+ * @param count Number of IDs.
+ * @param lookup Look the IDs up instead of inserting them.
+ * @return Seconds taken.
+ */
+static double runIntKeyPass(int mode, void* table, const uint64_t* ids, char** formatted, const int* order, int count, int lookup) {
+    char key[BENCH_KEY_LENGTH];
+    volatile const char* sink = NULL;
+
+    double start = nowSeconds();
+    for (int i = 0; i < count; ++i) {
+        int n = order[i];
+        const char* text = formatted != NULL ? formatted[n] : key;
+        if (mode == 0) {
+            snprintf(key, sizeof(key), "%" PRIu64, ids[n]);
+        }
+        if (mode == 2 && lookup) {
+            sink = lookup_intHashTable((IntHashTable*)table, ids[n]);
+        } else if (mode == 2) {
+            insertIntKeyValPair((IntHashTable*)table, ids[n], "Country");
+        } else if (lookup) {
+            sink = lookup_hashTable((HashTable*)table, text);
+        } else {
+            insertKeyValPair((HashTable*)table, text, "Country");
+        }
+    }
+    (void)sink;
+    return nowSeconds() - start;
+}
+
+/**
+ * @brief Random 64-bit IDs in the string table, formatted with snprintf on every call or in
+ *        advance, against the integer key table: inserts from empty, hits and misses in
+ *        random order, and bytes per pair.
+ * @param pairs Number of IDs inserted.
+ */
+static void benchIntKey(int pairs) {
+    static const char* const labels[] = { "sprintf", "string", "integer" };
+    uint64_t* ids = (uint64_t*)malloc(sizeof(uint64_t) * 2 * pairs);
+    char** formatted = (char**)malloc(sizeof(char*) * 2 * pairs);
+    int* order = (int*)malloc(sizeof(int) * pairs);
+    int* missOrder = (int*)malloc(sizeof(int) * pairs);
+    if (ids == NULL || formatted == NULL || order == NULL || missOrder == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    // The first half of the IDs is inserted, the second half only looked up
+    unsigned int state = 2463534242u;
+    for (int i = 0; i < 2 * pairs; ++i) {
+        char key[BENCH_KEY_LENGTH];
+        ids[i] = (uint64_t)nextRandom(&state) << 32 | nextRandom(&state);
+        snprintf(key, sizeof(key), "%" PRIu64, ids[i]);
+        formatted[i] = strdup(key);
+    }
+    shuffle(order, pairs);
+    for (int i = 0; i < pairs; ++i) {
+        missOrder[i] = pairs + order[i];
+    }
+
+#if defined(__x86_64__)
+    if (keyProbeAvx2) {
+        printf("integer probe: AVX2, 4 keys per compare\n");
+    } else {
+        printf("integer probe: SSE2, 2 keys per compare\n");
+    }
+#elif defined(__SSE2__)
+    printf("integer probe: SSE2, 2 keys per compare\n");
+#else
+    printf("integer probe: scalar\n");
+#endif
+    for (int mode = 0; mode < 3; ++mode) {
+        HashTable strings;
+        IntHashTable integers;
+        void* table = mode == 2 ? (void*)&integers : (void*)&strings;
+        char** text = mode == 1 ? formatted : NULL;
+        if (mode == 2) {
+            initIntHashTable(&integers, INITIAL_CAPACITY);
+        } else {
+            initHashTable(&strings, INITIAL_CAPACITY);
+        }
+
+        double insertSeconds = runIntKeyPass(mode, table, ids, text, order, pairs, 0);
+        double hitSeconds = runIntKeyPass(mode, table, ids, text, order, pairs, 1);
+        double missSeconds = runIntKeyPass(mode, table, ids, text, missOrder, pairs, 1);
+        size_t bytes = mode == 2 ? intHashTableMemoryBytes(&integers) : hashTableMemoryBytes(&strings);
+        printf("%-8s: insert %6.1f ns, hit %6.1f ns, miss %6.1f ns, %5.1f bytes per pair\n", labels[mode],
+               insertSeconds / pairs * 1e9, hitSeconds / pairs * 1e9, missSeconds / pairs * 1e9, (double)bytes / pairs);
+
+        if (mode == 2) {
+            freeIntHashTable(&integers);
+        } else {
+            freeHashTable(&strings);
+        }
+    }
+
+    freeKeys(formatted, 2 * pairs);
+    free(ids);
+    free(order);
+    free(missOrder);
+}
+
+/**
+ * @brief Resident set size of the process.
+ * @return Number of bytes, 0 if /proc is not available.
+ */
+static size_t residentBytes(void) {
+    unsigned long pages = 0;
+    unsigned long resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL) {
+        return 0;
+    }
+    if (fscanf(statm, "%lu %lu", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * @brief One run of the defrag scenario: grows the table to its peak, removes most pairs,
+ *        then keeps removing a random pair and inserting a new one, printing the resident
+ *        set against the memory the table accounts for along the way.
+ * @param mode 0 for plain heap strings, 1 to also call malloc_trim at every report, 2 for
+ *             arenas with a compaction step every BENCH_DEFRAG_STEP_OPS mutations.
+ * @param pairs Number of pairs live after the shrink.
+ */
+static void runDefrag(int mode, int pairs) {
+    static const char* const labels[] = { "heap", "heap+trim", "compaction" };
+    static const char* const phases[] = { "peak", "shrunk" };
+    int peak = pairs * BENCH_DEFRAG_PEAK_FACTOR;
+    int rounds = pairs * BENCH_DEFRAG_CHURN_FACTOR;
+    int* live = (int*)malloc(sizeof(int) * peak);
+    if (live == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    HashTable table;
+    initHashTable(&table, INITIAL_CAPACITY);
+    if (mode == 2) {
+        enableHashTableCompaction(&table);
+    }
+
+    char key[BENCH_KEY_LENGTH];
+    char value[BENCH_DEFRAG_MAX_VALUE + 1];
+    unsigned int state = 88172645u;
+    int liveCount = 0;
+    int nextKey = 0;
+    long mutations = 0;
+    size_t moved = 0;
+    double seconds = 0.0;
+    int reports = 4;
+
+    // Values from 16 bytes up, so freed chunks rarely fit the next string exactly
+    memset(value, 'v', sizeof(value));
+    printf("%s\n", labels[mode]);
+    for (int phase = 0; phase < 2 + reports; ++phase) {
+        double start = threadCpuSeconds();
+        int target = phase == 0 ? peak : pairs;
+        int steps = phase == 0 ? peak : phase == 1 ? peak - pairs : rounds / reports;
+        for (int i = 0; i < steps; ++i) {
+            if (phase != 0) {
+                // Remove a random live pair
+                int victim = (int)(nextRandom(&state) % (unsigned int)liveCount);
+                snprintf(key, sizeof(key), "session:%d", live[victim]);
+                removeKeyValPair(&table, key);
+                live[victim] = live[--liveCount];
+            }
+            if (liveCount < target) {
+                int length = 16 + (int)(nextRandom(&state) % (BENCH_DEFRAG_MAX_VALUE - 15));
+                snprintf(key, sizeof(key), "session:%d", nextKey);
+                value[length] = '\0';
+                insertKeyValPair(&table, key, value);
+                value[length] = 'v';
+                live[liveCount++] = nextKey++;
+            }
+            if (mode == 2 && ++mutations % BENCH_DEFRAG_STEP_OPS == 0) {
+                moved += compactHashTable(&table, BENCH_DEFRAG_STEP_BYTES);
+            }
+        }
+        seconds += threadCpuSeconds() - start;
+        if (mode == 1) {
+            malloc_trim(0);
+        }
+
+        char name[16];
+        snprintf(name, sizeof(name), "churn %d/%d", phase - 1, reports);
+        size_t rss = residentBytes();
+        size_t accounted = hashTableMemoryBytes(&table);
+        printf("  %-10s: %7d pairs, strings %6.1f MB, accounted %6.1f MB, resident %6.1f MB, %4.1fx accounted\n",
+               phase < 2 ? phases[phase] : name, table.size, table.stringBytes / 1e6, accounted / 1e6, rss / 1e6,
+               (double)rss / (double)accounted);
+    }
+    printf("  %.1f ns per mutation", seconds / ((double)peak + (double)(peak - pairs) + 2.0 * rounds) * 1e9);
+    if (mode == 2) {
+        printf(", %.1f MB moved, %lu arenas and %lu pages released, %.1f MB mapped", moved / 1e6,
+               table.arenas->releasedArenas, table.arenas->releasedPages, table.arenas->mappedBytes / 1e6);
+    }
+    printf("\n");
+    fflush(stdout);
+
+    freeHashTable(&table);
+    free(live);
+}
+
+/**
+ * @brief Resident memory over a long churn of removals and insertions of variable-size
+ *        values, with heap strings, with heap strings and malloc_trim, and with arenas
+ *        compacted incrementally. Each run is a separate process, so none inherits the heap
+ *        of another.
+ * @param pairs Number of pairs live after the initial shrink.
+ */
+static void benchDefrag(int pairs) {
+    for (int mode = 0; mode < 3; ++mode) {
+        // Flush first, or the child would print the buffered output again
+        fflush(stdout);
+        pid_t child = fork();
+        if (child < 0) {
+            perror("Error in fork");
+            exit(EXIT_FAILURE);
+        }
+        if (child == 0) {
+            runDefrag(mode, pairs);
+            exit(EXIT_SUCCESS);
+        }
+        int status;
+        waitpid(child, &status, 0);
+    }
+}
+
+/**
+ * @brief URL-like keys of one length: a shared prefix padded out, then a distinct number, so
+ *        equal prefixes make every comparison run to the end of the key.
+ * @param count Number of keys.
+ * @param length Length of every key, at least 24.
+ * @return Array of heap allocated keys.
+ */
+static char** makeLongKeys(int count, int length) {
+    char** keys = (char**)malloc(sizeof(char*) * count);
+    if (keys == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < count; ++i) {
+        keys[i] = (char*)malloc(length + 1);
+        if (keys[i] == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        static const char prefix[] = "https://example.com/catalog/items/";
+        for (int j = 0; j < length; ++j) {
+            keys[i][j] = j < (int)sizeof(prefix) - 1 ? prefix[j] : 'a' + j % 26;
+        }
+        keys[i][length] = '\0';
+        char suffix[16];
+        int digits = snprintf(suffix, sizeof(suffix), "/%d", i);
+        memcpy(keys[i] + length - digits, suffix, digits);
+    }
+    return keys;
+}
+
+/**
+ * @brief qsort comparator for key hashes.
+ * @param a Pointer to the first hash.
+ * @param b Pointer to the second hash.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int compareHashes(const void* a, const void* b) {
+    unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Keys sharing both their hash and their length with another key; only these reach
+ *        a byte comparison that fails, and only these could a stored fingerprint reject.
+ * @param keys Distinct keys, all of the same length.
+ * @param count Number of keys.
+ * @return Number of keys.
+ */
+static int countHashCollisions(char** keys, int count) {
+    unsigned int* hashes = (unsigned int*)malloc(sizeof(unsigned int) * count);
+    if (hashes == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < count; ++i) {
+        hashes[i] = hashKey(keys[i]);
+    }
+    qsort(hashes, count, sizeof(unsigned int), compareHashes);
+    int colliding = 0;
+    for (int i = 1; i < count; ++i) {
+        colliding += hashes[i] == hashes[i - 1];
+    }
+    free(hashes);
+    return colliding;
+}
+
+/**
+ * @brief Cost of matching long keys, by key length: strcmp against equalKeyBytes on their own
+ *        over equal keys in different allocations, then whole lookups of present keys, and the
+ *        keys whose hash and length collide with another key's.
+ * @param pairs Number of keys of each length.
+ */
+static void benchKeyCompare(int pairs) {
+    static const int lengths[] = { 16, 32, 64, 128, 256, BENCH_MAX_LONG_KEY };
+    int* order = (int*)malloc(sizeof(int) * pairs);
+    if (order == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    shuffle(order, pairs);
+
+#if defined(__x86_64__)
+    if (keyProbeAvx2) {
+        printf("key compare: AVX2, 32 bytes per step\n");
+    } else {
+        printf("key compare: SSE2, 16 bytes per step\n");
+    }
+#elif defined(__SSE2__)
+    printf("key compare: SSE2, 16 bytes per step\n");
+#else
+    printf("key compare: scalar, 8 bytes per step\n");
+#endif
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+        int length = lengths[l];
+        char** keys = makeLongKeys(pairs, length);
+        char** queries = makeLongKeys(pairs, length);
+        HashTable table;
+        initHashTable(&table, INITIAL_CAPACITY);
+        for (int i = 0; i < pairs; ++i) {
+            insertKeyValPair(&table, keys[i], "Country");
+        }
+
+        // Best of three rounds of each, interleaved
+        double strcmpSeconds = 1e30;
+        double equalSeconds = 1e30;
+        double lookupSeconds = 1e30;
+        volatile int sink = 0;
+        for (int round = 0; round < 3; ++round) {
+            double start = threadCpuSeconds();
+            for (int i = 0; i < pairs; ++i) {
+                sink += strcmp(keys[order[i]], queries[order[i]]) == 0;
+            }
+            double strcmpRound = threadCpuSeconds() - start;
+            start = threadCpuSeconds();
+            for (int i = 0; i < pairs; ++i) {
+                sink += equalKeyBytes(keys[order[i]], queries[order[i]], (size_t)length);
+            }
+            double equalRound = threadCpuSeconds() - start;
+            start = threadCpuSeconds();
+            for (int i = 0; i < pairs; ++i) {
+                sink += lookup_hashTable(&table, queries[order[i]]) != NULL;
+            }
+            double lookupRound = threadCpuSeconds() - start;
+            strcmpSeconds = strcmpRound < strcmpSeconds ? strcmpRound : strcmpSeconds;
+            equalSeconds = equalRound < equalSeconds ? equalRound : equalSeconds;
+            lookupSeconds = lookupRound < lookupSeconds ? lookupRound : lookupSeconds;
+        }
+        if (sink != 9 * pairs) {
+            printf("  key mismatch\n");
+        }
+        printf("%3d bytes: strcmp %6.1f ns, equalKeyBytes %6.1f ns, lookup hit %6.1f ns, %d hash collisions\n", length,
+               strcmpSeconds / pairs * 1e9, equalSeconds / pairs * 1e9, lookupSeconds / pairs * 1e9,
+               countHashCollisions(keys, pairs));
+        fflush(stdout);
+
+        freeHashTable(&table);
+        freeKeys(keys, pairs);
+        freeKeys(queries, pairs);
+    }
+    free(order);
+}
+
+/**
+ * @brief Draws ranks from a Zipf distribution over the keys, rank 0 being the most frequent.
+ * @param draws Receives the ranks.
+ * @param count Number of ranks to draw.
+ * @param keys Number of keys.
+ * @param seed Seed of the draws.
+ */
+static void drawZipf(int* draws, int count, int keys, unsigned int seed) {
+    double* cumulative = (double*)malloc(sizeof(double) * keys);
+    if (cumulative == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    double total = 0;
+    for (int i = 0; i < keys; ++i) {
+        total += 1.0 / pow(i + 1, BENCH_HOT_ZIPF);
+        cumulative[i] = total;
+    }
+    for (int i = 0; i < count; ++i) {
+        double target = (double)nextRandom(&seed) / 4294967296.0 * total;
+        int low = 0;
+        int high = keys - 1;
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (cumulative[middle] < target) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        draws[i] = low;
+    }
+    free(cumulative);
+}
+
+/**
+ * @brief Looks up Zipf distributed keys, rewriting some of them.
+ * @param arg Pointer to the HotKeyWork of the thread.
+ * @return NULL.
+ */
+static void* hotKeyThread(void* arg) {
+    HotKeyWork* work = (HotKeyWork*)arg;
+    char value[BENCH_KEY_LENGTH];
+
+    for (int i = 0; i < work->operations; ++i) {
+        const char* key = work->keys[work->draws[i % BENCH_HOT_DRAWS]];
+        if (work->writeEvery > 0 && nextRandom(&work->seed) % (unsigned int)work->writeEvery == 0) {
+            removeShardedKeyValPair(work->table, key);
+            insertShardedKeyValPair(work->table, key, "Country");
+        } else if (work->cached) {
+            work->found += lookupCachedShardedHashTable(work->table, &work->cache, key, value, sizeof(value));
+        } else {
+            work->found += lookup_shardedHashTable(work->table, key, value, sizeof(value));
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs BENCH_HOT_THREADS threads of the hotkeys scenario on a table.
+ * @param table Table under test.
+ * @param work Work of each thread, receiving the cache counters.
+ * @param keys Keys of the table, by Zipf rank.
+ * @param draws BENCH_HOT_DRAWS ranks per thread.
+ * @param operations Operations per thread.
+ * @param cached Look up through read caches.
+ * @param writeEvery One operation in writeEvery rewrites its key, 0 for lookups only.
+ * @return Wall time taken, in seconds.
+ */
+static double runHotKeys(ShardedHashTable* table, HotKeyWork* work, char** keys, const int* draws, int operations, int cached, int writeEvery) {
+    pthread_t threads[BENCH_HOT_THREADS];
+    double start = nowSeconds();
+
+    for (int t = 0; t < BENCH_HOT_THREADS; ++t) {
+        work[t].table = table;
+        work[t].keys = keys;
+        work[t].draws = draws + t * BENCH_HOT_DRAWS;
+        work[t].operations = operations;
+        work[t].cached = cached;
+        work[t].writeEvery = writeEvery;
+        work[t].seed = 88172645u + (unsigned int)t;
+        work[t].found = 0;
+        if (pthread_create(&threads[t], NULL, hotKeyThread, &work[t]) != 0) {
+            perror("Error in pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int t = 0; t < BENCH_HOT_THREADS; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+    return nowSeconds() - start;
+}
+
+/**
+ * @brief Skewed lookups from BENCH_HOT_THREADS threads, without writes and then with a share
+ *        of rewrites: plain locked lookups, the same with hot key tracking on, and lookups
+ *        through per-thread read caches; then how well the sketches found the most frequent keys.
+ * @param pairs Number of keys, and of operations per thread.
+ */
+static void benchHotKeys(int pairs) {
+    static const char* const modes[] = { "locked", "tracked", "cached" };
+    static const int writeEvery[] = { 0, 1000, 100 };
+    char** keys = makeKeys("hot", pairs);
+    int* draws = (int*)malloc(sizeof(int) * BENCH_HOT_DRAWS * BENCH_HOT_THREADS);
+    HotKeyWork* work = (HotKeyWork*)malloc(sizeof(HotKeyWork) * BENCH_HOT_THREADS);
+    if (draws == NULL || work == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < BENCH_HOT_THREADS; ++t) {
+        drawZipf(draws + t * BENCH_HOT_DRAWS, BENCH_HOT_DRAWS, pairs, 2463534242u + (unsigned int)t);
+    }
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("%d threads, %d keys, Zipf %.2f, %ld CPUs online, best of 3 rounds\n", BENCH_HOT_THREADS, pairs, BENCH_HOT_ZIPF, online);
+
+    for (size_t w = 0; w < sizeof(writeEvery) / sizeof(writeEvery[0]); ++w) {
+        if (writeEvery[w] == 0) {
+            printf("lookups only\n");
+        } else {
+            printf("one write in %d\n", writeEvery[w]);
+        }
+        for (int mode = 0; mode < 3; ++mode) {
+            ShardedHashTable table;
+            initShardedHashTable(&table, 16, INITIAL_CAPACITY, ROUTE_BY_KEY);
+            if (mode == 1) {
+                for (int i = 0; i < table.shardCount; ++i) {
+                    enableHotKeyTracking(&table.shards[i]);
+                }
+            } else if (mode == 2) {
+                enableShardedReadCaches(&table);
+            }
+            for (int i = 0; i < pairs; ++i) {
+                insertShardedKeyValPair(&table, keys[i], "Country");
+            }
+
+            // Caches persist across rounds, as they would in long-lived threads
+            for (int t = 0; t < BENCH_HOT_THREADS; ++t) {
+                initReadCache(&work[t].cache);
+            }
+            double seconds = 1e30;
+            unsigned long hits = 0, misses = 0, fills = 0;
+            for (int round = 0; round < 3; ++round) {
+                double roundSeconds = runHotKeys(&table, work, keys, draws, pairs, mode == 2, writeEvery[w]);
+                seconds = roundSeconds < seconds ? roundSeconds : seconds;
+            }
+            for (int t = 0; t < BENCH_HOT_THREADS; ++t) {
+                hits += work[t].cache.hits;
+                misses += work[t].cache.misses;
+                fills += work[t].cache.fills;
+                freeReadCache(&work[t].cache);
+            }
+            printf("  %-7s : %.2f M operations/s", modes[mode], (double)BENCH_HOT_THREADS * pairs / seconds / 1e6);
+            if (mode == 2) {
+                printf(", cache hit rate %.1f%%, %lu copies made", 100.0 * hits / (hits + misses), fills);
+            }
+            printf("\n");
+
+            // The sketches should single out the head of the distribution, and little else
+            if (mode == 2 && w == 0) {
+                int hot = 0;
+                int head = 0;
+                int tail = 0;
+                for (int i = 0; i < pairs; ++i) {
+                    if (isHashTableHotKey(&table.shards[shardIndex(&table, keys[i])], keys[i])) {
+                        hot++;
+                        head += i < 100;
+                        tail += i >= 1000;
+                    }
+                }
+                printf("  hot keys: %d, %d of them among the 100 most frequent, %d beyond the 1000 most frequent\n", hot, head, tail);
+            }
+            freeShardedHashTable(&table);
+        }
+    }
+
+    free(work);
+    free(draws);
+    freeKeys(keys, pairs);
+}
@@ -3,48 +3,163 @@
  * @brief Hash Table for Data storage with string keys and values.
  *        Player-Country is considered as a Key-Value pair.
  *        O(1) run time for value look up, Hash Function, and Resizing of hash table.
+ *        Every check that finds a wrong result is reported and makes the program exit with 1.
+ *        Build with: gcc hash_table_test.c hash_table.c ordered_index.c membership_filter.c value_codec.c key_hash.c change_feed.c entry_arena.c hot_keys.c -lpthread -lm -o hash_table_test
  */
 
+#include <stdint.h>
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
+#include "hash_table.h"
 
-/** @brief Initial capacity of the hashtable. */
-#define INITIAL_CAPACITY 10
-/** @brief Load factor used while resizing. */
-#define LOAD_FACTOR_THRESHOLD 0.75
+/** @brief Number of checks that found a wrong result. */
+static int failures = 0;
 
-/** @brief Structure representing a key-value pair. */
-typedef struct KeyValue {
-    char* key;  /**< Key of the pair. */
-    char* value; /**< Value associated with the key. */
-    struct KeyValue* next; /**< Pointer to the next key-value pair in the same container. */
-} KeyValue;
+/**
+ * @brief Records the outcome of one check, reporting it when it failed.
+ * @param ok Non-zero if the result was right.
+ * @param what Description of the expected result.
+ */
+static void check(int ok, const char* what) {
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+/**
+ * @brief Compares a looked up value with the expected one.
+ * @param value Value returned by a lookup, NULL when the key was not found.
+ * @param expected Expected value, NULL when the key must be absent.
+ * @return Non-zero if they match.
+ */
+static int sameValue(const char* value, const char* expected) {
+    return expected == NULL ? value == NULL : value != NULL && strcmp(value, expected) == 0;
+}
+
+/**
+ * @brief Ordered index visitor concatenating "key=value;" into a buffer.
+ * @return 0 to keep scanning.
+ */
+static int collectPair(const char* key, const char* value, void* context) {
+    char* out = (char*)context;
+    size_t used = strlen(out);
+    snprintf(out + used, 256 - used, "%s=%s;", key, value);
+    return 0;
+}
+
+/**
+ * @brief Snapshot visitor counting the pairs it sees.
+ */
+static void countPair(const char* key, const char* value, void* context) {
+    (void)key;
+    (void)value;
+    (*(int*)context)++;
+}
 
-/** @brief Structure representing the Hash Table. */
-typedef struct {
-    KeyValue** table; /**< Double pointer to facilitate linked list based key-value pairs when hash collisions occur. */
-    int size; /**< Number of key-value pairs in the hashtable. */
-    int capacity; /**< Current capacity of the hashtable. */
-} HashTable;
+/**
+ * @brief Checks that a shadowed key is scanned once, with its newest value, and comes back on removal.
+ */
+static void testOrderedIndex(void) {
+    HashTable ht;
+    char scanned[256] = "";
+    initHashTable(&ht, INITIAL_CAPACITY);
+    enableOrderedIndex(&ht);
+    insertKeyValPair(&ht, "pele", "Brazil");
+    insertKeyValPair(&ht, "platini", "France");
+    insertKeyValPair(&ht, "zico", "Brazil");
+    insertKeyValPair(&ht, "pele", "Santos");
+
+    check(scanHashTablePrefix(&ht, "p", collectPair, scanned) && strcmp(scanned, "pele=Santos;platini=France;") == 0,
+          "prefix scan returns only the newest value of a key");
+    removeKeyValPair(&ht, "pele");
+    scanned[0] = '\0';
+    check(scanHashTableRange(&ht, "a", "q", collectPair, scanned) && strcmp(scanned, "pele=Brazil;platini=France;") == 0,
+          "range scan returns the restored value after removal");
+    freeHashTable(&ht);
+}
 
-/*  FUNCTION DECLARATIONS   */
-void initHashTable(HashTable* ht, int capacity);
-void insertKeyValPair(HashTable* ht, const char* key, const char* value);
-void removeKeyValPair(HashTable* ht, const char* key);
-const char* lookup_hashTable(const HashTable* ht, const char* key);
-void freeHashTable(HashTable* ht);
-void resizeHashTable(HashTable* ht);
-KeyValue* createKeyValPair(const char* key, const char* value);
-unsigned int hashFunction(const char* key, int capacity);
+/**
+ * @brief Checks numeric counters and that a populated table refuses to become numeric.
+ */
+static void testNumericValues(void) {
+    HashTable ht;
+    int64_t value = 0;
+    initHashTable(&ht, INITIAL_CAPACITY);
+    insertKeyValPair(&ht, "pele", "Brazil");
+    check(!setHashTableNumericValues(&ht), "a populated table keeps its string values");
+    check(!lookup_hashTableNumber(&ht, "pele", &value), "a string table has no numbers");
+    freeHashTable(&ht);
+
+    initHashTable(&ht, INITIAL_CAPACITY);
+    check(setHashTableNumericValues(&ht), "an empty table switches to numbers");
+    incrementKeyValue(&ht, "goals", 5, NULL);
+    incrementKeyValue(&ht, "goals", -2, &value);
+    check(value == 3, "increments add up");
+    check(!addToExistingValue(&ht, "assists", 1, NULL), "adding to an absent key fails");
+    check(lookup_hashTableNumber(&ht, "goals", &value) && value == 3, "the counter reads back");
+    check(sameValue(lookup_hashTable(&ht, "goals"), "3"), "the counter formats as a string");
+    freeHashTable(&ht);
+}
 
-/*  FUNCTION DEFINITIONS */
+/**
+ * @brief Checks the memory budget, compression, the lookup filter, snapshots and compaction.
+ */
+static void testTableFeatures(void) {
+    HashTable ht;
+    char key[32];
+    char value[32];
+    char longValue[600];
+    initHashTable(&ht, INITIAL_CAPACITY);
+    enableLookupFilter(&ht, 0.01);
+    setHashTableCompression(&ht, 64);
+    enableHashTableCompaction(&ht);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "player%d", i);
+        snprintf(value, sizeof(value), "country%d", i);
+        insertKeyValPair(&ht, key, value);
+    }
+    memset(longValue, 'a', sizeof(longValue) - 1);
+    longValue[sizeof(longValue) - 1] = '\0';
+    insertKeyValPair(&ht, "long", longValue);
+    check(sameValue(lookup_hashTable(&ht, "long"), longValue), "a compressed value reads back whole");
+    check(lookup_hashTable(&ht, "nobody") == NULL, "the lookup filter lets absent keys miss");
+
+    HashTableSnapshot* snapshot = snapshotHashTable(&ht);
+    for (int i = 0; i < 1000; i += 2) {
+        snprintf(key, sizeof(key), "player%d", i);
+        removeKeyValPair(&ht, key);
+    }
+    int pairs = 0;
+    forEachSnapshotPair(snapshot, countPair, &pairs);
+    check(pairs == 1001, "a snapshot keeps the pairs removed after it was taken");
+    releaseHashTableSnapshot(&ht, snapshot);
+
+    compactHashTable(&ht, SIZE_MAX);
+    int intact = 1;
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "player%d", i);
+        snprintf(value, sizeof(value), "country%d", i);
+        intact &= sameValue(lookup_hashTable(&ht, key), i % 2 ? value : NULL);
+    }
+    check(intact, "compaction keeps every remaining pair");
+
+    setHashTableMemoryBudget(&ht, hashTableMemoryBytes(&ht), BUDGET_REJECT, NULL, NULL);
+    check(!insertKeyValPair(&ht, "maradona", "Argentina"), "an insertion over the budget is rejected");
+    check(lookup_hashTable(&ht, "maradona") == NULL, "a rejected pair is not stored");
+    check(hashTableMemoryBytes(&ht) <= ht.memoryBudget, "the table stays within its budget");
+    setHashTableMemoryBudget(&ht, hashTableMemoryBytes(&ht), BUDGET_EVICT, NULL, NULL);
+    check(insertKeyValPair(&ht, "maradona", "Argentina"), "eviction makes room for an insertion");
+    check(sameValue(lookup_hashTable(&ht, "maradona"), "Argentina"), "the pair inserted after eviction is stored");
+    freeHashTable(&ht);
+}
 
 /** 
  * @brief Main function demonstrating the usage of the hash table.
  * @details Creates a hash table, inserts key-value pairs, looks up values, removes a key-value pair,
- *          and frees allocated memory.
- * @return 0 on successful execution.
+ *          and frees allocated memory. Then checks the ordered index, numeric values and the other
+ *          table features.
+ * @return 0 if every check passed, 1 otherwise.
  */
 int main(void) {
     //Create and initialize a Hash Table with a minimal capacity
@@ -73,235 +188,40 @@ int main(void) {
     //During remove - resizing of HashTable is handled
     removeKeyValPair(&myHashTable, "maradona");
     const char* removedmaradona = lookup_hashTable(&myHashTable, "maradona");
+    check(removedmaradona == NULL, "a removed key is not found");
     if (removedmaradona == NULL) {
         printf("Maradona Country Entry was successfully removed.\n");
     }
 
-    //Free allocated memory
-    freeHashTable(&myHashTable);
-
-    return 0;
-}
-
-/** 
- * @brief Initializes a hash table with a given capacity.
- * @param ht Pointer to the hash table to be initialized.
- * @param capacity Initial capacity of the hash table.
- */
-void initHashTable(HashTable* ht, int capacity) {
-    ht->table = (KeyValue**)malloc(sizeof(KeyValue*) * capacity);
-    if (ht->table == NULL) {
-        perror("Memory allocation error");
-        exit(EXIT_FAILURE);
-    }
-    ht->size = 0;
-    ht->capacity = capacity;
-
-    // Initialize each container with NULL
-    for (int i = 0; i < capacity; ++i) {
-        ht->table[i] = NULL;
-    }
-}
-
-/** 
- * @brief Inserts a key-value pair into the hash table, handles resizing if necessary.
- * @param ht Pointer to the hash table.
- * @param key Key of the pair.
- * @param value Value associated with the key.
- */
-void insertKeyValPair(HashTable* ht, const char* key, const char* value) {
-    // Check if resizing is needed
-    if ((double)ht->size / ht->capacity > LOAD_FACTOR_THRESHOLD) {
-        resizeHashTable(ht);
-    }
-
-    // Calculate hash index
-    unsigned int index = hashFunction(key, ht->capacity);
-
-    // Create a new key-value pair
-    KeyValue* newPair = createKeyValPair(key, value);
-
-    // Add the new pair to the beginning of the linked list at the hash index
-    newPair->next = ht->table[index];
-    ht->table[index] = newPair;
-
-    // Increment the size of the hashtable
-    ht->size++;
-}
-
-/** 
- * @brief Removes a key-value pair from the hash table, handles resizing if necessary.
- * @param ht Pointer to the hash table.
- * @param key Key of the pair to be removed.
- */
-void removeKeyValPair(HashTable* ht, const char* key) {
-    // Calculate hash index
-    unsigned int index = hashFunction(key, ht->capacity);
-    KeyValue* current = ht->table[index];
-    KeyValue* prev = NULL;
-
-    // Traverse the linked list in the container
-    while (current != NULL) {
-        // Check if the current key matches the target key
-        if (strcmp(current->key, key) == 0) {
-            // Remove the pair from the linked list
-            if (prev == NULL) {
-                // If the pair is at the beginning of the list
-                ht->table[index] = current->next;
-            } else {
-                prev->next = current->next;
-            }
-
-            // Free memory for the removed pair
-            free(current->key);
-            free(current->value);
-            free(current);
-
-            // Decrement the size of the hashtable
-            ht->size--;
-
-            // Check if resizing is needed
-            if ((double)ht->size / ht->capacity < LOAD_FACTOR_THRESHOLD) {
-                resizeHashTable(ht);
-            }
-            
-            return;
-        }
-
-        prev = current;
-        current = current->next;
-    }
-}
-
-/** 
- * @brief Looks up the value associated with a given key in the hash table.
- * @param ht Pointer to the hash table.
- * @param key Key to look up.
- * @return Value associated with the key, or NULL if not found.
- */
-const char* lookup_hashTable(const HashTable* ht, const char* key) {
-    // Calculate hash index
-    unsigned int index = hashFunction(key, ht->capacity);
-    KeyValue* current = ht->table[index];
-
-    // Traverse the linked list in the container
-    while (current != NULL) {
-        // Check if the current key matches the target key
-        if (strcmp(current->key, key) == 0) {
-            return current->value;
-        }
-        current = current->next;
-    }
-
-    // Key not found
-    return NULL;
-}
-
-/** 
- * @brief Frees the memory allocated for the hash table and its key-value pairs.
- * @param ht Pointer to the hash table to be freed.
- */
-void freeHashTable(HashTable* ht) {
-    // Iterate through each container in the hashtable
-    for (int i = 0; i < ht->capacity; ++i) {
-        KeyValue* current = ht->table[i];
-        // Traverse the linked list in the current container
-        while (current != NULL) {
-            KeyValue* next = current->next;
-            // Free memory for the key, value, and the key-value pair
-            free(current->key);
-            free(current->value);
-            free(current);
-            current = next;
-        }
-    }
-    // Free the array of containers
-    free(ht->table);
-}
-
-/** 
- * @brief Creates a new key-value pair with the given key and value.
- * @param key Key of the pair.
- * @param value Value associated with the key.
- * @return Pointer to the newly created key-value pair.
- */
-KeyValue* createKeyValPair(const char* key, const char* value) {
-    // Allocate memory for a new key-value pair
-    KeyValue* newPair = (KeyValue*)malloc(sizeof(KeyValue));
-    if (newPair == NULL) {
-        perror("Memory allocation error");
-        exit(EXIT_FAILURE);
-    }
-    // Duplicate the key and value using strdup to manage memory
-    newPair->key = (char *)strdup(key);
-    newPair->value = (char *)strdup(value);
-    // Initialize the next pointer to NULL
-    newPair->next = NULL;
-
-    return newPair;
-}
-
-/** 
- * @brief Resizes the hash table by doubling its size and rehashing existing key-value pairs.
- * @param ht Pointer to the hash table to be resized.
- */
-void resizeHashTable(HashTable* ht) {
-    // Calculate the new capacity (double the current capacity)
-    int newCapacity = ht->capacity * 2;
-    // Allocate memory for the new array of containers
-    KeyValue** newTable = (KeyValue**)malloc(sizeof(KeyValue*) * newCapacity);
-    if (newTable == NULL) {
-        perror("Memory allocation error");
-        exit(EXIT_FAILURE);
-    }
-
-    // Initialize each container in the new array with NULL
-    for (int i = 0; i < newCapacity; ++i) {
-        newTable[i] = NULL;
-    }
-
-    // Iterate through each container in the current hashtable
-    for (int i = 0; i < ht->capacity; ++i) {
-        KeyValue* current = ht->table[i];
-        // Traverse the linked list in the current container
-        while (current != NULL) {
-            KeyValue* next = current->next;
-            // Calculate the new hash index for the key in the new hashtable
-            unsigned int newIndex = hashFunction(current->key, newCapacity);
-            // Add the current key-value pair to the beginning of the linked list in the new container
-            current->next = newTable[newIndex];
-            newTable[newIndex] = current;
-            current = next;
-        }
+    //insert a key again - the newest value wins until it is removed
+    insertKeyValPair(&myHashTable, "pele", "Santos");
+    const char* newest = lookup_hashTable(&myHashTable, "pele");
+    int shadowed = sameValue(newest, "Santos");
+    check(shadowed, "a repeated key returns its newest value");
+    removeKeyValPair(&myHashTable, "pele");
+    const char* previous = lookup_hashTable(&myHashTable, "pele");
+    check(sameValue(previous, "Brazil"), "removing the newest value restores the previous one");
+    if (shadowed && sameValue(previous, "Brazil")) {
+        printf("Pele Country was shadowed and then restored.\n");
     }
+    removeKeyValPair(&myHashTable, "pele");
+    check(lookup_hashTable(&myHashTable, "pele") == NULL, "removing every value removes the key");
 
-    // Free the memory allocated for the old array of containers
-    free(ht->table);
-    // Update the hash table with the new array of containers and capacity
-    ht->table = newTable;
-    ht->capacity = newCapacity;
-}
+    //Display the health of the table
+    HashTableStats stats;
+    getHashTableStats(&myHashTable, &stats);
+    printHashTableStats(&stats);
 
-/** 
- * @brief Simple hash function.
- * @details Calculates the hash value as the sum of ASCII values of characters in the key, 
- *          rounded to the hashtable capacity.
- * @param key Key for which the hash value is calculated.
- * @param capacity Current capacity of the hash table.
- * @return Calculated hash value.
- */
-unsigned int hashFunction(const char* key, int capacity) {
-    unsigned int hash = 0;
+    //Free allocated memory
+    freeHashTable(&myHashTable);
 
-    // Calculate the hash value by adding the ASCII values of characters in the key
-    for (int i = 0; key[i] != '\0'; ++i) {
-        hash += key[i];
+    testOrderedIndex();
+    testNumericValues();
+    testTableFeatures();
+    if (failures > 0) {
+        printf("%d checks failed.\n", failures);
+        return 1;
     }
-
-    // Round the calculated hash value to fit within the hashtable capacity
-    return hash % capacity;
+    printf("All checks passed.\n");
+    return 0;
 }
-
-
-
-
@@ -0,0 +1,138 @@
+/**
+ * @file hot_keys.c
+ * @brief Implementation of the hot key sketch declared in hot_keys.h.
+ *        Counters are updated with relaxed atomics and without a lock, from any number of
+ *        threads; an increment racing with a halving may be lost, which only makes the
+ *        estimate of that key slightly lower.
+ */
+
+#include <string.h>
+#include "hot_keys.h"
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Stripe of pending samples the calling thread uses, assigned round-robin on first use.
+ * @return Index of the stripe.
+ */
+static int sampleStripe(void) {
+    static unsigned int nextStripe = 0;
+    static _Thread_local int stripe = -1;
+
+    if (stripe < 0) {
+        stripe = (int)(__atomic_fetch_add(&nextStripe, 1, __ATOMIC_RELAXED) % HOT_KEY_SAMPLE_STRIPES);
+    }
+    return stripe;
+}
+
+/**
+ * @brief Block holding the counters of a key hash.
+ * @details Keeps the high bits of the product, which every bit of the hash reaches.
+ * @param hash Hash of the key.
+ * @return Index of the block.
+ */
+static unsigned int blockIndex(unsigned int hash) {
+    return (hash * 0x9E3779B1u) >> (32 - __builtin_ctz(HOT_KEY_SKETCH_BLOCKS));
+}
+
+/**
+ * @brief Counters of a key hash in its block, one per row.
+ * @details A second product gives a few high bits per row, independent of the block index.
+ * @param hash Hash of the key.
+ * @param counters Receives the index of the counter of each row within the block.
+ */
+static void counterIndexes(unsigned int hash, unsigned int counters[HOT_KEY_SKETCH_ROWS]) {
+    const int bits = __builtin_ctz(HOT_KEY_ROW_COUNTERS);
+    unsigned int picks = (hash * 0x85EBCA77u) >> (32 - bits * HOT_KEY_SKETCH_ROWS);
+
+    for (int row = 0; row < HOT_KEY_SKETCH_ROWS; ++row) {
+        counters[row] = row * HOT_KEY_ROW_COUNTERS + ((picks >> (row * bits)) & (HOT_KEY_ROW_COUNTERS - 1));
+    }
+}
+
+/**
+ * @brief Halves every counter and the number of samples.
+ * @param sketch Pointer to the sketch.
+ */
+static void halveHotKeySketch(HotKeySketch* sketch) {
+    for (int block = 0; block < HOT_KEY_SKETCH_BLOCKS; ++block) {
+        for (int i = 0; i < HOT_KEY_BLOCK_COUNTERS; ++i) {
+            uint16_t count = __atomic_load_n(&sketch->counters[block][i], __ATOMIC_RELAXED);
+            __atomic_store_n(&sketch->counters[block][i], (uint16_t)(count / 2), __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_fetch_sub(&sketch->samples, HOT_KEY_WINDOW / 2, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&sketch->halvings, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Initializes an empty sketch.
+ * @param sketch Pointer to the sketch.
+ */
+void initHotKeySketch(HotKeySketch* sketch) {
+    memset(sketch, 0, sizeof(*sketch));
+}
+
+/**
+ * @brief Counts a lookup of a key, if the calling thread samples it.
+ * @details Lookups are picked by a xorshift generator of the thread rather than a counter,
+ *          which would only ever sample the same few keys of a periodic access pattern. The
+ *          generator belongs to the thread, not to the sketch. Samples are counted on the
+ *          stripe of the thread and added to the total HOT_KEY_SAMPLE_BATCH at a time. The
+ *          thread whose batch completes a window halves the counters.
+ * @param sketch Pointer to the sketch.
+ * @param hash Hash of the key looked up.
+ */
+void sampleHotKey(HotKeySketch* sketch, unsigned int hash) {
+    static _Thread_local unsigned int state = 2463534242u;
+
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    if ((state >> (32 - HOT_KEY_SAMPLE_SHIFT)) != 0) {
+        return;
+    }
+    uint16_t* block = sketch->counters[blockIndex(hash)];
+    unsigned int counters[HOT_KEY_SKETCH_ROWS];
+    counterIndexes(hash, counters);
+    for (int row = 0; row < HOT_KEY_SKETCH_ROWS; ++row) {
+        __atomic_fetch_add(&block[counters[row]], 1, __ATOMIC_RELAXED);
+    }
+    if (__atomic_add_fetch(&sketch->pendingSamples[sampleStripe()][0], 1, __ATOMIC_RELAXED) % HOT_KEY_SAMPLE_BATCH != 0) {
+        return;
+    }
+    // Totals stay multiples of the batch, so exactly one batch lands on the window
+    if (__atomic_add_fetch(&sketch->samples, HOT_KEY_SAMPLE_BATCH, __ATOMIC_RELAXED) == HOT_KEY_WINDOW) {
+        halveHotKeySketch(sketch);
+    }
+}
+
+/**
+ * @brief Sampled lookups of a key, an upper bound since colliding keys share counters.
+ * @param sketch Pointer to the sketch.
+ * @param hash Hash of the key.
+ * @return Smallest counter of the key over the rows.
+ */
+uint32_t hotKeyEstimate(const HotKeySketch* sketch, unsigned int hash) {
+    const uint16_t* block = sketch->counters[blockIndex(hash)];
+    unsigned int counters[HOT_KEY_SKETCH_ROWS];
+    uint32_t estimate = UINT32_MAX;
+
+    counterIndexes(hash, counters);
+    for (int row = 0; row < HOT_KEY_SKETCH_ROWS; ++row) {
+        uint32_t count = __atomic_load_n(&block[counters[row]], __ATOMIC_RELAXED);
+        estimate = count < estimate ? count : estimate;
+    }
+    return estimate;
+}
+
+/**
+ * @brief Whether a key takes at least 1/HOT_KEY_SHARE of the sampled lookups.
+ * @param sketch Pointer to the sketch.
+ * @param hash Hash of the key.
+ * @return Non-zero for a hot key, 0 otherwise or before HOT_KEY_MIN_SAMPLES samples.
+ */
+int isHotKey(const HotKeySketch* sketch, unsigned int hash) {
+    uint64_t samples = __atomic_load_n(&sketch->samples, __ATOMIC_RELAXED);
+    return samples >= HOT_KEY_MIN_SAMPLES && (uint64_t)hotKeyEstimate(sketch, hash) * HOT_KEY_SHARE >= samples;
+}
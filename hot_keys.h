@@ -0,0 +1,68 @@
+/**
+ * @file hot_keys.h
+ * @brief Count-min sketch of the lookups of a table, telling the few keys that take most of
+ *        them from the rest.
+ *        Each thread counts only one lookup in 2^HOT_KEY_SAMPLE_SHIFT of its own, so the shared
+ *        counters are touched rarely. A sampled key hash adds one to a counter in every row;
+ *        its estimate is the smallest of those counters, which collisions can only inflate.
+ *        Like the membership filter, the rows of a key all lie in one cache-line sized block,
+ *        so sampling or estimating a key costs a single cache miss. Once HOT_KEY_WINDOW samples
+ *        have been counted every counter is halved, so a key that stops being looked up cools
+ *        down, and no counter outgrows 16 bits.
+ *        Samples reach the shared total in batches: a thread first counts them on a
+ *        cache-line sized stripe of the sketch, so threads sampling the same table rarely write
+ *        the same line.
+ */
+
+#ifndef HOT_KEYS_H
+#define HOT_KEYS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Bytes per sketch block, one cache line. */
+#define HOT_KEY_BLOCK_BYTES 64
+/** @brief 16-bit counters per sketch block. */
+#define HOT_KEY_BLOCK_COUNTERS (HOT_KEY_BLOCK_BYTES / 2)
+/** @brief Rows of the sketch, each a slice of every block. */
+#define HOT_KEY_SKETCH_ROWS 4
+/** @brief Counters of a row within one block, a power of two. */
+#define HOT_KEY_ROW_COUNTERS (HOT_KEY_BLOCK_COUNTERS / HOT_KEY_SKETCH_ROWS)
+/** @brief Blocks of the sketch, a power of two; rows of HOT_KEY_SKETCH_BLOCKS * HOT_KEY_ROW_COUNTERS
+ *         counters stay well above HOT_KEY_SHARE, so cold keys stay under the bar. */
+#define HOT_KEY_SKETCH_BLOCKS 512
+/** @brief Each thread samples one lookup in 2^HOT_KEY_SAMPLE_SHIFT. */
+#define HOT_KEY_SAMPLE_SHIFT 4
+/** @brief Stripes counting samples before they reach the total, threads beyond this share stripes. */
+#define HOT_KEY_SAMPLE_STRIPES 16
+/** @brief Samples a stripe adds to the total at once; divides HOT_KEY_WINDOW / 2. */
+#define HOT_KEY_SAMPLE_BATCH 16
+/** @brief Samples after which every counter is halved, at most 65535. */
+#define HOT_KEY_WINDOW 32768
+/** @brief A key is hot once it takes at least 1/HOT_KEY_SHARE of the sampled lookups. */
+#define HOT_KEY_SHARE 256
+/** @brief Samples needed before any key is called hot. */
+#define HOT_KEY_MIN_SAMPLES 1024
+
+/** @brief Structure representing the sketch, to be allocated aligned to HOT_KEY_BLOCK_BYTES. */
+typedef struct {
+    uint16_t counters[HOT_KEY_SKETCH_BLOCKS][HOT_KEY_BLOCK_COUNTERS]; /**< Sampled lookups, row after row in each block. */
+    uint32_t pendingSamples[HOT_KEY_SAMPLE_STRIPES][HOT_KEY_BLOCK_BYTES / sizeof(uint32_t)]; /**< Samples of each stripe, in its first word. */
+    uint64_t samples; /**< Samples counted, in whole batches, halved together with the counters. */
+    unsigned long halvings; /**< Number of times the counters were halved. */
+} HotKeySketch;
+
+/*  FUNCTION DECLARATIONS   */
+void initHotKeySketch(HotKeySketch* sketch);
+void sampleHotKey(HotKeySketch* sketch, unsigned int hash);
+uint32_t hotKeyEstimate(const HotKeySketch* sketch, unsigned int hash);
+int isHotKey(const HotKeySketch* sketch, unsigned int hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOT_KEYS_H */
@@ -0,0 +1,226 @@
+/**
+ * @file int_hash_table.c
+ * @brief Implementation of the integer key Hash Table declared in int_hash_table.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "int_hash_table.h"
+#include "bucket_engine.h"
+#include "key_hash.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/** @brief Arrays of an IntBucket: key and value of every pair. */
+#define INT_BUCKET_ARRAYS(X) X(keys, uint64_t) X(values, char*)
+
+/** @brief Container functions of IntBucket: appendToIntBucket, removeFromIntBucket, releaseIntBucket. */
+DEFINE_BUCKET_ENGINE(IntBucket, IntBucket, INT_BUCKET_ARRAYS, keys, INT_BUCKET_INITIAL_SLOTS)
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Container of a key.
+ * @param it Pointer to the integer hash table.
+ * @param key Key of the pair.
+ * @return Pointer to the container.
+ */
+static IntBucket* containerOf(const IntHashTable* it, uint64_t key) {
+    return &it->table[hashKeyUint64(key) & (uint64_t)(it->capacity - 1)];
+}
+
+#if defined(__x86_64__)
+/**
+ * @brief findInIntBucket comparing 4 keys per AVX2 instruction.
+ * @details Compiled for AVX2 whatever the build flags, so only call it when keyProbeAvx2 is set.
+ * @param bucket Pointer to the container.
+ * @param key Key to look for.
+ * @return Slot index of the key, or -1 if not found.
+ */
+__attribute__((target("avx2")))
+static int findInIntBucketAvx2(const IntBucket* bucket, uint64_t key) {
+    const __m256i wanted = _mm256_set1_epi64x((long long)key);
+    for (int i = (bucket->count - 1) & ~3; i >= 0; i -= 4) {
+        __m256i keys = _mm256_loadu_si256((const __m256i*)(bucket->keys + i));
+        unsigned int mask = (unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(keys, wanted)));
+        mask &= bucket->count - i >= 4 ? 0xFu : (1u << (bucket->count - i)) - 1;
+        if (mask != 0) {
+            return i + 31 - __builtin_clz(mask);
+        }
+    }
+    return -1;
+}
+#endif
+
+/**
+ * @brief Finds the slot of a key inside a container.
+ * @details Compares a whole vector of keys at once, with AVX2 when startup detection found
+ *          it and SSE2 otherwise. Slots come in multiples of the vector width, so the last
+ *          vector never reads past the arrays; matches beyond the pairs in use are masked
+ *          off. Vectors are scanned from the newest pair down and the highest match wins, so
+ *          a key inserted twice resolves to its latest value.
+ * @param bucket Pointer to the container.
+ * @param key Key to look for.
+ * @return Slot index of the key, or -1 if not found.
+ */
+static int findInIntBucket(const IntBucket* bucket, uint64_t key) {
+#if defined(__x86_64__)
+    if (keyProbeAvx2) {
+        return findInIntBucketAvx2(bucket, key);
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i wanted = _mm_set1_epi64x((long long)key);
+    for (int i = (bucket->count - 1) & ~1; i >= 0; i -= 2) {
+        __m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(bucket->keys + i)), wanted);
+        // A key matches when both of its 32-bit halves do
+        equal = _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+        unsigned int mask = (unsigned int)_mm_movemask_pd(_mm_castsi128_pd(equal));
+        mask &= bucket->count - i >= 2 ? 0x3u : 0x1u;
+        if (mask != 0) {
+            return i + 31 - __builtin_clz(mask);
+        }
+    }
+#else
+    for (int i = bucket->count - 1; i >= 0; --i) {
+        if (bucket->keys[i] == key) {
+            return i;
+        }
+    }
+#endif
+    return -1;
+}
+
+/**
+ * @brief Initializes an integer hash table.
+ * @param it Pointer to the integer hash table.
+ * @param capacity Initial number of containers, rounded up to a power of two.
+ */
+void initIntHashTable(IntHashTable* it, int capacity) {
+    int containers = 1;
+    while (containers < capacity) {
+        containers *= 2;
+    }
+    it->table = (IntBucket*)calloc(containers, sizeof(IntBucket));
+    if (it->table == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    it->size = 0;
+    it->capacity = containers;
+    it->resizeCount = 0;
+    it->entryBytes = 0;
+    it->stringBytes = 0;
+}
+
+/**
+ * @brief Doubles the array of containers and moves every pair to its new container.
+ * @details fmix64 spreads every key bit over the low bits, so the index is a mask and the
+ *          keys are rehashed instead of keeping a hash per pair.
+ * @param it Pointer to the integer hash table.
+ */
+static void resizeIntHashTable(IntHashTable* it) {
+    IntHashTable grown = *it;
+    grown.capacity = it->capacity * 2;
+    grown.table = (IntBucket*)calloc(grown.capacity, sizeof(IntBucket));
+    if (grown.table == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    grown.entryBytes = 0;
+
+    for (int i = 0; i < it->capacity; ++i) {
+        IntBucket* bucket = &it->table[i];
+        for (int j = 0; j < bucket->count; ++j) {
+            grown.entryBytes += appendToIntBucket(containerOf(&grown, bucket->keys[j]), bucket->keys[j], bucket->values[j]);
+        }
+        releaseIntBucket(bucket);
+    }
+    free(it->table);
+    grown.resizeCount++;
+    *it = grown;
+}
+
+/**
+ * @brief Inserts a key-value pair, handles resizing if necessary.
+ * @details Like insertKeyValPair, a key already present is added again: lookups see the
+ *          new value until it is removed, which brings the previous one back.
+ * @param it Pointer to the integer hash table.
+ * @param key Key of the pair.
+ * @param value Value associated with the key, copied.
+ */
+void insertIntKeyValPair(IntHashTable* it, uint64_t key, const char* value) {
+    if ((double)it->size / it->capacity > INT_LOAD_FACTOR_THRESHOLD) {
+        resizeIntHashTable(it);
+    }
+
+    char* ownedValue = strdup(value);
+    if (ownedValue == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    it->entryBytes += appendToIntBucket(containerOf(it, key), key, ownedValue);
+    it->stringBytes += strlen(value) + 1;
+    it->size++;
+}
+
+/**
+ * @brief Removes a key-value pair.
+ * @param it Pointer to the integer hash table.
+ * @param key Key of the pair to be removed.
+ */
+void removeIntKeyValPair(IntHashTable* it, uint64_t key) {
+    IntBucket* bucket = containerOf(it, key);
+    int slot = findInIntBucket(bucket, key);
+    if (slot < 0) {
+        return;
+    }
+
+    // Free memory for the removed value and close the hole, keeping the insertion order
+    it->stringBytes -= strlen(bucket->values[slot]) + 1;
+    free(bucket->values[slot]);
+    removeFromIntBucket(bucket, slot);
+    if (bucket->count == 0) {
+        it->entryBytes -= releaseIntBucket(bucket);
+    }
+    it->size--;
+}
+
+/**
+ * @brief Looks up the value associated with a given key.
+ * @param it Pointer to the integer hash table.
+ * @param key Key to look up.
+ * @return Value associated with the key, or NULL if not found.
+ */
+const char* lookup_intHashTable(const IntHashTable* it, uint64_t key) {
+    const IntBucket* bucket = containerOf(it, key);
+    int slot = findInIntBucket(bucket, key);
+    return slot >= 0 ? bucket->values[slot] : NULL;
+}
+
+/**
+ * @brief Every byte the table allocated: containers, their arrays and the values.
+ * @param it Pointer to the integer hash table.
+ * @return Number of bytes.
+ */
+size_t intHashTableMemoryBytes(const IntHashTable* it) {
+    return sizeof(IntBucket) * it->capacity + it->entryBytes + it->stringBytes;
+}
+
+/**
+ * @brief Frees the memory allocated for the table and its values.
+ * @param it Pointer to the integer hash table to be freed.
+ */
+void freeIntHashTable(IntHashTable* it) {
+    for (int i = 0; i < it->capacity; ++i) {
+        IntBucket* bucket = &it->table[i];
+        for (int j = 0; j < bucket->count; ++j) {
+            free(bucket->values[j]);
+        }
+        releaseIntBucket(bucket);
+    }
+    free(it->table);
+}
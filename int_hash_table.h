@@ -0,0 +1,56 @@
+/**
+ * @file int_hash_table.h
+ * @brief Hash Table specialized for 64-bit integer keys.
+ *        Keys are stored inline in the containers, hashed with fmix64 and compared as
+ *        integers, so a key is never formatted, allocated or compared as a string. The
+ *        containers are generated from the same engine as those of the string table
+ *        (bucket_engine.h); only the probe differs, comparing 4 keys per AVX2 instruction,
+ *        2 with SSE2.
+ */
+
+#ifndef INT_HASH_TABLE_H
+#define INT_HASH_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Pairs per container above which the table doubles; an AVX2 probe compares 4 keys at once. */
+#define INT_LOAD_FACTOR_THRESHOLD 4.0
+/** @brief Pair slots of a container the first time it is used, one full vector of keys. */
+#define INT_BUCKET_INITIAL_SLOTS 4
+
+/** @brief Container holding the pairs whose keys hash to it, as parallel arrays. */
+typedef struct {
+    uint64_t* keys; /**< Keys of the pairs, scanned by the probe; the block starts here. */
+    char** values; /**< Values associated with the keys. */
+    int count; /**< Number of pairs in the container. */
+    int slots; /**< Number of pairs the arrays can hold, a multiple of INT_BUCKET_INITIAL_SLOTS. */
+} IntBucket;
+
+/** @brief Structure representing the integer key Hash Table. */
+typedef struct {
+    IntBucket* table; /**< Array of containers, indexed by the low bits of the key hash. */
+    int size; /**< Number of key-value pairs. */
+    int capacity; /**< Number of containers, a power of two. */
+    unsigned long resizeCount; /**< Number of times the table doubled. */
+    size_t entryBytes; /**< Bytes allocated for the per-container arrays. */
+    size_t stringBytes; /**< Bytes allocated for the values. */
+} IntHashTable;
+
+/*  FUNCTION DECLARATIONS   */
+void initIntHashTable(IntHashTable* it, int capacity);
+void insertIntKeyValPair(IntHashTable* it, uint64_t key, const char* value);
+void removeIntKeyValPair(IntHashTable* it, uint64_t key);
+const char* lookup_intHashTable(const IntHashTable* it, uint64_t key);
+size_t intHashTableMemoryBytes(const IntHashTable* it);
+void freeIntHashTable(IntHashTable* it);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INT_HASH_TABLE_H */
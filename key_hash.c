@@ -0,0 +1,283 @@
+/**
+ * @file key_hash.c
+ * @brief Implementation of the key hash functions declared in key_hash.h.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "key_hash.h"
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define KEY_HASH_X86 1
+#else
+#define KEY_HASH_X86 0
+#endif
+
+/** @brief Implementation hashKeyBytes calls, FNV-1a until startup detection ran. */
+static KeyHashFunction activeHash = hashKeyFnv1a;
+/** @brief Which implementation activeHash is. */
+static KeyHashImplementation activeImplementation = KEY_HASH_FNV1A;
+/** @brief Whether the key probes use AVX2, 0 until startup detection ran. */
+int keyProbeAvx2 = 0;
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Hashes a key with the implementation selected at startup.
+ * @param key Bytes of the key.
+ * @param length Number of bytes.
+ * @return 32-bit hash.
+ */
+unsigned int hashKeyBytes(const char* key, size_t length) {
+    return activeHash(key, length);
+}
+
+/**
+ * @brief FNV-1a hash function.
+ * @details Mixes every character of the key into the hash, so keys spread over the whole
+ *          array of containers instead of clustering on small character sums.
+ * @param key Bytes of the key.
+ * @param length Number of bytes.
+ * @return 32-bit hash.
+ */
+unsigned int hashKeyFnv1a(const char* key, size_t length) {
+    unsigned int hash = 2166136261u;
+
+    // Fold each character into the hash and spread it with the FNV prime
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+#if KEY_HASH_X86
+
+/**
+ * @brief Reads 8 bytes without alignment requirements.
+ * @param p Pointer to the bytes.
+ * @return The bytes as a 64-bit value.
+ */
+static uint64_t read64(const char* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Reads the last 1 to 8 bytes of a key with fixed-size loads instead of a memcpy.
+ * @details Overlapping reads still see every byte once the length is known, and every
+ *          implementation mixes the length in, so distinct keys stay distinct.
+ * @param p First byte.
+ * @param count Number of bytes, 1 to 8.
+ * @return The bytes packed in a 64-bit value.
+ */
+static uint64_t readPartial(const char* p, size_t count) {
+    const unsigned char* bytes = (const unsigned char*)p;
+    if (count >= 4) {
+        uint32_t low, high;
+        memcpy(&low, p, sizeof(low));
+        memcpy(&high, p + count - 4, sizeof(high));
+        return (uint64_t)high << 32 | low;
+    }
+    return (uint64_t)bytes[0] << 16 | (uint64_t)bytes[count / 2] << 8 | bytes[count - 1];
+}
+
+/**
+ * @brief Hash built on the SSE4.2 CRC32C instruction.
+ * @details Two independent lanes take alternate 8-byte words so their latencies overlap.
+ *          CRC is linear, so the lanes are joined by a multiplicative finalizer.
+ * @param key Bytes of the key.
+ * @param length Number of bytes.
+ * @return 32-bit hash.
+ */
+__attribute__((target("sse4.2")))
+unsigned int hashKeyCrc32c(const char* key, size_t length) {
+    uint64_t a = 0x243F6A88u ^ length;
+    uint64_t b = 0x85A308D3u;
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        a = _mm_crc32_u64(a, read64(key + i));
+        b = _mm_crc32_u64(b, read64(key + i + 8));
+    }
+    if (i + 8 <= length) {
+        a = _mm_crc32_u64(a, read64(key + i));
+        i += 8;
+    }
+    if (i < length) {
+        b = _mm_crc32_u64(b, readPartial(key + i, length - i));
+    }
+    return (unsigned int)hashKeyUint64(a << 32 | b);
+}
+
+/**
+ * @brief Hash built on AES-NI rounds.
+ * @details Each 16-byte block is XORed into the state and goes through one AES round; two
+ *          more rounds at the end spread every input bit over the whole state. Not meant to
+ *          resist keys chosen to collide.
+ * @param key Bytes of the key.
+ * @param length Number of bytes.
+ * @return 32-bit hash.
+ */
+__attribute__((target("aes,sse4.1")))
+unsigned int hashKeyAes(const char* key, size_t length) {
+    const __m128i roundKey0 = _mm_set_epi64x(0x13198A2E03707344ll, 0x243F6A8885A308D3ll);
+    const __m128i roundKey1 = _mm_set_epi64x(0x082EFA98EC4E6C89ll, (long long)0xA4093822299F31D0ull);
+    __m128i state = _mm_xor_si128(roundKey0, _mm_set_epi64x(0, (long long)length));
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(key + i));
+        state = _mm_aesenc_si128(_mm_xor_si128(state, block), roundKey1);
+    }
+    if (i < length) {
+        size_t rest = length - i;
+        uint64_t low = rest > 8 ? read64(key + i) : readPartial(key + i, rest);
+        uint64_t high = rest > 8 ? read64(key + length - 8) : 0;
+        __m128i block = _mm_set_epi64x((long long)high, (long long)low);
+        state = _mm_aesenc_si128(_mm_xor_si128(state, block), roundKey1);
+    }
+    state = _mm_aesenc_si128(state, roundKey0);
+    state = _mm_aesenc_si128(state, roundKey1);
+    return (unsigned int)_mm_cvtsi128_si32(state);
+}
+
+#else
+
+/**
+ * @brief CRC32C hash, only available on x86-64; falls back to FNV-1a elsewhere.
+ * @param key Bytes of the key.
+ * @param length Number of bytes.
+ * @return 32-bit hash.
+ */
+unsigned int hashKeyCrc32c(const char* key, size_t length) {
+    return hashKeyFnv1a(key, length);
+}
+
+/**
+ * @brief AES-NI hash, only available on x86-64; falls back to FNV-1a elsewhere.
+ * @param key Bytes of the key.
+ * @param length Number of bytes.
+ * @return 32-bit hash.
+ */
+unsigned int hashKeyAes(const char* key, size_t length) {
+    return hashKeyFnv1a(key, length);
+}
+
+#endif
+
+/**
+ * @brief Whether the CPU can run an implementation, checked with cpuid.
+ * @param implementation Implementation to check.
+ * @return Non-zero if supported.
+ */
+int keyHashSupported(KeyHashImplementation implementation) {
+#if KEY_HASH_X86
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        ecx = 0;
+    }
+    switch (implementation) {
+    case KEY_HASH_CRC32C:
+        return (ecx & bit_SSE4_2) != 0;
+    case KEY_HASH_AES:
+        return (ecx & bit_AES) != 0 && (ecx & bit_SSE4_1) != 0;
+    default:
+        return 1;
+    }
+#else
+    return implementation == KEY_HASH_AUTO || implementation == KEY_HASH_FNV1A;
+#endif
+}
+
+/**
+ * @brief Whether the CPU has AVX2 and the OS saves the YMM registers, checked with cpuid.
+ * @return Non-zero if AVX2 code may run.
+ */
+int avx2Supported(void) {
+#if KEY_HASH_X86
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & bit_OSXSAVE) == 0 || (ecx & bit_AVX) == 0) {
+        return 0;
+    }
+    // The OS must have enabled the SSE and AVX state in XCR0
+    unsigned int xcr0Low;
+    unsigned int xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    if ((xcr0Low & 0x6) != 0x6) {
+        return 0;
+    }
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_AVX2) != 0;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Makes hashKey use an implementation.
+ * @details Every implementation gives different hashes, so this must happen before any
+ *          table is populated; startup already selects KEY_HASH_AUTO.
+ * @param implementation Implementation to use; KEY_HASH_AUTO prefers AES-NI, then CRC32C.
+ * @return 1 if selected, 0 if the CPU does not support it and nothing changed.
+ */
+int selectKeyHash(KeyHashImplementation implementation) {
+    if (implementation == KEY_HASH_AUTO) {
+        implementation = keyHashSupported(KEY_HASH_AES) ? KEY_HASH_AES
+                       : keyHashSupported(KEY_HASH_CRC32C) ? KEY_HASH_CRC32C : KEY_HASH_FNV1A;
+    }
+    if (!keyHashSupported(implementation)) {
+        return 0;
+    }
+
+    switch (implementation) {
+    case KEY_HASH_CRC32C:
+        activeHash = hashKeyCrc32c;
+        break;
+    case KEY_HASH_AES:
+        activeHash = hashKeyAes;
+        break;
+    default:
+        activeHash = hashKeyFnv1a;
+        break;
+    }
+    activeImplementation = implementation;
+    return 1;
+}
+
+/**
+ * @brief Implementation hashKey currently uses.
+ * @return Never KEY_HASH_AUTO.
+ */
+KeyHashImplementation selectedKeyHash(void) {
+    return activeImplementation;
+}
+
+/**
+ * @brief Printable name of an implementation.
+ * @param implementation Implementation.
+ * @return Static string.
+ */
+const char* keyHashName(KeyHashImplementation implementation) {
+    switch (implementation) {
+    case KEY_HASH_FNV1A:
+        return "fnv1a";
+    case KEY_HASH_CRC32C:
+        return "crc32c";
+    case KEY_HASH_AES:
+        return "aes";
+    default:
+        return "auto";
+    }
+}
+
+/**
+ * @brief Picks the hash implementation and the key probes before main runs.
+ */
+__attribute__((constructor))
+static void detectKeyHash(void) {
+    selectKeyHash(KEY_HASH_AUTO);
+    keyProbeAvx2 = avx2Supported();
+}
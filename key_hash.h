@@ -0,0 +1,66 @@
+/**
+ * @file key_hash.h
+ * @brief Key hash functions behind hashKey.
+ *        Besides the portable FNV-1a loop there are implementations built on the SSE4.2
+ *        CRC32C instruction and on AES-NI rounds. The fastest one the CPU supports is picked
+ *        once at startup through cpuid and called through a function pointer.
+ *        The same startup check tells the key probes whether they may use AVX2, so builds
+ *        without -mavx2 still run their AVX2 paths on CPUs that have it.
+ */
+
+#ifndef KEY_HASH_H
+#define KEY_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Available hash implementations. */
+typedef enum {
+    KEY_HASH_AUTO, /**< Fastest supported implementation, chosen at startup. */
+    KEY_HASH_FNV1A, /**< Portable byte-at-a-time FNV-1a. */
+    KEY_HASH_CRC32C, /**< Two CRC32C lanes over 8-byte words, then a 64-bit finalizer. Needs SSE4.2. */
+    KEY_HASH_AES, /**< One AES round per 16-byte block, then two finishing rounds. Needs AES-NI. */
+} KeyHashImplementation;
+
+/** @brief Hash of @p length bytes at @p key. */
+typedef unsigned int (*KeyHashFunction)(const char* key, size_t length);
+
+/** @brief Non-zero once startup found the CPU and the OS support AVX2; key probes branch on it. */
+extern int keyProbeAvx2;
+
+/**
+ * @brief 64-bit finalizer of MurmurHash3 (fmix64), every input bit affects every output bit.
+ * @details Hashes integer keys directly, and joins the lanes of the CRC32C hash. Inline, so
+ *          integer key tables pay a few multiplies and no call.
+ * @param x Value to mix.
+ * @return Mixed value.
+ */
+static inline uint64_t hashKeyUint64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+/*  FUNCTION DECLARATIONS   */
+unsigned int hashKeyBytes(const char* key, size_t length);
+unsigned int hashKeyFnv1a(const char* key, size_t length);
+unsigned int hashKeyCrc32c(const char* key, size_t length);
+unsigned int hashKeyAes(const char* key, size_t length);
+int keyHashSupported(KeyHashImplementation implementation);
+int avx2Supported(void);
+int selectKeyHash(KeyHashImplementation implementation);
+KeyHashImplementation selectedKeyHash(void);
+const char* keyHashName(KeyHashImplementation implementation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KEY_HASH_H */
@@ -0,0 +1,276 @@
+/**
+ * @file linear_hash_table.c
+ * @brief Implementation of the linear hashing Hash Table declared in linear_hash_table.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "linear_hash_table.h"
+#include "bucket_engine.h"
+#include "key_hash.h"
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Container with a given number.
+ * @param lt Pointer to the linear hash table.
+ * @param index Container number, below the allocated segments.
+ * @return Pointer to the container.
+ */
+static Bucket* containerAt(const LinearHashTable* lt, unsigned int index) {
+    return &lt->segments[index / LINEAR_SEGMENT_SIZE][index % LINEAR_SEGMENT_SIZE];
+}
+
+/**
+ * @brief Container a hash belongs to.
+ * @details Containers before the split pointer were already split this round and use one
+ *          more bit of the hash than the others.
+ * @param lt Pointer to the linear hash table.
+ * @param hash Full hash of the key.
+ * @return Container number.
+ */
+static unsigned int containerIndex(const LinearHashTable* lt, unsigned int hash) {
+    unsigned int index = hash & (lt->roundBuckets - 1);
+    if (index < lt->split) {
+        index = hash & (2 * lt->roundBuckets - 1);
+    }
+    return index;
+}
+
+/**
+ * @brief Allocates the segment holding a container if it does not exist yet.
+ * @param lt Pointer to the linear hash table.
+ * @param index Container number, at most one past the allocated segments.
+ */
+static void ensureSegment(LinearHashTable* lt, unsigned int index) {
+    int segment = (int)(index / LINEAR_SEGMENT_SIZE);
+    if (segment < lt->segmentCount) {
+        return;
+    }
+
+    // The directory holds only pointers, so growing it copies little
+    if (lt->segmentCount == lt->directorySlots) {
+        int slots = lt->directorySlots == 0 ? 8 : lt->directorySlots * 2;
+        Bucket** segments = (Bucket**)realloc(lt->segments, sizeof(Bucket*) * slots);
+        if (segments == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        lt->segments = segments;
+        lt->directorySlots = slots;
+    }
+    // Left uninitialized, each container is cleared when a split first reaches it, so the
+    // page faults of a new segment are spread over many insertions instead of one
+    lt->segments[lt->segmentCount] = (Bucket*)malloc(sizeof(Bucket) * LINEAR_SEGMENT_SIZE);
+    if (lt->segments[lt->segmentCount] == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    lt->segmentCount++;
+}
+
+/** @brief Container functions: appendToContainer, removeFromContainer, releaseContainer, findInContainer. */
+DEFINE_STRING_BUCKET_ENGINE(Container, BUCKET_INITIAL_SLOTS)
+
+/**
+ * @brief Splits the container at the split pointer, adding one container to the table.
+ * @details Pairs whose next hash bit is set move to the new container roundBuckets further on.
+ * @param lt Pointer to the linear hash table.
+ */
+static void splitContainer(LinearHashTable* lt) {
+    unsigned int target = lt->split + lt->roundBuckets;
+    ensureSegment(lt, target);
+    Bucket* from = containerAt(lt, lt->split);
+    Bucket* to = containerAt(lt, target);
+    memset(to, 0, sizeof(*to));
+
+    int kept = 0;
+    for (int i = 0; i < from->count; ++i) {
+        if (from->hashes[i] & lt->roundBuckets) {
+            lt->entryBytes += appendToContainer(to, from->keys[i], from->values[i], from->hashes[i], from->lengths[i]);
+        } else {
+            from->keys[kept] = from->keys[i];
+            from->values[kept] = from->values[i];
+            from->hashes[kept] = from->hashes[i];
+            from->lengths[kept] = from->lengths[i];
+            kept++;
+        }
+    }
+    from->count = kept;
+    if (kept == 0) {
+        lt->entryBytes -= releaseContainer(from);
+    }
+
+    // Start the next round once every container of this one has been split
+    lt->bucketCount++;
+    if (++lt->split == lt->roundBuckets) {
+        lt->roundBuckets *= 2;
+        lt->split = 0;
+    }
+}
+
+/**
+ * @brief Merges the last container back into its split partner, removing it from the table.
+ * @param lt Pointer to the linear hash table.
+ */
+static void mergeContainer(LinearHashTable* lt) {
+    if (lt->split == 0) {
+        lt->roundBuckets /= 2;
+        lt->split = lt->roundBuckets;
+    }
+    lt->split--;
+    lt->bucketCount--;
+
+    unsigned int source = lt->split + lt->roundBuckets;
+    Bucket* from = containerAt(lt, source);
+    Bucket* to = containerAt(lt, lt->split);
+    for (int i = 0; i < from->count; ++i) {
+        lt->entryBytes += appendToContainer(to, from->keys[i], from->values[i], from->hashes[i], from->lengths[i]);
+    }
+    lt->entryBytes -= releaseContainer(from);
+
+    // Drop the last segment once no container in it is in use
+    if (source % LINEAR_SEGMENT_SIZE == 0) {
+        free(lt->segments[--lt->segmentCount]);
+    }
+}
+
+/**
+ * @brief Records the memory high-water mark.
+ * @param lt Pointer to the linear hash table.
+ */
+static void updatePeakBytes(LinearHashTable* lt) {
+    size_t bytes = linearHashTableMemoryBytes(lt);
+    if (bytes > lt->peakBytes) {
+        lt->peakBytes = bytes;
+    }
+}
+
+/**
+ * @brief Initializes a linear hash table.
+ * @param lt Pointer to the linear hash table to be initialized.
+ * @param capacity Initial number of containers, rounded up to a power of two.
+ */
+void initLinearHashTable(LinearHashTable* lt, int capacity) {
+    unsigned int buckets = 1;
+    while (buckets < (unsigned int)capacity) {
+        buckets *= 2;
+    }
+    lt->segments = NULL;
+    lt->segmentCount = 0;
+    lt->directorySlots = 0;
+    lt->initialBuckets = buckets;
+    lt->roundBuckets = buckets;
+    lt->split = 0;
+    lt->bucketCount = buckets;
+    lt->size = 0;
+    lt->entryBytes = 0;
+    lt->stringBytes = 0;
+    lt->peakBytes = 0;
+    for (unsigned int index = 0; index < buckets; index += LINEAR_SEGMENT_SIZE) {
+        ensureSegment(lt, index);
+    }
+    for (unsigned int index = 0; index < buckets; ++index) {
+        memset(containerAt(lt, index), 0, sizeof(Bucket));
+    }
+    updatePeakBytes(lt);
+}
+
+/**
+ * @brief Inserts a key-value pair, splitting one container when the load factor is exceeded.
+ * @param lt Pointer to the linear hash table.
+ * @param key Key of the pair.
+ * @param value Value associated with the key.
+ */
+void insertLinearKeyValPair(LinearHashTable* lt, const char* key, const char* value) {
+    size_t length = strlen(key);
+    unsigned int hash = hashKeyBytes(key, length);
+    char* ownedKey = strdup(key);
+    char* ownedValue = strdup(value);
+    if (ownedKey == NULL || ownedValue == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    lt->entryBytes += appendToContainer(containerAt(lt, containerIndex(lt, hash)), ownedKey, ownedValue, hash, (unsigned int)length);
+    lt->stringBytes += length + 1 + strlen(value) + 1;
+    lt->size++;
+
+    // Grow by exactly one container per insertion past the threshold
+    if ((double)lt->size / lt->bucketCount > LOAD_FACTOR_THRESHOLD) {
+        splitContainer(lt);
+    }
+    updatePeakBytes(lt);
+}
+
+/**
+ * @brief Removes a key-value pair, merging one container when the table gets sparse.
+ * @param lt Pointer to the linear hash table.
+ * @param key Key of the pair to be removed.
+ */
+void removeLinearKeyValPair(LinearHashTable* lt, const char* key) {
+    size_t length = strlen(key);
+    unsigned int hash = hashKeyBytes(key, length);
+    Bucket* bucket = containerAt(lt, containerIndex(lt, hash));
+    int slot = findInContainer(bucket, hash, key, length);
+    if (slot < 0) {
+        return;
+    }
+
+    // Free memory for the removed pair and close the hole, keeping the insertion order
+    lt->stringBytes -= length + 1 + strlen(bucket->values[slot]) + 1;
+    free(bucket->keys[slot]);
+    free(bucket->values[slot]);
+    removeFromContainer(bucket, slot);
+    if (bucket->count == 0) {
+        lt->entryBytes -= releaseContainer(bucket);
+    }
+    lt->size--;
+
+    if ((double)lt->size / lt->bucketCount < SHRINK_LOAD_FACTOR && lt->bucketCount > lt->initialBuckets) {
+        mergeContainer(lt);
+    }
+}
+
+/**
+ * @brief Looks up the value associated with a given key.
+ * @param lt Pointer to the linear hash table.
+ * @param key Key to look up.
+ * @return Value associated with the key, or NULL if not found.
+ */
+const char* lookup_linearHashTable(const LinearHashTable* lt, const char* key) {
+    size_t length = strlen(key);
+    unsigned int hash = hashKeyBytes(key, length);
+    const Bucket* bucket = containerAt(lt, containerIndex(lt, hash));
+    int slot = findInContainer(bucket, hash, key, length);
+    return slot >= 0 ? bucket->values[slot] : NULL;
+}
+
+/**
+ * @brief Every byte the table allocated: directory, segments, container arrays and strings.
+ * @param lt Pointer to the linear hash table.
+ * @return Number of bytes.
+ */
+size_t linearHashTableMemoryBytes(const LinearHashTable* lt) {
+    return sizeof(Bucket*) * lt->directorySlots + sizeof(Bucket) * LINEAR_SEGMENT_SIZE * lt->segmentCount +
+           lt->entryBytes + lt->stringBytes;
+}
+
+/**
+ * @brief Frees the memory allocated for the table and its pairs.
+ * @param lt Pointer to the linear hash table to be freed.
+ */
+void freeLinearHashTable(LinearHashTable* lt) {
+    for (unsigned int i = 0; i < lt->bucketCount; ++i) {
+        Bucket* bucket = containerAt(lt, i);
+        for (int j = 0; j < bucket->count; ++j) {
+            free(bucket->keys[j]);
+            free(bucket->values[j]);
+        }
+        releaseContainer(bucket);
+    }
+    for (int i = 0; i < lt->segmentCount; ++i) {
+        free(lt->segments[i]);
+    }
+    free(lt->segments);
+}
@@ -0,0 +1,50 @@
+/**
+ * @file linear_hash_table.h
+ * @brief Hash Table growing by linear hashing.
+ *        Instead of doubling the whole array at once, each insertion past the load factor
+ *        threshold splits a single container, so the cost of growth is spread evenly over
+ *        the insertions. Containers live in fixed-size segments reached through a small
+ *        directory, so growing never reallocates or copies the containers themselves.
+ */
+
+#ifndef LINEAR_HASH_TABLE_H
+#define LINEAR_HASH_TABLE_H
+
+#include <stddef.h>
+#include "hash_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Containers per directory segment, a power of two. */
+#define LINEAR_SEGMENT_SIZE 1024
+
+/** @brief Structure representing the linear hashing Hash Table. */
+typedef struct {
+    Bucket** segments; /**< Directory of segments of LINEAR_SEGMENT_SIZE containers each. */
+    int segmentCount; /**< Number of allocated segments. */
+    int directorySlots; /**< Capacity of the directory. */
+    unsigned int initialBuckets; /**< Containers the table never shrinks below, a power of two. */
+    unsigned int roundBuckets; /**< Containers at the start of the current round, a power of two. */
+    unsigned int split; /**< Next container to split in the current round. */
+    unsigned int bucketCount; /**< roundBuckets + split. */
+    int size; /**< Number of key-value pairs. */
+    size_t entryBytes; /**< Bytes allocated for the per-container pair arrays. */
+    size_t stringBytes; /**< Bytes allocated for the duplicated keys and values. */
+    size_t peakBytes; /**< Highest value linearHashTableMemoryBytes reached. */
+} LinearHashTable;
+
+/*  FUNCTION DECLARATIONS   */
+void initLinearHashTable(LinearHashTable* lt, int capacity);
+void insertLinearKeyValPair(LinearHashTable* lt, const char* key, const char* value);
+void removeLinearKeyValPair(LinearHashTable* lt, const char* key);
+const char* lookup_linearHashTable(const LinearHashTable* lt, const char* key);
+size_t linearHashTableMemoryBytes(const LinearHashTable* lt);
+void freeLinearHashTable(LinearHashTable* lt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LINEAR_HASH_TABLE_H */
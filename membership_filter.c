@@ -0,0 +1,206 @@
+/**
+ * @file membership_filter.c
+ * @brief Implementation of the blocked counting Bloom filter declared in membership_filter.h.
+ *        The filter works from the 32-bit key hash the table already stores, so it can be
+ *        rebuilt on resize without touching the key strings.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "membership_filter.h"
+
+/** @brief Largest value of a 4-bit counter; saturated counters are never decremented. */
+#define FILTER_COUNTER_MAX 15
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Spreads a 32-bit key hash over 64 bits.
+ * @details The block comes from the high half and the counter positions from the low half,
+ *          so neither correlates with the container index (hash % capacity).
+ * @param hash Key hash.
+ * @return Mixed value.
+ */
+static uint64_t mixHash(unsigned int hash) {
+    uint64_t x = (uint64_t)hash * 0x9E3779B97F4A7C15ull;
+    x ^= x >> 29;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 32;
+    return x;
+}
+
+/**
+ * @brief Block holding the counters of a key.
+ * @param filter Pointer to the filter.
+ * @param mixed Mixed key hash.
+ * @return Pointer to the first byte of the block.
+ */
+static unsigned char* blockFor(const MembershipFilter* filter, uint64_t mixed) {
+    size_t block = (size_t)(((mixed >> 32) * (uint64_t)filter->blockCount) >> 32);
+    return filter->blocks + block * FILTER_BLOCK_BYTES;
+}
+
+/**
+ * @brief Position of the i-th counter of a key inside its block.
+ * @details Each probe takes its own 7 bits of a second mix, independent positions keep the
+ *          rate close to the model where double hashing inside a 128-counter block did not.
+ * @param mixed Mixed key hash.
+ * @param i Probe number, below FILTER_MAX_PROBES.
+ * @return Counter index in the block.
+ */
+static unsigned int counterIndex(uint64_t mixed, int i) {
+    uint64_t probeBits = mixed * 0xD6E8FEB86659FD93ull;
+    return (unsigned int)(probeBits >> (64 - 7 * (i + 1))) % FILTER_BLOCK_COUNTERS;
+}
+
+/**
+ * @brief Reads a 4-bit counter.
+ * @param block Pointer to the block.
+ * @param index Counter index.
+ * @return Counter value.
+ */
+static unsigned int readCounter(const unsigned char* block, unsigned int index) {
+    return (block[index / 2] >> (4 * (index % 2))) & 0xF;
+}
+
+/**
+ * @brief Writes a 4-bit counter.
+ * @param block Pointer to the block.
+ * @param index Counter index.
+ * @param value New counter value.
+ */
+static void writeCounter(unsigned char* block, unsigned int index, unsigned int value) {
+    unsigned int shift = 4 * (index % 2);
+    block[index / 2] = (unsigned char)((block[index / 2] & ~(0xF << shift)) | (value << shift));
+}
+
+/**
+ * @brief False positive rate of a blocked filter.
+ * @details Keys per block follow a Poisson distribution, and a crowded block answers "maybe"
+ *          far more often than an average one, so the rate is averaged over block loads.
+ * @param countersPerKey Counters allocated per key.
+ * @param probes Counters set per key.
+ * @return Expected false positive rate.
+ */
+static double blockedFalsePositiveRate(double countersPerKey, int probes) {
+    double meanLoad = FILTER_BLOCK_COUNTERS / countersPerKey;
+    double probability = exp(-meanLoad);
+    double rate = 0.0;
+
+    for (int load = 0; load < 8 * FILTER_BLOCK_COUNTERS; ++load) {
+        double setFraction = 1.0 - pow(1.0 - 1.0 / FILTER_BLOCK_COUNTERS, (double)probes * load);
+        rate += probability * pow(setFraction, probes);
+        probability *= meanLoad / (load + 1);
+    }
+    return rate;
+}
+
+/**
+ * @brief Sizes and clears a filter.
+ * @details Picks the fewest counters per key, in steps of 1/4, whose blocked false positive
+ *          rate meets the target with about ln 2 probes per counter per key.
+ * @param filter Pointer to the filter to initialize.
+ * @param expectedKeys Number of keys the filter should hold at the target rate.
+ * @param falsePositiveRate Target false positive rate, between 0 and 1.
+ */
+void initMembershipFilter(MembershipFilter* filter, size_t expectedKeys, double falsePositiveRate) {
+    double countersPerKey = 1.0;
+    int probes = 1;
+
+    for (; countersPerKey < FILTER_BLOCK_COUNTERS; countersPerKey += 0.25) {
+        probes = (int)lround(countersPerKey * M_LN2);
+        probes = probes < 1 ? 1 : probes > FILTER_MAX_PROBES ? FILTER_MAX_PROBES : probes;
+        if (blockedFalsePositiveRate(countersPerKey, probes) <= falsePositiveRate) {
+            break;
+        }
+    }
+    size_t counters = (size_t)ceil(countersPerKey * (double)(expectedKeys > 0 ? expectedKeys : 1));
+
+    filter->probes = probes;
+    filter->blockCount = (counters + FILTER_BLOCK_COUNTERS - 1) / FILTER_BLOCK_COUNTERS;
+    filter->expectedKeys = expectedKeys;
+    filter->falsePositiveRate = falsePositiveRate;
+    filter->blocks = (unsigned char*)aligned_alloc(FILTER_BLOCK_BYTES, filter->blockCount * FILTER_BLOCK_BYTES);
+    if (filter->blocks == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    memset(filter->blocks, 0, filter->blockCount * FILTER_BLOCK_BYTES);
+}
+
+/**
+ * @brief Adds a key to the filter.
+ * @param filter Pointer to the filter.
+ * @param hash Key hash.
+ */
+void addMembershipFilter(MembershipFilter* filter, unsigned int hash) {
+    uint64_t mixed = mixHash(hash);
+    unsigned char* block = blockFor(filter, mixed);
+
+    for (int i = 0; i < filter->probes; ++i) {
+        unsigned int index = counterIndex(mixed, i);
+        unsigned int value = readCounter(block, index);
+        if (value < FILTER_COUNTER_MAX) {
+            writeCounter(block, index, value + 1);
+        }
+    }
+}
+
+/**
+ * @brief Removes a key that was added before.
+ * @param filter Pointer to the filter.
+ * @param hash Key hash.
+ */
+void removeMembershipFilter(MembershipFilter* filter, unsigned int hash) {
+    uint64_t mixed = mixHash(hash);
+    unsigned char* block = blockFor(filter, mixed);
+
+    for (int i = 0; i < filter->probes; ++i) {
+        unsigned int index = counterIndex(mixed, i);
+        unsigned int value = readCounter(block, index);
+        // Saturated counters may stand for more keys than they can count
+        if (value > 0 && value < FILTER_COUNTER_MAX) {
+            writeCounter(block, index, value - 1);
+        }
+    }
+}
+
+/**
+ * @brief Whether a key may be present.
+ * @param filter Pointer to the filter.
+ * @param hash Key hash.
+ * @return 0 if the key is definitely absent, 1 if it may be present.
+ */
+int mayContainMembershipFilter(const MembershipFilter* filter, unsigned int hash) {
+    uint64_t mixed = mixHash(hash);
+    const unsigned char* block = blockFor(filter, mixed);
+
+    for (int i = 0; i < filter->probes; ++i) {
+        if (readCounter(block, counterIndex(mixed, i)) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Memory used by the counters.
+ * @param filter Pointer to the filter.
+ * @return Number of bytes.
+ */
+size_t membershipFilterBytes(const MembershipFilter* filter) {
+    return filter->blockCount * FILTER_BLOCK_BYTES;
+}
+
+/**
+ * @brief Frees the counters of the filter.
+ * @param filter Pointer to the filter.
+ */
+void freeMembershipFilter(MembershipFilter* filter) {
+    free(filter->blocks);
+    filter->blocks = NULL;
+    filter->blockCount = 0;
+}
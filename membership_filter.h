@@ -0,0 +1,46 @@
+/**
+ * @file membership_filter.h
+ * @brief Blocked counting Bloom filter answering "definitely absent" for most missing keys.
+ *        Each key touches one cache-line sized block of 4-bit counters, so a query costs a
+ *        single cache miss; counters make removals possible. A counter that saturates is
+ *        never decremented again, which keeps the filter free of false negatives.
+ */
+
+#ifndef MEMBERSHIP_FILTER_H
+#define MEMBERSHIP_FILTER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Bytes per filter block, one cache line. */
+#define FILTER_BLOCK_BYTES 64
+/** @brief 4-bit counters per filter block. */
+#define FILTER_BLOCK_COUNTERS (2 * FILTER_BLOCK_BYTES)
+/** @brief Upper bound on the counters set per key. */
+#define FILTER_MAX_PROBES 8
+
+/** @brief Structure representing the membership filter. */
+typedef struct {
+    unsigned char* blocks; /**< Counter blocks, two counters per byte. */
+    size_t blockCount; /**< Number of blocks. */
+    int probes; /**< Counters set per key. */
+    size_t expectedKeys; /**< Number of keys the filter was sized for. */
+    double falsePositiveRate; /**< Target false positive rate at expectedKeys. */
+} MembershipFilter;
+
+/*  FUNCTION DECLARATIONS   */
+void initMembershipFilter(MembershipFilter* filter, size_t expectedKeys, double falsePositiveRate);
+void addMembershipFilter(MembershipFilter* filter, unsigned int hash);
+void removeMembershipFilter(MembershipFilter* filter, unsigned int hash);
+int mayContainMembershipFilter(const MembershipFilter* filter, unsigned int hash);
+size_t membershipFilterBytes(const MembershipFilter* filter);
+void freeMembershipFilter(MembershipFilter* filter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMBERSHIP_FILTER_H */
@@ -0,0 +1,455 @@
+/**
+ * @file mvcc_hash_table.c
+ * @brief Implementation of the versioned Hash Table declared in mvcc_hash_table.h.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mvcc_hash_table.h"
+
+/** @brief Read view opened by openMvccSnapshot. */
+struct MvccSnapshot {
+    uint64_t readTs; /**< Versions committed at or before this timestamp are visible. */
+    uint64_t floorTs; /**< Timestamp published to writers, at most readTs. */
+    MvccSnapshot* newer; /**< Next snapshot opened, NULL for the newest. */
+    MvccSnapshot* older; /**< Previous snapshot opened, NULL for the oldest. */
+};
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Allocates memory, exiting on failure.
+ * @param bytes Number of bytes.
+ * @return The allocation.
+ */
+static void* allocateOrExit(size_t bytes) {
+    void* memory = malloc(bytes);
+    if (memory == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+/**
+ * @brief Duplicates a string, exiting on failure.
+ * @param text String to copy.
+ * @return Heap copy of @p text.
+ */
+static char* copyString(const char* text) {
+    size_t length = strlen(text) + 1;
+    char* copy = (char*)allocateOrExit(length);
+    memcpy(copy, text, length);
+    return copy;
+}
+
+/**
+ * @brief Shard a key belongs to.
+ * @details Like shardIndex, the hash is multiplied by a Fibonacci constant and the high bits
+ *          are kept, so the shard does not correlate with the container (hash % capacity).
+ * @param mt Pointer to the versioned hash table.
+ * @param hash hashKey of the key.
+ * @return Pointer to the shard.
+ */
+static MvccShard* shardOf(const MvccHashTable* mt, unsigned int hash) {
+    unsigned int mixed = hash * 2654435769u;
+    return &mt->shards[((unsigned long long)mixed * (unsigned int)mt->shardCount) >> 32];
+}
+
+/**
+ * @brief Finds the link that leads to the entry of a key in a shard.
+ * @param shard Shard holding the key, locked by the caller.
+ * @param key Key to find.
+ * @param hash hashKey of the key.
+ * @return Link pointing at the entry, or at NULL when the key is absent.
+ */
+static MvccEntry** findEntry(const MvccShard* shard, const char* key, unsigned int hash) {
+    MvccEntry** link = &shard->buckets[hash % (unsigned int)shard->capacity];
+    while (*link != NULL && ((*link)->hash != hash || strcmp((*link)->key, key) != 0)) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+/**
+ * @brief Doubles the containers of a shard and relinks its entries.
+ * @param shard Shard to grow, locked exclusively by the caller.
+ */
+static void growShard(MvccShard* shard) {
+    int capacity = shard->capacity * 2;
+    MvccEntry** buckets = (MvccEntry**)calloc((size_t)capacity, sizeof(MvccEntry*));
+    if (buckets == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    // Entries keep their stored hash, so no key is hashed again
+    for (int i = 0; i < shard->capacity; ++i) {
+        MvccEntry* entry = shard->buckets[i];
+        while (entry != NULL) {
+            MvccEntry* next = entry->next;
+            MvccEntry** head = &buckets[entry->hash % (unsigned int)capacity];
+            entry->next = *head;
+            *head = entry;
+            entry = next;
+        }
+    }
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->capacity = capacity;
+}
+
+/**
+ * @brief Oldest timestamp a snapshot open now or opened later may read at.
+ * @details Called with the shard locked exclusively. The clock is read with an atomic
+ *          read-modify-write before the published floor is loaded, while openMvccSnapshot
+ *          publishes its floor before reading the clock for itself. So either this sees the
+ *          floor of a concurrent snapshot, or that snapshot reads at @p clock or later.
+ * @param mt Pointer to the versioned hash table.
+ * @param clock Timestamp obtained with a read-modify-write of the clock.
+ * @return Timestamp whose visible versions must be kept, with every newer one.
+ */
+static uint64_t collectionHorizon(MvccHashTable* mt, uint64_t clock) {
+    uint64_t floor = __atomic_load_n(&mt->oldestFloor, __ATOMIC_SEQ_CST);
+    return floor < clock ? floor : clock;
+}
+
+/**
+ * @brief Frees the versions of an entry that no snapshot can see.
+ * @details The newest version committed at or before @p horizon is what the oldest snapshot
+ *          sees; every version behind it is unreachable.
+ * @param shard Shard of the entry, locked exclusively by the caller.
+ * @param entry Entry to trim.
+ * @param horizon Result of collectionHorizon.
+ * @return Number of versions freed.
+ */
+static long pruneVersions(MvccShard* shard, MvccEntry* entry, uint64_t horizon) {
+    MvccVersion* visible = entry->newest;
+    while (visible != NULL && visible->commitTs > horizon) {
+        visible = visible->older;
+    }
+    if (visible == NULL) {
+        return 0;
+    }
+
+    long freed = 0;
+    MvccVersion* version = visible->older;
+    visible->older = NULL;
+    while (version != NULL) {
+        MvccVersion* older = version->older;
+        free(version->value);
+        free(version);
+        version = older;
+        freed++;
+    }
+    shard->versions -= freed;
+    return freed;
+}
+
+/**
+ * @brief Trims the versions of an entry and unlinks it once only an invisible removal is left.
+ * @param shard Shard of the entry, locked exclusively by the caller.
+ * @param link Pointer to the link that leads to the entry.
+ * @param horizon Result of collectionHorizon.
+ * @return Number of versions freed.
+ */
+static long collectEntry(MvccShard* shard, MvccEntry** link, uint64_t horizon) {
+    MvccEntry* entry = *link;
+    long freed = pruneVersions(shard, entry, horizon);
+
+    // A removal every snapshot sees makes the key indistinguishable from an absent one
+    MvccVersion* newest = entry->newest;
+    if (newest->value == NULL && newest->older == NULL && newest->commitTs <= horizon) {
+        *link = entry->next;
+        free(newest);
+        free(entry->key);
+        free(entry);
+        shard->versions--;
+        shard->size--;
+        freed++;
+    }
+    return freed;
+}
+
+/**
+ * @brief Commits a new version of a key.
+ * @details The timestamp is taken while the shard is locked exclusively, so a snapshot that
+ *          reads at it or later waits on the shard lock until the version is linked.
+ * @param mt Pointer to the versioned hash table.
+ * @param key Key of the version.
+ * @param value Value, NULL to record a removal.
+ * @return Commit timestamp, 0 if the removed key did not exist.
+ */
+static uint64_t commitVersion(MvccHashTable* mt, const char* key, const char* value) {
+    unsigned int hash = hashKey(key);
+    MvccShard* shard = shardOf(mt, hash);
+
+    pthread_rwlock_wrlock(&shard->lock);
+    MvccEntry** link = findEntry(shard, key, hash);
+    MvccEntry* entry = *link;
+    if (value == NULL && (entry == NULL || entry->newest->value == NULL)) {
+        pthread_rwlock_unlock(&shard->lock);
+        return 0;
+    }
+    if (entry == NULL) {
+        if (shard->size + 1 > shard->capacity * LOAD_FACTOR_THRESHOLD) {
+            growShard(shard);
+        }
+        entry = (MvccEntry*)allocateOrExit(sizeof(MvccEntry));
+        link = &shard->buckets[hash % (unsigned int)shard->capacity];
+        *entry = (MvccEntry){ copyString(key), hash, NULL, *link };
+        *link = entry;
+        shard->size++;
+    }
+
+    MvccVersion* version = (MvccVersion*)allocateOrExit(sizeof(MvccVersion));
+    version->value = value != NULL ? copyString(value) : NULL;
+    version->older = entry->newest;
+    version->commitTs = __atomic_add_fetch(&mt->commitClock, 1, __ATOMIC_SEQ_CST);
+    entry->newest = version;
+    shard->versions++;
+
+    // Versions of this key that became invisible go right away, the key too once removed for all
+    uint64_t commitTs = version->commitTs;
+    long freed = collectEntry(shard, link, collectionHorizon(mt, commitTs));
+    pthread_rwlock_unlock(&shard->lock);
+    if (freed > 0) {
+        __atomic_fetch_add(&mt->reclaimedVersions, (unsigned long)freed, __ATOMIC_RELAXED);
+    }
+    return commitTs;
+}
+
+/**
+ * @brief Initializes a versioned hash table.
+ * @param mt Pointer to the versioned hash table to be initialized.
+ * @param shardCount Number of independently locked shards.
+ * @param capacity Initial number of containers of each shard.
+ */
+void initMvccHashTable(MvccHashTable* mt, int shardCount, int capacity) {
+    // Readers come back for every key of a snapshot; preferring writers keeps them from
+    // holding updates back indefinitely
+    pthread_rwlockattr_t lockKind;
+    pthread_rwlockattr_init(&lockKind);
+    pthread_rwlockattr_setkind_np(&lockKind, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+
+    mt->shardCount = shardCount > 0 ? shardCount : 1;
+    mt->shards = (MvccShard*)allocateOrExit(sizeof(MvccShard) * mt->shardCount);
+    for (int i = 0; i < mt->shardCount; ++i) {
+        MvccShard* shard = &mt->shards[i];
+        shard->capacity = capacity > 0 ? capacity : INITIAL_CAPACITY;
+        shard->buckets = (MvccEntry**)calloc((size_t)shard->capacity, sizeof(MvccEntry*));
+        if (shard->buckets == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        shard->size = 0;
+        shard->versions = 0;
+        if (pthread_rwlock_init(&shard->lock, &lockKind) != 0) {
+            perror("Error in pthread_rwlock_init");
+            exit(EXIT_FAILURE);
+        }
+    }
+    pthread_rwlockattr_destroy(&lockKind);
+    mt->commitClock = 0;
+    mt->oldestFloor = UINT64_MAX;
+    mt->oldestSnapshot = NULL;
+    mt->newestSnapshot = NULL;
+    if (pthread_mutex_init(&mt->snapshotLock, NULL) != 0) {
+        perror("Error in pthread_mutex_init");
+        exit(EXIT_FAILURE);
+    }
+    mt->reclaimedVersions = 0;
+}
+
+/**
+ * @brief Commits a new value for a key.
+ * @param mt Pointer to the versioned hash table.
+ * @param key Key of the pair.
+ * @param value Value associated with the key.
+ * @return Commit timestamp of the new version.
+ */
+uint64_t insertMvccKeyValPair(MvccHashTable* mt, const char* key, const char* value) {
+    return commitVersion(mt, key, value);
+}
+
+/**
+ * @brief Commits the removal of a key.
+ * @details Snapshots opened earlier keep seeing the last value.
+ * @param mt Pointer to the versioned hash table.
+ * @param key Key of the pair to be removed.
+ * @return Commit timestamp of the removal, 0 if the key was absent.
+ */
+uint64_t removeMvccKeyValPair(MvccHashTable* mt, const char* key) {
+    return commitVersion(mt, key, NULL);
+}
+
+/**
+ * @brief Opens a read view of everything committed so far.
+ * @details The floor is published before the read timestamp is taken, see collectionHorizon.
+ *          Snapshots are listed in opening order, so the oldest floor is always at the front.
+ * @param mt Pointer to the versioned hash table.
+ * @return Snapshot, closed with closeMvccSnapshot.
+ */
+MvccSnapshot* openMvccSnapshot(MvccHashTable* mt) {
+    MvccSnapshot* snapshot = (MvccSnapshot*)allocateOrExit(sizeof(MvccSnapshot));
+
+    pthread_mutex_lock(&mt->snapshotLock);
+    snapshot->floorTs = __atomic_load_n(&mt->commitClock, __ATOMIC_SEQ_CST);
+    snapshot->newer = NULL;
+    snapshot->older = mt->newestSnapshot;
+    if (mt->newestSnapshot != NULL) {
+        mt->newestSnapshot->newer = snapshot;
+    } else {
+        mt->oldestSnapshot = snapshot;
+    }
+    mt->newestSnapshot = snapshot;
+    __atomic_store_n(&mt->oldestFloor, mt->oldestSnapshot->floorTs, __ATOMIC_SEQ_CST);
+    snapshot->readTs = __atomic_load_n(&mt->commitClock, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&mt->snapshotLock);
+    return snapshot;
+}
+
+/**
+ * @brief Timestamp a snapshot reads at.
+ * @param snapshot Open snapshot.
+ * @return Versions committed at or before this timestamp are visible.
+ */
+uint64_t mvccSnapshotTimestamp(const MvccSnapshot* snapshot) {
+    return snapshot->readTs;
+}
+
+/**
+ * @brief Closes a snapshot, letting the versions only it could see be collected.
+ * @param mt Pointer to the versioned hash table.
+ * @param snapshot Snapshot returned by openMvccSnapshot.
+ */
+void closeMvccSnapshot(MvccHashTable* mt, MvccSnapshot* snapshot) {
+    pthread_mutex_lock(&mt->snapshotLock);
+    if (snapshot->older != NULL) {
+        snapshot->older->newer = snapshot->newer;
+    } else {
+        mt->oldestSnapshot = snapshot->newer;
+    }
+    if (snapshot->newer != NULL) {
+        snapshot->newer->older = snapshot->older;
+    } else {
+        mt->newestSnapshot = snapshot->older;
+    }
+    __atomic_store_n(&mt->oldestFloor, mt->oldestSnapshot != NULL ? mt->oldestSnapshot->floorTs : UINT64_MAX,
+                     __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&mt->snapshotLock);
+    free(snapshot);
+}
+
+/**
+ * @brief Looks up a key as of a snapshot.
+ * @details The value is copied while the shard is locked, since an update may free the
+ *          version as soon as the lock is released.
+ * @param mt Pointer to the versioned hash table.
+ * @param snapshot Snapshot to read from, NULL for the latest committed value.
+ * @param key Key to look up.
+ * @param buffer Buffer receiving the value, always terminated when not empty.
+ * @param bufferSize Size of the buffer, longer values are truncated.
+ * @return Length of the whole value, or -1 if the key was not found.
+ */
+int lookup_mvccHashTable(MvccHashTable* mt, const MvccSnapshot* snapshot, const char* key, char* buffer, size_t bufferSize) {
+    unsigned int hash = hashKey(key);
+    MvccShard* shard = shardOf(mt, hash);
+    int length = -1;
+
+    pthread_rwlock_rdlock(&shard->lock);
+    MvccEntry* entry = *findEntry(shard, key, hash);
+    MvccVersion* version = entry != NULL ? entry->newest : NULL;
+    while (snapshot != NULL && version != NULL && version->commitTs > snapshot->readTs) {
+        version = version->older;
+    }
+    if (version != NULL && version->value != NULL) {
+        length = snprintf(buffer, bufferSize, "%s", version->value);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    return length;
+}
+
+/**
+ * @brief Frees every version no open snapshot can see, and the keys removed for all of them.
+ * @details Updates already trim the key they write; this reaches keys that were not written
+ *          again since a long snapshot closed. Shards are locked one at a time.
+ * @param mt Pointer to the versioned hash table.
+ * @return Number of versions freed.
+ */
+long collectMvccGarbage(MvccHashTable* mt) {
+    long freed = 0;
+
+    for (int i = 0; i < mt->shardCount; ++i) {
+        MvccShard* shard = &mt->shards[i];
+        pthread_rwlock_wrlock(&shard->lock);
+        uint64_t horizon = collectionHorizon(mt, __atomic_fetch_add(&mt->commitClock, 0, __ATOMIC_SEQ_CST));
+        for (int b = 0; b < shard->capacity; ++b) {
+            MvccEntry** link = &shard->buckets[b];
+            while (*link != NULL) {
+                MvccEntry* entry = *link;
+                freed += collectEntry(shard, link, horizon);
+                if (*link == entry) {
+                    link = &entry->next;
+                }
+            }
+        }
+        pthread_rwlock_unlock(&shard->lock);
+    }
+    __atomic_fetch_add(&mt->reclaimedVersions, (unsigned long)freed, __ATOMIC_RELAXED);
+    return freed;
+}
+
+/**
+ * @brief Number of versions the table keeps, removals included.
+ * @param mt Pointer to the versioned hash table.
+ * @return Sum over the shards.
+ */
+long mvccVersionCount(MvccHashTable* mt) {
+    long versions = 0;
+
+    for (int i = 0; i < mt->shardCount; ++i) {
+        pthread_rwlock_rdlock(&mt->shards[i].lock);
+        versions += mt->shards[i].versions;
+        pthread_rwlock_unlock(&mt->shards[i].lock);
+    }
+    return versions;
+}
+
+/**
+ * @brief Frees the shards, their keys and versions, and any snapshot left open.
+ * @param mt Pointer to the versioned hash table to be freed.
+ */
+void freeMvccHashTable(MvccHashTable* mt) {
+    for (int i = 0; i < mt->shardCount; ++i) {
+        MvccShard* shard = &mt->shards[i];
+        for (int b = 0; b < shard->capacity; ++b) {
+            MvccEntry* entry = shard->buckets[b];
+            while (entry != NULL) {
+                MvccEntry* next = entry->next;
+                MvccVersion* version = entry->newest;
+                while (version != NULL) {
+                    MvccVersion* older = version->older;
+                    free(version->value);
+                    free(version);
+                    version = older;
+                }
+                free(entry->key);
+                free(entry);
+                entry = next;
+            }
+        }
+        free(shard->buckets);
+        pthread_rwlock_destroy(&shard->lock);
+    }
+    free(mt->shards);
+
+    while (mt->oldestSnapshot != NULL) {
+        MvccSnapshot* newer = mt->oldestSnapshot->newer;
+        free(mt->oldestSnapshot);
+        mt->oldestSnapshot = newer;
+    }
+    pthread_mutex_destroy(&mt->snapshotLock);
+}
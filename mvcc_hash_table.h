@@ -0,0 +1,79 @@
+/**
+ * @file mvcc_hash_table.h
+ * @brief Thread-safe Hash Table keeping several committed versions of each value.
+ *        Every update is stamped with a global commit timestamp and pushed in front of the
+ *        older versions of its key. A reader opens a snapshot at the current timestamp and
+ *        sees exactly the versions committed before it in every lookup, however many updates
+ *        land meanwhile. Lookups only hold the shard lock for one probe, so readers never
+ *        hold back writers for the life of a snapshot. Versions no open snapshot can see any
+ *        more are freed by the next update of their key or by collectMvccGarbage.
+ */
+
+#ifndef MVCC_HASH_TABLE_H
+#define MVCC_HASH_TABLE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hash_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Committed value of a key, linked to the version it replaced. */
+typedef struct MvccVersion {
+    char* value; /**< Value, NULL when the key was removed at this timestamp. */
+    uint64_t commitTs; /**< Timestamp the version was committed at. */
+    struct MvccVersion* older; /**< Previous version, NULL for the oldest one kept. */
+} MvccVersion;
+
+/** @brief Key with its versions, newest first. */
+typedef struct MvccEntry {
+    char* key; /**< Key of the entry. */
+    unsigned int hash; /**< hashKey of the key. */
+    MvccVersion* newest; /**< Latest committed version. */
+    struct MvccEntry* next; /**< Next entry of the same container. */
+} MvccEntry;
+
+/** @brief Independently locked part of the table. */
+typedef struct {
+    MvccEntry** buckets; /**< Array of containers, each a chain of entries. */
+    int capacity; /**< Number of containers. */
+    int size; /**< Number of keys, removed keys included until collected. */
+    long versions; /**< Number of versions kept by the shard. */
+    pthread_rwlock_t lock; /**< Shared by lookups, exclusive for updates and collection. */
+} MvccShard;
+
+/** @brief Read view of the table, defined in mvcc_hash_table.c. */
+typedef struct MvccSnapshot MvccSnapshot;
+
+/** @brief Structure representing the versioned Hash Table. */
+typedef struct {
+    MvccShard* shards; /**< Shards the keys are spread over. */
+    int shardCount; /**< Number of shards. */
+    uint64_t commitClock; /**< Timestamp of the latest commit, 0 before the first one. */
+    uint64_t oldestFloor; /**< Oldest timestamp an open snapshot may read at, UINT64_MAX when none. */
+    MvccSnapshot* oldestSnapshot; /**< Open snapshots, oldest first. */
+    MvccSnapshot* newestSnapshot; /**< Most recently opened snapshot. */
+    pthread_mutex_t snapshotLock; /**< Guards the list of open snapshots. */
+    unsigned long reclaimedVersions; /**< Versions freed because no snapshot could see them. */
+} MvccHashTable;
+
+/*  FUNCTION DECLARATIONS   */
+void initMvccHashTable(MvccHashTable* mt, int shardCount, int capacity);
+uint64_t insertMvccKeyValPair(MvccHashTable* mt, const char* key, const char* value);
+uint64_t removeMvccKeyValPair(MvccHashTable* mt, const char* key);
+MvccSnapshot* openMvccSnapshot(MvccHashTable* mt);
+uint64_t mvccSnapshotTimestamp(const MvccSnapshot* snapshot);
+void closeMvccSnapshot(MvccHashTable* mt, MvccSnapshot* snapshot);
+int lookup_mvccHashTable(MvccHashTable* mt, const MvccSnapshot* snapshot, const char* key, char* buffer, size_t bufferSize);
+long collectMvccGarbage(MvccHashTable* mt);
+long mvccVersionCount(MvccHashTable* mt);
+void freeMvccHashTable(MvccHashTable* mt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MVCC_HASH_TABLE_H */
@@ -0,0 +1,428 @@
+/**
+ * @file ordered_index.c
+ * @brief Implementation of the crit-bit ordered index declared in ordered_index.h.
+ *        Every entry is ordered by its "extended key": the key bytes, the terminating
+ *        '\0', then the key pointer in big-endian order. This matches strcmp order and
+ *        makes entries of equal keys distinct.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "ordered_index.h"
+
+/** @brief Indexed pair. */
+typedef struct {
+    const char* key; /**< Key string, owned by the caller. */
+    const char* value; /**< Value string, owned by the caller. */
+    size_t length; /**< Length of the key. */
+} IndexLeaf;
+
+/** @brief Internal node splitting on one bit of the extended key. */
+typedef struct {
+    void* child[2]; /**< Subtrees with the bit clear and set; internal nodes are tagged with bit 0. */
+    size_t byte; /**< Index of the byte holding the critical bit. */
+    unsigned char otherbits; /**< Every bit except the critical one set. */
+} IndexNode;
+
+/** @brief One step of a root-to-leaf path. */
+typedef struct {
+    IndexNode* node; /**< Node passed through. */
+    int direction; /**< Child taken. */
+} PathStep;
+
+/** @brief Root-to-leaf path used to walk the index in order. */
+typedef struct {
+    PathStep* steps; /**< Steps from the root. */
+    size_t depth; /**< Number of steps. */
+    size_t slots; /**< Capacity of steps. */
+} Path;
+
+/** @brief Query key, an extended key with a null identity so it sorts before equal keys. */
+typedef struct {
+    const char* key; /**< Key string. */
+    size_t length; /**< Length of the key. */
+    uintptr_t identity; /**< Key pointer of an indexed entry, 0 for a query. */
+} ExtendedKey;
+
+/** @brief Bounds checked while scanning. */
+typedef struct {
+    const char* high; /**< Exclusive upper bound, NULL for none. */
+    const char* prefix; /**< Required prefix, NULL for none. */
+    size_t prefixLength; /**< Length of prefix. */
+} ScanBounds;
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Whether a child pointer refers to an internal node.
+ * @param child Child pointer.
+ * @return Non-zero for an internal node, zero for a leaf.
+ */
+static int isNode(const void* child) {
+    return (int)((uintptr_t)child & 1);
+}
+
+/**
+ * @brief Internal node behind a tagged child pointer.
+ * @param child Tagged child pointer.
+ * @return The internal node.
+ */
+static IndexNode* asNode(void* child) {
+    return (IndexNode*)((uintptr_t)child - 1);
+}
+
+/**
+ * @brief Byte @p i of an extended key.
+ * @param key Extended key.
+ * @param i Byte index.
+ * @return The byte, 0 past the end.
+ */
+static unsigned char keyByte(const ExtendedKey* key, size_t i) {
+    if (i <= key->length) {
+        return (unsigned char)key->key[i];
+    }
+    i -= key->length + 1;
+    if (i < sizeof(uintptr_t)) {
+        return (unsigned char)(key->identity >> (8 * (sizeof(uintptr_t) - 1 - i)));
+    }
+    return 0;
+}
+
+/**
+ * @brief Extended key of an indexed pair.
+ * @param leaf Indexed pair.
+ * @return Its extended key.
+ */
+static ExtendedKey leafKey(const IndexLeaf* leaf) {
+    ExtendedKey key = { leaf->key, leaf->length, (uintptr_t)leaf->key };
+    return key;
+}
+
+/**
+ * @brief Child of @p node an extended key belongs to.
+ * @param node Internal node.
+ * @param key Extended key.
+ * @return 0 or 1.
+ */
+static int childDirection(const IndexNode* node, const ExtendedKey* key) {
+    return (1 + (node->otherbits | keyByte(key, node->byte))) >> 8;
+}
+
+/**
+ * @brief Finds the first bit where two extended keys differ.
+ * @param a First key.
+ * @param b Second key.
+ * @param byte Receives the index of the differing byte.
+ * @param otherbits Receives the mask with every bit but the differing one set.
+ * @return Non-zero if the keys differ.
+ */
+static int criticalBit(const ExtendedKey* a, const ExtendedKey* b, size_t* byte, unsigned char* otherbits) {
+    size_t longest = (a->length > b->length ? a->length : b->length) + 1 + sizeof(uintptr_t);
+
+    for (size_t i = 0; i < longest; ++i) {
+        unsigned int diff = keyByte(a, i) ^ keyByte(b, i);
+        if (diff != 0) {
+            // Keep only the most significant differing bit, then invert
+            diff |= diff >> 1;
+            diff |= diff >> 2;
+            diff |= diff >> 4;
+            *byte = i;
+            *otherbits = (unsigned char)((diff & ~(diff >> 1)) ^ 255);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Appends a step to a path.
+ * @param path Path to extend.
+ * @param node Node passed through.
+ * @param direction Child taken.
+ */
+static void pushStep(Path* path, IndexNode* node, int direction) {
+    if (path->depth == path->slots) {
+        path->slots = path->slots == 0 ? 32 : path->slots * 2;
+        path->steps = (PathStep*)realloc(path->steps, sizeof(PathStep) * path->slots);
+        if (path->steps == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+    path->steps[path->depth].node = node;
+    path->steps[path->depth].direction = direction;
+    path->depth++;
+}
+
+/**
+ * @brief Descends to the smallest leaf of a subtree, recording the path.
+ * @param path Path extended with the steps taken.
+ * @param child Root of the subtree.
+ * @return The smallest leaf.
+ */
+static const IndexLeaf* leftmostLeaf(Path* path, void* child) {
+    while (isNode(child)) {
+        IndexNode* node = asNode(child);
+        pushStep(path, node, 0);
+        child = node->child[0];
+    }
+    return (const IndexLeaf*)child;
+}
+
+/**
+ * @brief Moves to the leaf following the subtree the path ends in.
+ * @param path Path to the current subtree, updated to the next leaf.
+ * @return The next leaf, or NULL at the end of the index.
+ */
+static const IndexLeaf* nextLeaf(Path* path) {
+    while (path->depth > 0) {
+        PathStep* step = &path->steps[path->depth - 1];
+        if (step->direction == 0) {
+            step->direction = 1;
+            return leftmostLeaf(path, step->node->child[1]);
+        }
+        path->depth--;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Finds the first leaf whose key is not smaller than @p low.
+ * @param index Pointer to the index.
+ * @param low Lower bound.
+ * @param path Receives the path to the returned leaf.
+ * @return The first leaf, or NULL if every key is smaller.
+ */
+static const IndexLeaf* lowerBound(const OrderedIndex* index, const char* low, Path* path) {
+    ExtendedKey query = { low, strlen(low), 0 };
+    void* child = index->root;
+    size_t byte;
+    unsigned char otherbits;
+
+    if (child == NULL) {
+        return NULL;
+    }
+
+    // Walk to the leaf sharing the longest prefix with the query
+    while (isNode(child)) {
+        IndexNode* node = asNode(child);
+        int direction = childDirection(node, &query);
+        pushStep(path, node, direction);
+        child = node->child[direction];
+    }
+    ExtendedKey found = leafKey((const IndexLeaf*)child);
+    if (!criticalBit(&query, &found, &byte, &otherbits)) {
+        return (const IndexLeaf*)child;
+    }
+
+    // Climb back to the subtree whose keys all share the query bits before the critical bit
+    while (path->depth > 0) {
+        const IndexNode* node = path->steps[path->depth - 1].node;
+        if (node->byte < byte || (node->byte == byte && node->otherbits < otherbits)) {
+            break;
+        }
+        path->depth--;
+    }
+    void* subtree = path->depth > 0 ? path->steps[path->depth - 1].node->child[path->steps[path->depth - 1].direction]
+                                    : index->root;
+
+    // The query sorts either before or after that whole subtree
+    if (((1 + (otherbits | keyByte(&query, byte))) >> 8) == 0) {
+        return leftmostLeaf(path, subtree);
+    }
+    return nextLeaf(path);
+}
+
+/**
+ * @brief Visits leaves in order from the lower bound while they are within the bounds.
+ * @param index Pointer to the index.
+ * @param low Lower bound.
+ * @param bounds Upper bound or prefix to stay within.
+ * @param visit Function called for each pair.
+ * @param context Opaque pointer passed to @p visit.
+ */
+static void scanFrom(const OrderedIndex* index, const char* low, const ScanBounds* bounds,
+                     OrderedIndexVisit visit, void* context) {
+    Path path = { NULL, 0, 0 };
+
+    for (const IndexLeaf* leaf = lowerBound(index, low, &path); leaf != NULL; leaf = nextLeaf(&path)) {
+        if (bounds->high != NULL && strcmp(leaf->key, bounds->high) >= 0) {
+            break;
+        }
+        if (bounds->prefix != NULL && strncmp(leaf->key, bounds->prefix, bounds->prefixLength) != 0) {
+            break;
+        }
+        if (visit(leaf->key, leaf->value, context) != 0) {
+            break;
+        }
+    }
+    free(path.steps);
+}
+
+/**
+ * @brief Initializes an empty index.
+ * @param index Pointer to the index.
+ */
+void initOrderedIndex(OrderedIndex* index) {
+    index->root = NULL;
+    index->count = 0;
+    index->bytes = 0;
+}
+
+/**
+ * @brief Adds a pair to the index.
+ * @param index Pointer to the index.
+ * @param key Key string, must stay valid until it is removed from the index.
+ * @param value Value string, must stay valid until the key is removed from the index.
+ */
+void insertOrderedIndex(OrderedIndex* index, const char* key, const char* value) {
+    IndexLeaf* leaf = (IndexLeaf*)malloc(sizeof(IndexLeaf));
+    if (leaf == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    leaf->key = key;
+    leaf->value = value;
+    leaf->length = strlen(key);
+    index->count++;
+    index->bytes += sizeof(IndexLeaf);
+
+    if (index->root == NULL) {
+        index->root = leaf;
+        return;
+    }
+
+    // Find the closest leaf and the first bit where the new key differs from it
+    ExtendedKey newKey = leafKey(leaf);
+    void* child = index->root;
+    while (isNode(child)) {
+        IndexNode* node = asNode(child);
+        child = node->child[childDirection(node, &newKey)];
+    }
+    ExtendedKey closest = leafKey((const IndexLeaf*)child);
+    IndexNode* newNode = (IndexNode*)malloc(sizeof(IndexNode));
+    if (newNode == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    criticalBit(&newKey, &closest, &newNode->byte, &newNode->otherbits);
+    int direction = childDirection(newNode, &closest);
+    newNode->child[1 - direction] = leaf;
+    index->bytes += sizeof(IndexNode);
+
+    // Hang the new node above the first node that tests a later bit
+    void** where = &index->root;
+    while (isNode(*where)) {
+        IndexNode* node = asNode(*where);
+        if (node->byte > newNode->byte || (node->byte == newNode->byte && node->otherbits > newNode->otherbits)) {
+            break;
+        }
+        where = &node->child[childDirection(node, &newKey)];
+    }
+    newNode->child[direction] = *where;
+    *where = (void*)((uintptr_t)newNode + 1);
+}
+
+/**
+ * @brief Removes the entry of a key pointer from the index.
+ * @param index Pointer to the index.
+ * @param key The same key pointer that was inserted.
+ */
+void removeOrderedIndex(OrderedIndex* index, const char* key) {
+    ExtendedKey target = { key, strlen(key), (uintptr_t)key };
+    void** where = &index->root;
+    void** parentWhere = NULL;
+    IndexNode* parent = NULL;
+    int direction = 0;
+
+    if (index->root == NULL) {
+        return;
+    }
+    while (isNode(*where)) {
+        parentWhere = where;
+        parent = asNode(*where);
+        direction = childDirection(parent, &target);
+        where = &parent->child[direction];
+    }
+    IndexLeaf* leaf = (IndexLeaf*)*where;
+    if (leaf->key != key) {
+        return;
+    }
+
+    // Replace the parent by the sibling of the leaf
+    free(leaf);
+    index->count--;
+    index->bytes -= sizeof(IndexLeaf);
+    if (parent == NULL) {
+        index->root = NULL;
+        return;
+    }
+    *parentWhere = parent->child[1 - direction];
+    free(parent);
+    index->bytes -= sizeof(IndexNode);
+}
+
+/**
+ * @brief Visits the pairs with low <= key < high in key order.
+ * @param index Pointer to the index.
+ * @param low Inclusive lower bound.
+ * @param high Exclusive upper bound, NULL for none.
+ * @param visit Function called for each pair.
+ * @param context Opaque pointer passed to @p visit.
+ */
+void scanOrderedIndexRange(const OrderedIndex* index, const char* low, const char* high, OrderedIndexVisit visit, void* context) {
+    ScanBounds bounds = { high, NULL, 0 };
+    scanFrom(index, low, &bounds, visit, context);
+}
+
+/**
+ * @brief Visits the pairs whose key starts with @p prefix in key order.
+ * @param index Pointer to the index.
+ * @param prefix Required prefix.
+ * @param visit Function called for each pair.
+ * @param context Opaque pointer passed to @p visit.
+ */
+void scanOrderedIndexPrefix(const OrderedIndex* index, const char* prefix, OrderedIndexVisit visit, void* context) {
+    ScanBounds bounds = { NULL, prefix, strlen(prefix) };
+    scanFrom(index, prefix, &bounds, visit, context);
+}
+
+/**
+ * @brief Bytes the next insertion will allocate.
+ * @param index Pointer to the index.
+ * @return Size of a leaf, plus a node unless the index is empty.
+ */
+size_t orderedIndexInsertBytes(const OrderedIndex* index) {
+    return sizeof(IndexLeaf) + (index->root != NULL ? sizeof(IndexNode) : 0);
+}
+
+/**
+ * @brief Frees every node and leaf of the index; the indexed strings are left alone.
+ * @param index Pointer to the index.
+ */
+void freeOrderedIndex(OrderedIndex* index) {
+    Path path = { NULL, 0, 0 };
+
+    // Free leaves in order, then each node once both of its subtrees are done
+    if (index->root != NULL) {
+        const IndexLeaf* leaf = leftmostLeaf(&path, index->root);
+        while (leaf != NULL) {
+            free((void*)leaf);
+            leaf = NULL;
+            while (path.depth > 0) {
+                PathStep* step = &path.steps[path.depth - 1];
+                if (step->direction == 0) {
+                    step->direction = 1;
+                    leaf = leftmostLeaf(&path, step->node->child[1]);
+                    break;
+                }
+                free(step->node);
+                path.depth--;
+            }
+        }
+    }
+    free(path.steps);
+    initOrderedIndex(index);
+}
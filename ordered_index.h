@@ -0,0 +1,41 @@
+/**
+ * @file ordered_index.h
+ * @brief Ordered index over key-value pairs owned by someone else, for prefix and range scans.
+ *        Implemented as a crit-bit (binary radix) tree. Entries point at the caller's key and
+ *        value strings; the key pointer itself breaks ties between equal keys, so the same
+ *        key may be indexed more than once and entries are removed by pointer identity.
+ */
+
+#ifndef ORDERED_INDEX_H
+#define ORDERED_INDEX_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Structure representing the ordered index. */
+typedef struct {
+    void* root; /**< Root node or leaf, NULL when empty. */
+    size_t count; /**< Number of indexed pairs. */
+    size_t bytes; /**< Bytes allocated for nodes and leaves. */
+} OrderedIndex;
+
+/** @brief Called for each pair of a scan, in key order; returning non-zero stops the scan. */
+typedef int (*OrderedIndexVisit)(const char* key, const char* value, void* context);
+
+/*  FUNCTION DECLARATIONS   */
+void initOrderedIndex(OrderedIndex* index);
+void insertOrderedIndex(OrderedIndex* index, const char* key, const char* value);
+void removeOrderedIndex(OrderedIndex* index, const char* key);
+void scanOrderedIndexRange(const OrderedIndex* index, const char* low, const char* high, OrderedIndexVisit visit, void* context);
+void scanOrderedIndexPrefix(const OrderedIndex* index, const char* prefix, OrderedIndexVisit visit, void* context);
+size_t orderedIndexInsertBytes(const OrderedIndex* index);
+void freeOrderedIndex(OrderedIndex* index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ORDERED_INDEX_H */
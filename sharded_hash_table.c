@@ -0,0 +1,581 @@
+/**
+ * @file sharded_hash_table.c
+ * @brief Implementation of the sharded Hash Table declared in sharded_hash_table.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "sharded_hash_table.h"
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Shard a key with a given hash is routed to, see shardIndex.
+ * @param st Pointer to the sharded hash table.
+ * @param hash hashKey of the key.
+ * @return Index of the shard.
+ */
+static int shardOfHash(const ShardedHashTable* st, unsigned int hash) {
+    if (st->routing == ROUTE_BY_NUMA_NODE) {
+        return currentNumaNode() % st->shardCount;
+    }
+    unsigned int mixed = hash * 2654435769u;
+    return (int)(((unsigned long long)mixed * (unsigned int)st->shardCount) >> 32);
+}
+
+/**
+ * @brief Makes the cached copies a write may have changed stale, see lookupCachedShardedHashTable.
+ * @details Called with the shard locked, once the write is done. An insertion into a shard
+ *          whose budget may evict, or call back, can remove other keys as well, so it moves
+ *          the epoch of the whole shard.
+ * @param st Pointer to the sharded hash table.
+ * @param shard Index of the written shard.
+ * @param hash hashKey of the written key.
+ * @param insertion Whether the write was an insertion.
+ */
+static void invalidateCachedKey(ShardedHashTable* st, int shard, unsigned int hash, int insertion) {
+    if (st->keyVersions == NULL) {
+        return;
+    }
+    __atomic_fetch_add(&st->keyVersions[hash & (KEY_VERSION_STRIPES - 1)], 1, __ATOMIC_RELEASE);
+    if (insertion && st->shards[shard].memoryBudget != 0 && st->shards[shard].budgetPolicy != BUDGET_REJECT) {
+        __atomic_fetch_add(&st->shardEpochs[shard], 1, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Initializes a sharded hash table.
+ * @details With ROUTE_BY_NUMA_NODE there is one shard per NUMA node and @p shardCount is
+ *          ignored; the containers of shard i are bound to node i. Keys and values are
+ *          allocated by the inserting thread, which the routing keeps on the same node.
+ * @param st Pointer to the sharded hash table to be initialized.
+ * @param shardCount Number of shards for ROUTE_BY_KEY.
+ * @param capacity Initial capacity of each shard.
+ * @param routing How operations pick their shard.
+ */
+void initShardedHashTable(ShardedHashTable* st, int shardCount, int capacity, ShardRouting routing) {
+    st->routing = routing;
+    st->keyVersions = NULL;
+    st->shardEpochs = NULL;
+    st->shardCount = routing == ROUTE_BY_NUMA_NODE ? numaNodeCount() : shardCount;
+    st->shards = (HashTable*)malloc(sizeof(HashTable) * st->shardCount);
+    st->locks = (ShardLock*)aligned_alloc(CACHE_LINE_SIZE, sizeof(ShardLock) * st->shardCount);
+    if (st->shards == NULL || st->locks == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < st->shardCount; ++i) {
+        initHashTable(&st->shards[i], capacity);
+        if (routing == ROUTE_BY_NUMA_NODE) {
+            setHashTableNumaPolicy(&st->shards[i], NUMA_BIND, i);
+        }
+        if (pthread_rwlock_init(&st->locks[i].lock, NULL) != 0) {
+            perror("Error in pthread_rwlock_init");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/**
+ * @brief Inserts a key-value pair into the shard chosen by the routing.
+ * @param st Pointer to the sharded hash table.
+ * @param key Key of the pair.
+ * @param value Value associated with the key.
+ * @return 1 if the pair was inserted, 0 if the memory budget of the shard rejected it.
+ */
+int insertShardedKeyValPair(ShardedHashTable* st, const char* key, const char* value) {
+    unsigned int hash = hashKey(key);
+    int shard = shardOfHash(st, hash);
+
+    pthread_rwlock_wrlock(&st->locks[shard].lock);
+    int inserted = insertHashedKeyValPair(&st->shards[shard], hash, key, value);
+    invalidateCachedKey(st, shard, hash, 1);
+    pthread_rwlock_unlock(&st->locks[shard].lock);
+    return inserted;
+}
+
+/**
+ * @brief Removes a key-value pair from the shard chosen by the routing.
+ * @param st Pointer to the sharded hash table.
+ * @param key Key of the pair to be removed.
+ */
+void removeShardedKeyValPair(ShardedHashTable* st, const char* key) {
+    unsigned int hash = hashKey(key);
+    int shard = shardOfHash(st, hash);
+
+    pthread_rwlock_wrlock(&st->locks[shard].lock);
+    removeHashedKeyValPair(&st->shards[shard], hash, key);
+    invalidateCachedKey(st, shard, hash, 0);
+    pthread_rwlock_unlock(&st->locks[shard].lock);
+}
+
+/**
+ * @brief Looks up a key in the shard chosen by the routing.
+ * @param st Pointer to the sharded hash table.
+ * @param key Key to look up.
+ * @param buffer Buffer receiving a copy of the value.
+ * @param bufferSize Size of the buffer, longer values are truncated.
+ * @return 1 if the key was found, 0 otherwise.
+ */
+int lookup_shardedHashTable(ShardedHashTable* st, const char* key, char* buffer, size_t bufferSize) {
+    return lookupInShard(st, shardIndex(st, key), key, buffer, bufferSize);
+}
+
+/**
+ * @brief Looks up a key in a given shard.
+ * @details The value is copied while the shard is locked, since a concurrent remove
+ *          may free it as soon as the lock is released.
+ * @param st Pointer to the sharded hash table.
+ * @param shard Index of the shard to search.
+ * @param key Key to look up.
+ * @param buffer Buffer receiving a copy of the value.
+ * @param bufferSize Size of the buffer, longer values are truncated.
+ * @return 1 if the key was found, 0 otherwise.
+ */
+int lookupInShard(ShardedHashTable* st, int shard, const char* key, char* buffer, size_t bufferSize) {
+    pthread_rwlock_rdlock(&st->locks[shard].lock);
+    int length = lookup_hashTableInto(&st->shards[shard], key, buffer, bufferSize);
+    pthread_rwlock_unlock(&st->locks[shard].lock);
+
+    return length >= 0;
+}
+
+/**
+ * @brief Makes every shard a numeric table, see setHashTableNumericValues.
+ * @param st Pointer to an empty sharded hash table.
+ * @return 1 if every shard now holds numbers, 0 if one is not empty and nothing changed.
+ */
+int setShardedHashTableNumericValues(ShardedHashTable* st) {
+    for (int i = 0; i < st->shardCount; ++i) {
+        if (st->shards[i].size > 0) {
+            return 0;
+        }
+    }
+    for (int i = 0; i < st->shardCount; ++i) {
+        setHashTableNumericValues(&st->shards[i]);
+    }
+    return 1;
+}
+
+/**
+ * @brief Adds @p delta to the number of a key, inserting the key with @p delta if absent.
+ * @details Keys already present are updated with an atomic fetch-add under the shared lock,
+ *          so concurrent increments of a shard do not serialize; only the first increment of
+ *          a key takes the exclusive lock. With ROUTE_BY_NUMA_NODE each node counts apart.
+ * @param st Pointer to the sharded hash table.
+ * @param key Key of the counter.
+ * @param delta Amount to add, negative to decrement.
+ * @param newValue Receives the number after the addition, may be NULL.
+ * @return 1 on success, 0 if the shards are not numeric or the memory budget of the shard
+ *         rejected a new key.
+ */
+int incrementShardedKeyValue(ShardedHashTable* st, const char* key, int64_t delta, int64_t* newValue) {
+    unsigned int hash = hashKey(key);
+    int shard = shardOfHash(st, hash);
+
+    pthread_rwlock_rdlock(&st->locks[shard].lock);
+    int added = addToExistingValue(&st->shards[shard], key, delta, newValue);
+    if (added) {
+        invalidateCachedKey(st, shard, hash, 0);
+    }
+    pthread_rwlock_unlock(&st->locks[shard].lock);
+    if (added) {
+        return 1;
+    }
+
+    // Another thread may have inserted the key in between, incrementKeyValue probes again
+    pthread_rwlock_wrlock(&st->locks[shard].lock);
+    int counted = incrementKeyValue(&st->shards[shard], key, delta, newValue);
+    invalidateCachedKey(st, shard, hash, 1);
+    pthread_rwlock_unlock(&st->locks[shard].lock);
+    return counted;
+}
+
+/**
+ * @brief Keeps the strings of every shard in dense arenas, see enableHashTableCompaction.
+ * @param st Pointer to the sharded hash table.
+ */
+void enableShardedHashTableCompaction(ShardedHashTable* st) {
+    for (int i = 0; i < st->shardCount; ++i) {
+        pthread_rwlock_wrlock(&st->locks[i].lock);
+        enableHashTableCompaction(&st->shards[i]);
+        pthread_rwlock_unlock(&st->locks[i].lock);
+    }
+}
+
+/**
+ * @brief Runs one compaction step on every shard, see compactHashTable.
+ * @details Each shard is locked exclusively for its own step only, which moves at most an
+ *          equal share of @p maxBytes, so lookups of a shard wait for one bounded step at
+ *          most and never see a pair halfway through a move.
+ * @param st Pointer to the sharded hash table.
+ * @param maxBytes Work allowed across all shards.
+ * @return Bytes of strings moved.
+ */
+size_t compactShardedHashTable(ShardedHashTable* st, size_t maxBytes) {
+    size_t moved = 0;
+
+    for (int i = 0; i < st->shardCount; ++i) {
+        pthread_rwlock_wrlock(&st->locks[i].lock);
+        moved += compactHashTable(&st->shards[i], maxBytes / st->shardCount);
+        pthread_rwlock_unlock(&st->locks[i].lock);
+    }
+    return moved;
+}
+
+/**
+ * @brief Frees the shards and their locks.
+ * @param st Pointer to the sharded hash table to be freed.
+ */
+void freeShardedHashTable(ShardedHashTable* st) {
+    for (int i = 0; i < st->shardCount; ++i) {
+        freeHashTable(&st->shards[i]);
+        pthread_rwlock_destroy(&st->locks[i].lock);
+    }
+    free(st->shards);
+    free(st->locks);
+    free(st->keyVersions);
+    free(st->shardEpochs);
+}
+
+/**
+ * @brief Lets threads answer lookups of hot keys from their own ReadCache.
+ * @details Turns on hot key tracking in every shard and starts versioning the keys written
+ *          through this table. Call it before the table is shared between threads; writes
+ *          made straight to a shard's HashTable bypass the versions and must not be mixed
+ *          with cached lookups.
+ * @param st Pointer to the sharded hash table.
+ */
+void enableShardedReadCaches(ShardedHashTable* st) {
+    if (st->keyVersions != NULL) {
+        return;
+    }
+    st->keyVersions = (unsigned long*)calloc(KEY_VERSION_STRIPES, sizeof(unsigned long));
+    st->shardEpochs = (unsigned long*)calloc(st->shardCount, sizeof(unsigned long));
+    if (st->keyVersions == NULL || st->shardEpochs == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < st->shardCount; ++i) {
+        pthread_rwlock_wrlock(&st->locks[i].lock);
+        enableHotKeyTracking(&st->shards[i]);
+        pthread_rwlock_unlock(&st->locks[i].lock);
+    }
+}
+
+/**
+ * @brief Initializes an empty read cache, to be used by one thread only.
+ * @param cache Pointer to the read cache.
+ */
+void initReadCache(ReadCache* cache) {
+    memset(cache, 0, sizeof(*cache));
+}
+
+/**
+ * @brief Copies a hot pair into its cache entry.
+ * @param entry Pointer to the cache entry, replaced.
+ * @param key Key of the pair.
+ * @param keyLength Length of the key.
+ * @param value Value of the pair.
+ * @param valueLength Length of the value.
+ */
+static void fillReadCacheEntry(ReadCacheEntry* entry, const char* key, size_t keyLength, const char* value, size_t valueLength) {
+    size_t needed = keyLength + valueLength + 2;
+    if (needed > entry->stringSlots) {
+        char* grown = (char*)realloc(entry->strings, needed);
+        if (grown == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        entry->strings = grown;
+        entry->stringSlots = needed;
+    }
+    memcpy(entry->strings, key, keyLength + 1);
+    memcpy(entry->strings + keyLength + 1, value, valueLength + 1);
+    entry->keyLength = (unsigned int)keyLength;
+    entry->valueLength = (unsigned int)valueLength;
+}
+
+/**
+ * @brief Looks up a key, answering from the thread's cache when it holds a current copy.
+ * @details A copy is current while neither the version of its key stripe nor the epoch of
+ *          its shard moved since before the value was read, so a hit takes no lock and only
+ *          reads two shared counters that writes alone change. A miss looks the key up under
+ *          the shard lock like lookup_shardedHashTable, and keeps a copy when the shard's
+ *          sketch reports the key as hot and its value is at most READ_CACHE_MAX_VALUE long.
+ *          Keys sharing an entry keep the copy of the hotter one, so the entries do not thrash.
+ *          Without enableShardedReadCaches every lookup is a miss and nothing is copied.
+ * @param st Pointer to the sharded hash table.
+ * @param cache Read cache of the calling thread.
+ * @param key Key to look up.
+ * @param buffer Buffer receiving a copy of the value.
+ * @param bufferSize Size of the buffer, longer values are truncated.
+ * @return 1 if the key was found, 0 otherwise.
+ */
+int lookupCachedShardedHashTable(ShardedHashTable* st, ReadCache* cache, const char* key, char* buffer, size_t bufferSize) {
+    if (st->keyVersions == NULL) {
+        cache->misses++;
+        return lookup_shardedHashTable(st, key, buffer, bufferSize);
+    }
+    size_t keyLength = strlen(key);
+    unsigned int hash = hashKey(key);
+    int shard = shardOfHash(st, hash);
+    const unsigned long* version = &st->keyVersions[hash & (KEY_VERSION_STRIPES - 1)];
+    const unsigned long* epoch = &st->shardEpochs[shard];
+    ReadCacheEntry* entry = &cache->entries[hash & (READ_CACHE_ENTRIES - 1)];
+
+    if (entry->strings != NULL && entry->hash == hash && entry->keyLength == keyLength && entry->shard == shard &&
+        __atomic_load_n(version, __ATOMIC_ACQUIRE) == entry->version && __atomic_load_n(epoch, __ATOMIC_ACQUIRE) == entry->epoch &&
+        memcmp(entry->strings, key, keyLength) == 0) {
+        // Keep sampling the hits, or the key would cool down while it is cached
+        sampleHotKey(st->shards[shard].hotKeys, hash);
+        if (bufferSize > 0) {
+            size_t copied = entry->valueLength < bufferSize - 1 ? entry->valueLength : bufferSize - 1;
+            memcpy(buffer, entry->strings + keyLength + 1, copied);
+            buffer[copied] = '\0';
+        }
+        cache->hits++;
+        return 1;
+    }
+
+    // Read the versions first, so a write landing during the lookup makes the copy stale
+    unsigned long keyVersion = __atomic_load_n(version, __ATOMIC_ACQUIRE);
+    unsigned long shardEpoch = __atomic_load_n(epoch, __ATOMIC_ACQUIRE);
+    pthread_rwlock_rdlock(&st->locks[shard].lock);
+    int length = lookupHashedKeyInto(&st->shards[shard], hash, key, buffer, bufferSize);
+    pthread_rwlock_unlock(&st->locks[shard].lock);
+    cache->misses++;
+    if (length < 0) {
+        return 0;
+    }
+
+    // Only whole values of hot keys are copied, and only over a copy of a key that is not hotter
+    const HotKeySketch* sketch = st->shards[shard].hotKeys;
+    if ((size_t)length < bufferSize && length <= READ_CACHE_MAX_VALUE && isHotKey(sketch, hash) &&
+        (entry->strings == NULL || hotKeyEstimate(st->shards[entry->shard].hotKeys, entry->hash) <= hotKeyEstimate(sketch, hash))) {
+        fillReadCacheEntry(entry, key, keyLength, buffer, (size_t)length);
+        entry->hash = hash;
+        entry->shard = shard;
+        entry->version = keyVersion;
+        entry->epoch = shardEpoch;
+        cache->fills++;
+    }
+    return 1;
+}
+
+/**
+ * @brief Frees the copies held by a read cache.
+ * @param cache Pointer to the read cache to be freed.
+ */
+void freeReadCache(ReadCache* cache) {
+    for (int i = 0; i < READ_CACHE_ENTRIES; ++i) {
+        free(cache->entries[i].strings);
+    }
+    initReadCache(cache);
+}
+
+/**
+ * @brief Initializes an empty write batch.
+ * @param batch Pointer to the write batch.
+ */
+void initWriteBatch(WriteBatch* batch) {
+    batch->ops = NULL;
+    batch->count = 0;
+    batch->slots = 0;
+    batch->order = NULL;
+    batch->bytes = NULL;
+    batch->used = 0;
+    batch->capacity = 0;
+}
+
+/**
+ * @brief Copies a string to the end of the bytes of a batch.
+ * @details Staged strings share one growing buffer, so a reused batch stages without
+ *          allocating and leaves the allocator to the insertions themselves.
+ * @param batch Pointer to the write batch.
+ * @param text String to copy.
+ * @return Offset of the copy in WriteBatch::bytes.
+ */
+static size_t stageString(WriteBatch* batch, const char* text) {
+    size_t length = strlen(text) + 1;
+    if (batch->used + length > batch->capacity) {
+        size_t capacity = batch->capacity > 0 ? batch->capacity * 2 : 256;
+        while (capacity < batch->used + length) {
+            capacity *= 2;
+        }
+        batch->bytes = (char*)realloc(batch->bytes, capacity);
+        if (batch->bytes == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        batch->capacity = capacity;
+    }
+    memcpy(batch->bytes + batch->used, text, length);
+    batch->used += length;
+    return batch->used - length;
+}
+
+/**
+ * @brief Appends an operation to a batch.
+ * @details The key is hashed once here; the shard and the container both derive from it.
+ * @param batch Pointer to the write batch.
+ * @param key Key of the operation.
+ * @param value Value to insert, NULL for a removal.
+ */
+static void stageOperation(WriteBatch* batch, const char* key, const char* value) {
+    if (batch->count == batch->slots) {
+        batch->slots = batch->slots > 0 ? batch->slots * 2 : 16;
+        batch->ops = (WriteBatchOp*)realloc(batch->ops, sizeof(WriteBatchOp) * batch->slots);
+        batch->order = (int*)realloc(batch->order, sizeof(int) * batch->slots);
+        if (batch->ops == NULL || batch->order == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+    WriteBatchOp* op = &batch->ops[batch->count++];
+    op->keyOffset = stageString(batch, key);
+    op->valueOffset = value != NULL ? stageString(batch, value) : WRITE_BATCH_REMOVE;
+    op->hash = hashKey(key);
+    op->shard = 0;
+}
+
+/**
+ * @brief Stages the insertion of a key-value pair; both strings are copied into the batch.
+ * @param batch Pointer to the write batch.
+ * @param key Key of the pair.
+ * @param value Value associated with the key.
+ */
+void batchInsertKeyValPair(WriteBatch* batch, const char* key, const char* value) {
+    stageOperation(batch, key, value);
+}
+
+/**
+ * @brief Stages the removal of a key-value pair; the key is copied into the batch.
+ * @param batch Pointer to the write batch.
+ * @param key Key of the pair to be removed.
+ */
+void batchRemoveKeyValPair(WriteBatch* batch, const char* key) {
+    stageOperation(batch, key, NULL);
+}
+
+/**
+ * @brief Applies every staged operation at once and empties the batch.
+ * @details The operations are grouped by shard with a stable counting sort, so operations on
+ *          one key keep their staging order. Every shard involved is locked exclusively, in
+ *          increasing shard order so two batches can never deadlock, before the first operation
+ *          runs, and released after the last one: lookups see either none or all of the batch,
+ *          and each shard is locked once however many operations it receives. Insertions the
+ *          memory budget of a shard rejects are skipped.
+ * @param st Pointer to the sharded hash table.
+ * @param batch Pointer to the write batch.
+ * @return Number of operations applied, below the number staged if the budget rejected insertions.
+ */
+int applyShardedWriteBatch(ShardedHashTable* st, WriteBatch* batch) {
+    if (batch->count == 0) {
+        return 0;
+    }
+    int* starts = (int*)calloc((size_t)st->shardCount + 1, sizeof(int));
+    if (starts == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    // Route each operation, then order them by shard keeping the staging order within one
+    for (int i = 0; i < batch->count; ++i) {
+        batch->ops[i].shard = shardOfHash(st, batch->ops[i].hash);
+        starts[batch->ops[i].shard + 1]++;
+    }
+    for (int s = 1; s <= st->shardCount; ++s) {
+        starts[s] += starts[s - 1];
+    }
+    for (int i = 0; i < batch->count; ++i) {
+        batch->order[starts[batch->ops[i].shard]++] = i;
+    }
+    free(starts);
+
+    for (int i = 0; i < batch->count; ++i) {
+        int shard = batch->ops[batch->order[i]].shard;
+        if (i == 0 || shard != batch->ops[batch->order[i - 1]].shard) {
+            pthread_rwlock_wrlock(&st->locks[shard].lock);
+        }
+    }
+    int applied = 0;
+    for (int i = 0; i < batch->count; ++i) {
+        const WriteBatchOp* op = &batch->ops[batch->order[i]];
+        HashTable* shard = &st->shards[op->shard];
+        const char* key = batch->bytes + op->keyOffset;
+        if (op->valueOffset == WRITE_BATCH_REMOVE) {
+            removeHashedKeyValPair(shard, op->hash, key);
+            applied++;
+        } else {
+            applied += insertHashedKeyValPair(shard, op->hash, key, batch->bytes + op->valueOffset);
+        }
+        invalidateCachedKey(st, op->shard, op->hash, op->valueOffset != WRITE_BATCH_REMOVE);
+    }
+    for (int i = 0; i < batch->count; ++i) {
+        int shard = batch->ops[batch->order[i]].shard;
+        if (i == 0 || shard != batch->ops[batch->order[i - 1]].shard) {
+            pthread_rwlock_unlock(&st->locks[shard].lock);
+        }
+    }
+    clearWriteBatch(batch);
+    return applied;
+}
+
+/**
+ * @brief Drops the staged operations, keeping the memory for the next batch.
+ * @param batch Pointer to the write batch.
+ */
+void clearWriteBatch(WriteBatch* batch) {
+    batch->count = 0;
+    batch->used = 0;
+}
+
+/**
+ * @brief Frees the memory of a write batch.
+ * @param batch Pointer to the write batch.
+ */
+void freeWriteBatch(WriteBatch* batch) {
+    free(batch->ops);
+    free(batch->order);
+    free(batch->bytes);
+    initWriteBatch(batch);
+}
+
+/**
+ * @brief Shard an operation on @p key is routed to.
+ * @details Key routing multiplies the hash by a Fibonacci constant and keeps the high bits,
+ *          so the shard does not correlate with the container index (hash % capacity).
+ * @param st Pointer to the sharded hash table.
+ * @param key Key of the operation.
+ * @return Index of the shard.
+ */
+int shardIndex(const ShardedHashTable* st, const char* key) {
+    if (st->routing == ROUTE_BY_NUMA_NODE) {
+        return currentNumaNode() % st->shardCount;
+    }
+    return shardOfHash(st, hashKey(key));
+}
+
+/**
+ * @brief NUMA node of the calling thread.
+ * @details Queried once per thread with getcpu and cached in a thread-local, so threads
+ *          are expected to be pinned to one node.
+ * @return NUMA node of the calling thread, 0 when unknown.
+ */
+int currentNumaNode(void) {
+    static _Thread_local int node = -1;
+
+    if (node < 0) {
+        unsigned int cpu = 0, currentNode = 0;
+        if (syscall(SYS_getcpu, &cpu, &currentNode, NULL) != 0) {
+            currentNode = 0;
+        }
+        node = (int)currentNode;
+    }
+    return node;
+}
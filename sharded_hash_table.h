@@ -0,0 +1,119 @@
+/**
+ * @file sharded_hash_table.h
+ * @brief Thread-safe Hash Table split into independently locked shards.
+ *        A shard is picked either from the key hash or from the NUMA node the calling
+ *        thread runs on, so each socket can work on a table whose memory is local to it.
+ *        A thread may keep a ReadCache of copies of the hottest keys, which lookups answer
+ *        from without taking the shard lock; every write through the table bumps the version
+ *        of its key, and a copy read under an older version is not used.
+ */
+
+#ifndef SHARDED_HASH_TABLE_H
+#define SHARDED_HASH_TABLE_H
+
+#include <pthread.h>
+#include "hash_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief How operations are routed to a shard. */
+typedef enum {
+    ROUTE_BY_KEY, /**< Each key belongs to the shard picked from its hash. */
+    ROUTE_BY_NUMA_NODE, /**< One shard per NUMA node, threads use the shard of the node they run on. */
+} ShardRouting;
+
+/** @brief Stripes of key versions, a power of two; a write makes the cached copies of its stripe stale. */
+#define KEY_VERSION_STRIPES 4096
+/** @brief Entries of a ReadCache, a power of two. */
+#define READ_CACHE_ENTRIES 512
+/** @brief Longest value a ReadCache keeps a copy of. */
+#define READ_CACHE_MAX_VALUE 256
+
+/** @brief Lock of one shard, alone on its cache line so neighbouring shards never share one. */
+typedef struct {
+    pthread_rwlock_t lock; /**< Shared by lookups and exclusive for updates. */
+} __attribute__((aligned(CACHE_LINE_SIZE))) ShardLock;
+
+/** @brief Structure representing the sharded Hash Table. */
+typedef struct {
+    HashTable* shards; /**< One hash table per shard. */
+    ShardLock* locks; /**< Lock of each shard, one cache line each. */
+    int shardCount; /**< Number of shards. */
+    ShardRouting routing; /**< How operations pick their shard. */
+    unsigned long* keyVersions; /**< Writes to each stripe of key hashes, NULL until read caches are enabled. */
+    unsigned long* shardEpochs; /**< Insertions into each shard that may have evicted other keys. */
+} ShardedHashTable;
+
+/** @brief Copy of one hot pair held by a ReadCache. */
+typedef struct {
+    char* strings; /**< Key then value, each terminated; NULL for an empty entry. */
+    size_t stringSlots; /**< Size of the strings allocation. */
+    unsigned int hash; /**< hashKey of the key. */
+    unsigned int keyLength; /**< Length of the key. */
+    unsigned int valueLength; /**< Length of the value. */
+    int shard; /**< Shard the value was read from. */
+    unsigned long version; /**< Version of the key stripe before the value was read. */
+    unsigned long epoch; /**< Epoch of the shard before the value was read. */
+} ReadCacheEntry;
+
+/** @brief Read-through cache of the hot keys, owned by one thread. */
+typedef struct {
+    ReadCacheEntry entries[READ_CACHE_ENTRIES]; /**< Copies, indexed by the low bits of the key hash. */
+    unsigned long hits; /**< Lookups answered from a copy. */
+    unsigned long misses; /**< Lookups that went to the shard. */
+    unsigned long fills; /**< Copies made of hot keys. */
+} ReadCache;
+
+/** @brief Value offset marking a staged removal. */
+#define WRITE_BATCH_REMOVE ((size_t)-1)
+
+/** @brief Insertion or removal staged in a WriteBatch. */
+typedef struct {
+    size_t keyOffset; /**< Offset of the key in WriteBatch::bytes. */
+    size_t valueOffset; /**< Offset of the value in WriteBatch::bytes, WRITE_BATCH_REMOVE for a removal. */
+    unsigned int hash; /**< hashKey of the key. */
+    int shard; /**< Shard the operation is routed to, set while applying. */
+} WriteBatchOp;
+
+/** @brief Insertions and removals applied together by applyShardedWriteBatch. */
+typedef struct {
+    WriteBatchOp* ops; /**< Staged operations, in staging order. */
+    int count; /**< Number of staged operations. */
+    int slots; /**< Capacity of ops and order. */
+    int* order; /**< Operation numbers grouped by shard, filled while applying. */
+    char* bytes; /**< Copies of the staged keys and values, back to back. */
+    size_t used; /**< Bytes of bytes in use. */
+    size_t capacity; /**< Size of bytes. */
+} WriteBatch;
+
+/*  FUNCTION DECLARATIONS   */
+void initShardedHashTable(ShardedHashTable* st, int shardCount, int capacity, ShardRouting routing);
+int insertShardedKeyValPair(ShardedHashTable* st, const char* key, const char* value);
+void removeShardedKeyValPair(ShardedHashTable* st, const char* key);
+int lookup_shardedHashTable(ShardedHashTable* st, const char* key, char* buffer, size_t bufferSize);
+int lookupInShard(ShardedHashTable* st, int shard, const char* key, char* buffer, size_t bufferSize);
+int setShardedHashTableNumericValues(ShardedHashTable* st);
+int incrementShardedKeyValue(ShardedHashTable* st, const char* key, int64_t delta, int64_t* newValue);
+void enableShardedHashTableCompaction(ShardedHashTable* st);
+size_t compactShardedHashTable(ShardedHashTable* st, size_t maxBytes);
+void freeShardedHashTable(ShardedHashTable* st);
+void enableShardedReadCaches(ShardedHashTable* st);
+void initReadCache(ReadCache* cache);
+int lookupCachedShardedHashTable(ShardedHashTable* st, ReadCache* cache, const char* key, char* buffer, size_t bufferSize);
+void freeReadCache(ReadCache* cache);
+void initWriteBatch(WriteBatch* batch);
+void batchInsertKeyValPair(WriteBatch* batch, const char* key, const char* value);
+void batchRemoveKeyValPair(WriteBatch* batch, const char* key);
+int applyShardedWriteBatch(ShardedHashTable* st, WriteBatch* batch);
+void clearWriteBatch(WriteBatch* batch);
+void freeWriteBatch(WriteBatch* batch);
+int shardIndex(const ShardedHashTable* st, const char* key);
+int currentNumaNode(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHARDED_HASH_TABLE_H */
@@ -0,0 +1,215 @@
+/**
+ * @file value_codec.c
+ * @brief Implementation of the codec declared in value_codec.h.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "value_codec.h"
+
+/** @brief Shortest match worth encoding. */
+#define CODEC_MIN_MATCH 4
+/** @brief The last bytes of the input are always stored as literals. */
+#define CODEC_LAST_LITERALS 5
+/** @brief Farthest back a match may point, the reach of the 2-byte offset. */
+#define CODEC_MAX_OFFSET 65535
+/** @brief log2 of the number of entries of the match finder table. */
+#define CODEC_HASH_BITS 12
+
+/*  FUNCTION DEFINITIONS */
+
+/**
+ * @brief Reads 4 bytes without alignment requirements.
+ * @param p Pointer to the bytes.
+ * @return The bytes as a 32-bit value.
+ */
+static uint32_t read32(const char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Writes a length in the 255-continuation form that follows a saturated nibble.
+ * @param out Pointer to the output cursor.
+ * @param end End of the output buffer.
+ * @param length Length minus the 15 already in the nibble.
+ * @return 1 on success, 0 if the output buffer is full.
+ */
+static int writeLength(unsigned char** out, const unsigned char* end, size_t length) {
+    while (length >= 255) {
+        if (*out >= end) {
+            return 0;
+        }
+        *(*out)++ = 255;
+        length -= 255;
+    }
+    if (*out >= end) {
+        return 0;
+    }
+    *(*out)++ = (unsigned char)length;
+    return 1;
+}
+
+/**
+ * @brief Writes one sequence: pending literals followed by a match, or by nothing for the last one.
+ * @param out Pointer to the output cursor.
+ * @param end End of the output buffer.
+ * @param literals First pending literal.
+ * @param literalLength Number of pending literals.
+ * @param offset Distance back to the match, ignored when matchLength is 0.
+ * @param matchLength Length of the match, 0 for the last sequence.
+ * @return 1 on success, 0 if the output buffer is full.
+ */
+static int writeSequence(unsigned char** out, const unsigned char* end, const char* literals,
+                         size_t literalLength, size_t offset, size_t matchLength) {
+    if (*out >= end) {
+        return 0;
+    }
+    unsigned char* token = (*out)++;
+    size_t matchCode = matchLength > 0 ? matchLength - CODEC_MIN_MATCH : 0;
+    *token = (unsigned char)(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+    if (literalLength >= 15 && !writeLength(out, end, literalLength - 15)) {
+        return 0;
+    }
+    if ((size_t)(end - *out) < literalLength) {
+        return 0;
+    }
+    memcpy(*out, literals, literalLength);
+    *out += literalLength;
+
+    if (matchLength == 0) {
+        return 1;
+    }
+    if (end - *out < 2) {
+        return 0;
+    }
+    *(*out)++ = (unsigned char)(offset & 0xFF);
+    *(*out)++ = (unsigned char)(offset >> 8);
+    return matchCode < 15 || writeLength(out, end, matchCode - 15);
+}
+
+/**
+ * @brief Largest output compressValue can produce for an input of @p length bytes.
+ * @param length Input length.
+ * @return Number of bytes.
+ */
+size_t compressedBound(size_t length) {
+    return length + length / 255 + 16;
+}
+
+/**
+ * @brief Compresses a buffer.
+ * @param source Bytes to compress.
+ * @param length Number of bytes.
+ * @param destination Buffer receiving the compressed bytes.
+ * @param capacity Size of the destination buffer.
+ * @return Compressed length, or 0 if it would not fit in @p capacity.
+ */
+size_t compressValue(const char* source, size_t length, unsigned char* destination, size_t capacity) {
+    // Positions are stored plus one so that 0 means empty
+    uint32_t table[1 << CODEC_HASH_BITS] = { 0 };
+    unsigned char* out = destination;
+    const unsigned char* end = destination + capacity;
+    size_t anchor = 0;
+    size_t position = 0;
+    size_t matchLimit = length > CODEC_LAST_LITERALS ? length - CODEC_LAST_LITERALS : 0;
+
+    while (position + CODEC_MIN_MATCH <= matchLimit) {
+        uint32_t sequence = read32(source + position);
+        uint32_t slot = (sequence * 2654435761u) >> (32 - CODEC_HASH_BITS);
+        size_t candidate = table[slot];
+        table[slot] = (uint32_t)position + 1;
+
+        if (candidate == 0 || position - (candidate - 1) > CODEC_MAX_OFFSET || read32(source + candidate - 1) != sequence) {
+            position++;
+            continue;
+        }
+        candidate--;
+
+        // Extend the match as far as the trailing literals allow
+        size_t matchLength = CODEC_MIN_MATCH;
+        while (position + matchLength < matchLimit && source[candidate + matchLength] == source[position + matchLength]) {
+            matchLength++;
+        }
+        if (!writeSequence(&out, end, source + anchor, position - anchor, position - candidate, matchLength)) {
+            return 0;
+        }
+        position += matchLength;
+        anchor = position;
+    }
+
+    if (!writeSequence(&out, end, source + anchor, length - anchor, 0, 0)) {
+        return 0;
+    }
+    return (size_t)(out - destination);
+}
+
+/**
+ * @brief Decompresses a buffer produced by compressValue.
+ * @details Stops early once @p capacity bytes were written, so a short destination
+ *          receives a prefix of the original bytes.
+ * @param source Compressed bytes.
+ * @param length Number of compressed bytes.
+ * @param destination Buffer receiving the original bytes.
+ * @param capacity Size of the destination buffer.
+ * @return Number of bytes written.
+ */
+size_t decompressValue(const unsigned char* source, size_t length, char* destination, size_t capacity) {
+    const unsigned char* in = source;
+    const unsigned char* inEnd = source + length;
+    size_t written = 0;
+
+    while (in < inEnd && written < capacity) {
+        unsigned int token = *in++;
+
+        // Literals
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            unsigned char more;
+            do {
+                more = in < inEnd ? *in++ : 0;
+                literalLength += more;
+            } while (more == 255);
+        }
+        if (literalLength > (size_t)(inEnd - in)) {
+            literalLength = (size_t)(inEnd - in);
+        }
+        size_t copy = literalLength < capacity - written ? literalLength : capacity - written;
+        memcpy(destination + written, in, copy);
+        written += copy;
+        in += literalLength;
+        if (in + 2 > inEnd || written == capacity) {
+            break;
+        }
+
+        // Match, copied byte by byte when it overlaps the bytes it produces
+        size_t offset = in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        size_t matchLength = (token & 0xF) + CODEC_MIN_MATCH;
+        if ((token & 0xF) == 15) {
+            unsigned char more;
+            do {
+                more = in < inEnd ? *in++ : 0;
+                matchLength += more;
+            } while (more == 255);
+        }
+        if (offset == 0 || offset > written) {
+            break;
+        }
+        if (matchLength > capacity - written) {
+            matchLength = capacity - written;
+        }
+        const char* match = destination + written - offset;
+        if (offset >= matchLength) {
+            memcpy(destination + written, match, matchLength);
+        } else {
+            for (size_t i = 0; i < matchLength; ++i) {
+                destination[written + i] = match[i];
+            }
+        }
+        written += matchLength;
+    }
+    return written;
+}
@@ -0,0 +1,27 @@
+/**
+ * @file value_codec.h
+ * @brief Small LZ77 codec in the style of the LZ4 block format, used to store large values.
+ *        Each sequence is a token (literal length and match length nibbles), the literals,
+ *        a 2-byte little-endian offset and any extra match length bytes. It favours speed
+ *        over ratio: one hash probe per position and no entropy coding.
+ */
+
+#ifndef VALUE_CODEC_H
+#define VALUE_CODEC_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*  FUNCTION DECLARATIONS   */
+size_t compressedBound(size_t length);
+size_t compressValue(const char* source, size_t length, unsigned char* destination, size_t capacity);
+size_t decompressValue(const unsigned char* source, size_t length, char* destination, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VALUE_CODEC_H */